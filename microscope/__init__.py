@@ -142,6 +142,41 @@ class Binning(typing.NamedTuple):
     v: int
 
 
+class FrameMetadata(typing.NamedTuple):
+    """Metadata of a single data, typically an image, from a device.
+
+    Fields that the device does not support are `None`.
+
+    Attributes:
+        timestamp: time, as given by :func:`time.time`, when the data
+            was fetched from the device.
+        hardware_timestamp: time, in seconds, as given by the device
+            own clock.  Its origin depends on the device, typically
+            since the start of the acquisition or since the device
+            was turned on.
+        frame_number: number of the frame as counted by the device.
+        dropped_frames: number of frames lost between this frame and
+            the previous one, computed from the frame number.
+        transform: if not `None`, the (fliplr, flipud, rot90)
+            transform that the client needs to apply to the data
+            (see :func:`microscope.abc.transform_view`).
+        roi: region of the sensor, as a :class:`ROI`, for cameras
+            that acquire multiple regions per frame.  Each region is
+            sent as separate data with the same frame number.
+        pixel_encoding: if not `None`, the data is in this packed
+            encoding, e.g., "Mono12Packed", and the client needs to
+            unpack it (see :func:`microscope.abc.unpack_pixels`).
+    """
+
+    timestamp: typing.Optional[float] = None
+    hardware_timestamp: typing.Optional[float] = None
+    frame_number: typing.Optional[int] = None
+    dropped_frames: typing.Optional[int] = None
+    transform: typing.Optional[typing.Tuple[bool, bool, bool]] = None
+    roi: typing.Optional["ROI"] = None
+    pixel_encoding: typing.Optional[str] = None
+
+
 class ROI(typing.NamedTuple):
     """A tuple that defines a region of interest.
 
@@ -204,3 +239,27 @@ class TriggerMode(enum.Enum):
     BULB = 2
     STROBE = 3
     START = 4
+
+
+class DropPolicy(enum.Enum):
+    """What to do with new data for a client whose queue is full.
+
+    See :meth:`microscope.abc.DataDevice.set_client`.
+
+    :const:`DropPolicy.BLOCK`
+        Wait until there is space in the queue.  This stops the
+        acquisition of new data until the client catches up.
+    :const:`DropPolicy.DROP_OLDEST`
+        Drop the oldest data in the queue to make space for the new
+        data.
+    :const:`DropPolicy.LATEST_ONLY`
+        Keep only the most recent data, the queue has space for only
+        one data.  Useful for live previews.
+    :const:`DropPolicy.DROP_NEWEST`
+        Drop the new data and keep the data already in the queue.
+    """
+
+    BLOCK = 1
+    DROP_OLDEST = 2
+    LATEST_ONLY = 3
+    DROP_NEWEST = 4
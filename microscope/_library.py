@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+
+## Copyright (C) 2020 David Miguel Susano Pinto <carandraug@gmail.com>
+##
+## This file is part of Microscope.
+##
+## Microscope is free software: you can redistribute it and/or modify
+## it under the terms of the GNU General Public License as published by
+## the Free Software Foundation, either version 3 of the License, or
+## (at your option) any later version.
+##
+## Microscope is distributed in the hope that it will be useful,
+## but WITHOUT ANY WARRANTY; without even the implied warranty of
+## MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+## GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License
+## along with Microscope.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Vendor libraries loaded on first use.
+
+Modules that wrap a vendor library with ctypes used to load it, and
+look up all of its functions, when imported.  With a
+:class:`LazyLibrary`, the library is only loaded when one of its
+functions is first called, so importing a module, e.g., to check a
+device server configuration or to serve an unrelated device, does
+not need the library.
+"""
+
+import ctypes
+import threading
+import typing
+
+import microscope
+
+
+class LazyLibrary:
+    """A ctypes library loaded the first time one of its attributes is used.
+
+    Args:
+        loader: function that loads and returns the library, e.g.,
+            ``lambda: ctypes.CDLL("libfoo.so")``.
+        on_load: function called with the library once it's loaded,
+            e.g., to initialise it.
+
+    Failure to load the library raises
+    :class:`microscope.LibraryLoadError`, chained with the original
+    exception, and the next use tries to load it again.
+    """
+
+    def __init__(
+        self,
+        loader: typing.Callable[[], ctypes.CDLL],
+        on_load: typing.Optional[typing.Callable[[ctypes.CDLL], None]] = None,
+    ) -> None:
+        self._loader = loader
+        self._on_load = on_load
+        self._lib: typing.Optional[ctypes.CDLL] = None
+        self._lock = threading.Lock()
+
+    @property
+    def is_loaded(self) -> bool:
+        return self._lib is not None
+
+    def load(self) -> ctypes.CDLL:
+        """Load the library, if not loaded yet, and return it."""
+        if self._lib is not None:
+            return self._lib
+        with self._lock:
+            if self._lib is None:
+                try:
+                    lib = self._loader()
+                    if self._on_load is not None:
+                        self._on_load(lib)
+                except Exception as e:
+                    raise microscope.LibraryLoadError(e) from e
+                self._lib = lib
+        return self._lib
+
+    def __getattr__(self, name: str):
+        # Only called for attributes not found on LazyLibrary itself.
+        if name.startswith("_"):
+            raise AttributeError(name)
+        return getattr(self.load(), name)
@@ -0,0 +1,333 @@
+#!/usr/bin/env python3
+
+## Copyright (C) 2020 David Miguel Susano Pinto <carandraug@gmail.com>
+##
+## This file is part of Microscope.
+##
+## Microscope is free software: you can redistribute it and/or modify
+## it under the terms of the GNU General Public License as published by
+## the Free Software Foundation, either version 3 of the License, or
+## (at your option) any later version.
+##
+## Microscope is distributed in the hope that it will be useful,
+## but WITHOUT ANY WARRANTY; without even the implied warranty of
+## MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+## GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License
+## along with Microscope.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Counters, gauges, and histograms for instrumentation of devices.
+
+Each device has a :class:`Metrics` registry, available to its
+implementation as `_metrics`.  The device updates the metrics on its
+hot paths, e.g., it observes the time it takes to fetch each data,
+and clients read a snapshot of them with `Device.get_metrics`.  The
+device server can also serve the metrics of all its devices in the
+Prometheus text format (see :func:`format_prometheus`).
+
+Updating a metric only takes a lock and, for histograms, a bisection
+on the bucket upper bounds, so it's fine to do it once per frame.
+
+"""
+
+import bisect
+import math
+import threading
+import typing
+
+
+# Upper bounds, in seconds, of the default histogram buckets.  From
+# 10 microseconds to 10 seconds, which covers the time to fetch a
+# frame as well as the time for a slow client to receive it.
+DEFAULT_BUCKETS = (
+    0.00001,
+    0.000025,
+    0.00005,
+    0.0001,
+    0.00025,
+    0.0005,
+    0.001,
+    0.0025,
+    0.005,
+    0.01,
+    0.025,
+    0.05,
+    0.1,
+    0.25,
+    0.5,
+    1.0,
+    2.5,
+    5.0,
+    10.0,
+)
+
+
+class HistogramSnapshot(typing.NamedTuple):
+    """Values of a histogram.
+
+    `counts` has the number of observations on each bucket, not
+    cumulative, and has one more element than `buckets` for the
+    observations above the last bucket upper bound.
+    """
+
+    buckets: typing.Tuple[float, ...]
+    counts: typing.Tuple[int, ...]
+    sum: float
+    count: int
+
+
+class MetricSnapshot(typing.NamedTuple):
+    """Values of a metric, for all its labels, at some point in time.
+
+    `samples` maps the label values, as a tuple with the same order
+    as `labelnames`, to the value of the metric.  The value is a
+    number for counters and gauges and a :class:`HistogramSnapshot`
+    for histograms.
+    """
+
+    kind: str
+    description: str
+    labelnames: typing.Tuple[str, ...]
+    samples: typing.Dict[typing.Tuple[str, ...], typing.Any]
+
+
+class Counter:
+    """A value that only goes up, e.g., number of data sent."""
+
+    def __init__(self) -> None:
+        self._lock = threading.Lock()
+        self._value = 0
+
+    def inc(self, amount: float = 1) -> None:
+        with self._lock:
+            self._value += amount
+
+    def snapshot(self):
+        return self._value
+
+
+class Gauge:
+    """A value that goes up and down, e.g., length of a queue."""
+
+    def __init__(self) -> None:
+        self._value = 0
+
+    def set(self, value: float) -> None:
+        # Assignment is atomic so no lock needed.
+        self._value = value
+
+    def snapshot(self):
+        return self._value
+
+
+class Histogram:
+    """Distribution of observations, e.g., durations, in buckets."""
+
+    def __init__(
+        self, buckets: typing.Sequence[float] = DEFAULT_BUCKETS
+    ) -> None:
+        self._lock = threading.Lock()
+        self._buckets = tuple(sorted(buckets))
+        self._counts = [0] * (len(self._buckets) + 1)
+        self._sum = 0.0
+        self._count = 0
+
+    def observe(self, value: float) -> None:
+        index = bisect.bisect_left(self._buckets, value)
+        with self._lock:
+            self._counts[index] += 1
+            self._sum += value
+            self._count += 1
+
+    def snapshot(self) -> HistogramSnapshot:
+        with self._lock:
+            return HistogramSnapshot(
+                self._buckets, tuple(self._counts), self._sum, self._count
+            )
+
+
+class _Family:
+    """Metric with labels, one instance of the metric per label values."""
+
+    def __init__(
+        self,
+        factory: typing.Callable[[], typing.Any],
+        labelnames: typing.Tuple[str, ...],
+    ) -> None:
+        self._factory = factory
+        self._labelnames = labelnames
+        self._lock = threading.Lock()
+        self._children: typing.Dict[typing.Tuple[str, ...], typing.Any] = {}
+
+    def labels(self, *values: str):
+        """Return the metric for the given label values."""
+        if len(values) != len(self._labelnames):
+            raise ValueError(
+                "expected %d label values but got %d"
+                % (len(self._labelnames), len(values))
+            )
+        try:
+            return self._children[values]
+        except KeyError:
+            with self._lock:
+                return self._children.setdefault(values, self._factory())
+
+    def remove(self, *values: str) -> None:
+        """Remove the metric for the given label values, if any."""
+        with self._lock:
+            self._children.pop(values, None)
+
+    def snapshot(self) -> typing.Dict[typing.Tuple[str, ...], typing.Any]:
+        with self._lock:
+            children = list(self._children.items())
+        return {values: child.snapshot() for values, child in children}
+
+
+class Metrics:
+    """Registry of the metrics of a device.
+
+    The methods to create metrics return the metric itself, or a
+    family of metrics if there are labels in which case the metric
+    for each combination of labels is returned by its `labels`
+    method::
+
+        fetch_seconds = metrics.histogram(
+            "fetch_data_seconds", "Time to fetch data"
+        )
+        fetch_seconds.observe(0.002)
+
+        sent = metrics.counter(
+            "data_sent_total", "Data sent", labelnames=("client",)
+        )
+        sent.labels("PYRO:obj@127.0.0.1:8000").inc()
+
+    """
+
+    def __init__(self) -> None:
+        self._metrics: typing.Dict[str, typing.Tuple[str, str, _Family]] = {}
+
+    def _add(self, kind, name, description, labelnames, factory):
+        if name in self._metrics:
+            raise ValueError("there is already a metric named '%s'" % name)
+        family = _Family(factory, tuple(labelnames))
+        self._metrics[name] = (kind, description, family)
+        return family if labelnames else family.labels()
+
+    def counter(
+        self, name: str, description: str, labelnames: typing.Sequence = ()
+    ):
+        return self._add("counter", name, description, labelnames, Counter)
+
+    def gauge(
+        self, name: str, description: str, labelnames: typing.Sequence = ()
+    ):
+        return self._add("gauge", name, description, labelnames, Gauge)
+
+    def histogram(
+        self,
+        name: str,
+        description: str,
+        labelnames: typing.Sequence = (),
+        buckets: typing.Sequence[float] = DEFAULT_BUCKETS,
+    ):
+        return self._add(
+            "histogram",
+            name,
+            description,
+            labelnames,
+            lambda: Histogram(buckets),
+        )
+
+    def snapshot(self) -> typing.Dict[str, MetricSnapshot]:
+        """Return the current value of all metrics."""
+        return {
+            name: MetricSnapshot(
+                kind, description, family._labelnames, family.snapshot()
+            )
+            for name, (kind, description, family) in self._metrics.items()
+        }
+
+
+def _format_value(value: float) -> str:
+    if math.isinf(value):
+        return "+Inf" if value > 0 else "-Inf"
+    return repr(float(value))
+
+
+def _format_labels(labels: typing.Sequence[typing.Tuple[str, str]]) -> str:
+    def escape(value: str) -> str:
+        return (
+            str(value)
+            .replace("\\", "\\\\")
+            .replace("\n", "\\n")
+            .replace('"', '\\"')
+        )
+
+    return "{%s}" % ",".join('%s="%s"' % (k, escape(v)) for k, v in labels)
+
+
+def format_prometheus(
+    metrics_by_device: typing.Mapping[
+        str, typing.Mapping[str, MetricSnapshot]
+    ],
+    prefix: str = "microscope_",
+) -> str:
+    """Format metrics of multiple devices in Prometheus text format.
+
+    Args:
+        metrics_by_device: maps a device name, which is added as the
+            ``device`` label, to its metrics as returned by
+            :meth:`Metrics.snapshot`.
+        prefix: prefix for the name of all metrics.
+
+    """
+    by_name: typing.Dict[str, typing.List] = {}
+    for device, metrics in metrics_by_device.items():
+        for name, metric in metrics.items():
+            by_name.setdefault(name, []).append((device, metric))
+
+    lines = []
+    for name, device_metrics in by_name.items():
+        full_name = prefix + name
+        kind, description = device_metrics[0][1][:2]
+        lines.append("# HELP %s %s" % (full_name, description))
+        lines.append("# TYPE %s %s" % (full_name, kind))
+        for device, metric in device_metrics:
+            for values, sample in metric.samples.items():
+                labels = [("device", device)]
+                labels.extend(zip(metric.labelnames, values))
+                if kind != "histogram":
+                    lines.append(
+                        "%s%s %s"
+                        % (
+                            full_name,
+                            _format_labels(labels),
+                            _format_value(sample),
+                        )
+                    )
+                    continue
+                cumulative = 0
+                for upper, count in zip(
+                    sample.buckets + (math.inf,), sample.counts
+                ):
+                    cumulative += count
+                    lines.append(
+                        "%s_bucket%s %d"
+                        % (
+                            full_name,
+                            _format_labels(
+                                labels + [("le", _format_value(upper))]
+                            ),
+                            cumulative,
+                        )
+                    )
+                lines.append(
+                    "%s_sum%s %s"
+                    % (full_name, _format_labels(labels), repr(sample.sum))
+                )
+                lines.append(
+                    "%s_count%s %d"
+                    % (full_name, _format_labels(labels), sample.count)
+                )
+    return "\n".join(lines) + "\n"
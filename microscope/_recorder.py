@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+
+## Copyright (C) 2020 David Miguel Susano Pinto <carandraug@gmail.com>
+##
+## This file is part of Microscope.
+##
+## Microscope is free software: you can redistribute it and/or modify
+## it under the terms of the GNU General Public License as published by
+## the Free Software Foundation, either version 3 of the License, or
+## (at your option) any later version.
+##
+## Microscope is distributed in the hope that it will be useful,
+## but WITHOUT ANY WARRANTY; without even the implied warranty of
+## MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+## GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License
+## along with Microscope.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Recording of data to disk, next to the device.
+
+A :class:`RawRecorder` writes the data, one after the other, to a raw
+file, i.e., as C ordered arrays without any header.  The metadata of
+each data is written, one line per data, to a tab separated file with
+the same name plus ``.tsv``.  Once the recording is closed, a JSON
+file with the same name plus ``.json`` describes the data type and
+shape of the whole recording so that it can be read with::
+
+    with open(path + ".json") as fh:
+        description = json.load(fh)
+    data = numpy.memmap(
+        path,
+        dtype=description["dtype"],
+        mode="r",
+        shape=tuple(description["shape"]),
+    )
+
+If the shape or data type of the data changes, e.g., because the ROI
+of the camera changed, the recording continues on a new set of files
+whose path has a number before the extension, e.g., ``data-1.raw``.
+
+"""
+
+import json
+import logging
+import os.path
+import typing
+
+import numpy
+
+import microscope
+
+
+_logger = logging.getLogger(__name__)
+
+
+# Size, in bytes, of the write buffer.  Smaller data are accumulated
+# so that writes to disk are large and sequential.
+_BUFFER_SIZE = 16 * 1024 * 1024
+
+_METADATA_FIELDS = microscope.FrameMetadata._fields
+
+
+class RawRecorder:
+    """Record data, and its metadata, to a raw file.
+
+    This is meant to be used as a local client of a
+    :class:`microscope.abc.DataDevice`, i.e., it has the
+    `receiveData` and `receiveDataBatch` methods.  Data with a
+    different shape or data type than the previous data starts a new
+    raw file.
+
+    Args:
+        path: path for the raw file.  The metadata and description
+            files have the same path plus ``.tsv`` and ``.json``.
+            None of the files may already exist.
+
+    """
+
+    def __init__(self, path: str) -> None:
+        self._paths: typing.List[str] = []
+        self._n_total = 0
+        self._open(path)
+
+    def _open(self, path: str) -> None:
+        self._dtype: typing.Optional[numpy.dtype] = None
+        self._shape: typing.Optional[typing.Tuple[int, ...]] = None
+        self._n_data = 0
+        # Open in exclusive creation mode so that we never overwrite
+        # a previous recording.
+        self._data_file = open(path, "xb", buffering=_BUFFER_SIZE)
+        try:
+            self._metadata_file = open(path + ".tsv", "x")
+        except Exception:
+            self._data_file.close()
+            raise
+        self._metadata_file.write("\t".join(_METADATA_FIELDS) + "\n")
+        self._paths.append(path)
+
+    @property
+    def path(self) -> str:
+        """Path of the raw file currently being written."""
+        return self._paths[-1]
+
+    @property
+    def paths(self) -> typing.List[str]:
+        """Paths of all the raw files of the recording."""
+        return list(self._paths)
+
+    @property
+    def n_data(self) -> int:
+        """Number of data recorded so far, on all files."""
+        return self._n_total
+
+    def _next_path(self) -> str:
+        root, ext = os.path.splitext(self._paths[0])
+        return "%s-%d%s" % (root, len(self._paths), ext)
+
+    def receiveData(self, data, timestamp, metadata=None, *args) -> None:
+        if isinstance(data, Exception):
+            _logger.warning("not recording exception: %s", data)
+            return
+        if metadata is None:
+            metadata = microscope.FrameMetadata(timestamp)
+        self._write(numpy.asarray(data)[numpy.newaxis], [metadata])
+
+    def receiveDataBatch(self, data, timestamps, metadata=None, *args) -> None:
+        if metadata is None:
+            metadata = [microscope.FrameMetadata(t) for t in timestamps]
+        self._write(numpy.asarray(data), metadata)
+
+    def _write(self, stack: numpy.ndarray, metadata) -> None:
+        if self._dtype is None:
+            self._dtype = stack.dtype
+            self._shape = stack.shape[1:]
+        elif stack.dtype != self._dtype or stack.shape[1:] != self._shape:
+            # Raising here would only reach the dispatch thread and
+            # lose the data, so continue on a new file.
+            self._close_file()
+            self._open(self._next_path())
+            _logger.info(
+                "data changed to shape %s and type %s, recording to '%s'",
+                stack.shape[1:],
+                stack.dtype,
+                self.path,
+            )
+            self._dtype = stack.dtype
+            self._shape = stack.shape[1:]
+        # Writing from the array buffer avoids a copy unless the
+        # array is not contiguous.
+        self._data_file.write(numpy.ascontiguousarray(stack).data)
+        for single_metadata in metadata:
+            self._metadata_file.write(
+                "\t".join(
+                    "" if value is None else str(value)
+                    for value in single_metadata
+                )
+                + "\n"
+            )
+        self._n_data += stack.shape[0]
+        self._n_total += stack.shape[0]
+
+    def _close_file(self) -> None:
+        """Finish writing the current file and write its description."""
+        self._data_file.close()
+        self._metadata_file.close()
+        description = {
+            "dtype": None if self._dtype is None else self._dtype.str,
+            "shape": [self._n_data, *(self._shape or ())],
+            "metadata": os.path.basename(self.path) + ".tsv",
+        }
+        with open(self.path + ".json", "x") as fh:
+            json.dump(description, fh, indent=2)
+        _logger.info("recorded %d data to '%s'", self._n_data, self.path)
+
+    def close(self) -> None:
+        """Finish writing the recording and write its description."""
+        self._close_file()
@@ -0,0 +1,335 @@
+#!/usr/bin/env python3
+
+## Copyright (C) 2020 David Miguel Susano Pinto <carandraug@gmail.com>
+##
+## This file is part of Microscope.
+##
+## Microscope is free software: you can redistribute it and/or modify
+## it under the terms of the GNU General Public License as published by
+## the Free Software Foundation, either version 3 of the License, or
+## (at your option) any later version.
+##
+## Microscope is distributed in the hope that it will be useful,
+## but WITHOUT ANY WARRANTY; without even the implied warranty of
+## MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+## GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License
+## along with Microscope.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Pyro serializer with out-of-band buffers for numpy arrays.
+
+The "pickle" serializer that Pyro uses by default copies the data of
+numpy arrays into the pickle stream, and has the usual security
+issues of unpickling data from the network.  The "pickle5" serializer
+in this module instead:
+
+* uses pickle protocol 5 with out-of-band buffers so the data of
+  arrays is sent as raw buffers after a small pickle stream.  On the
+  receiving side, the arrays are views of the received message
+  instead of copies.  These arrays are read-only.  On the sending
+  side there is no gain: the buffers are copied into the message,
+  like pickle copies them into its stream, and Pyro then copies the
+  message once more.
+
+* only unpickles an allow list of types: Python builtin types and
+  exceptions, numpy arrays, the data types of Microscope, such as
+  :class:`microscope.FrameMetadata` and the enums, and the
+  exceptions of Microscope and Pyro.  Other classes, e.g., enums
+  used in settings, can be added with :func:`allow_class`.
+
+* optionally compresses the buffers with lz4 or blosc (with byte
+  shuffle, which works well for uint16 images) for clients on slower
+  networks.  This requires the `lz4` or `blosc` packages.
+
+This requires Python 3.8 or later.  Use :func:`register` to make the
+serializer available to Pyro, and then select it like any other Pyro
+serializer::
+
+    microscope._serializer.register()
+    Pyro4.config.SERIALIZERS_ACCEPTED.add("pickle5")
+    Pyro4.config.SERIALIZER = "pickle5"
+
+The serializer only needs to be selected by the side that sends the
+data, typically the device server which calls the client
+`receiveData` method, but both sides need to have registered it.
+
+The allow list only protects the messages sent with this
+serializer.  The device server still accepts the plain "pickle"
+serializer, so that clients such as Cockpit keep working, and a
+client can still send it anything that pickle can unpickle.  Only
+serve devices on trusted networks.
+
+"""
+
+import copyreg
+import io
+import logging
+import pickle
+import struct
+import sys
+import typing
+
+import numpy
+import Pyro4.errors
+import Pyro4.util
+
+
+_logger = logging.getLogger(__name__)
+
+
+NAME = "pickle5"
+
+# Pyro sends the ID of the serializer on each message.  The Pyro4
+# serializers have IDs 1 to 6.
+_SERIALIZER_ID = 52
+
+_MAGIC = b"MSP5"
+
+# Message header: magic, number of buffers, and pickle stream length.
+_HEADER = struct.Struct("<4sIQ")
+
+# Buffer header: codec and number of bytes in the message.
+_BUFFER_HEADER = struct.Struct("<BQ")
+
+_CODEC_NONE = 0
+_CODEC_LZ4 = 1
+_CODEC_BLOSC = 2
+
+_CODECS = {"lz4": _CODEC_LZ4, "blosc": _CODEC_BLOSC}
+
+# Buffers smaller than this are never compressed.
+_MIN_COMPRESS_SIZE = 64 * 1024
+
+# Compression codec for outgoing buffers, one of _CODECS values.
+_compression = _CODEC_NONE
+
+
+_SAFE_BUILTINS = {
+    bool,
+    bytearray,
+    bytes,
+    complex,
+    dict,
+    float,
+    frozenset,
+    int,
+    list,
+    object,
+    range,
+    set,
+    slice,
+    str,
+    tuple,
+}
+
+_SAFE_GLOBALS = {
+    ("copyreg", "_reconstructor"),
+    ("copyreg", "__newobj__"),
+    ("copyreg", "__newobj_ex__"),
+}
+for _numpy_core in ("numpy.core", "numpy._core"):
+    _SAFE_GLOBALS.update(
+        {
+            (_numpy_core + ".multiarray", "_reconstruct"),
+            (_numpy_core + ".multiarray", "scalar"),
+            (_numpy_core + ".numeric", "_frombuffer"),
+        }
+    )
+
+# Other classes that can be unpickled.  These are the types of the
+# data that devices and clients send each other, and not classes
+# that do something when constructed, such as devices, recorders,
+# shared memory rings, or Pyro daemons and proxies.
+_SAFE_CLASSES = {
+    ("collections", "OrderedDict"),
+    ("datetime", "date"),
+    ("datetime", "datetime"),
+    ("datetime", "time"),
+    ("datetime", "timedelta"),
+    ("datetime", "timezone"),
+    ("microscope", "AxisLimits"),
+    ("microscope", "Binning"),
+    ("microscope", "DropPolicy"),
+    ("microscope", "FrameMetadata"),
+    ("microscope", "ROI"),
+    ("microscope", "TriggerMode"),
+    ("microscope", "TriggerType"),
+    ("microscope._metrics", "HistogramSnapshot"),
+    ("microscope._metrics", "MetricSnapshot"),
+    ("microscope._shared_memory", "SharedFrame"),
+    ("Pyro4.core", "URI"),
+}
+
+# Packages whose exceptions can be unpickled.
+_EXCEPTION_PACKAGES = ("microscope", "Pyro4.errors")
+
+
+def allow_class(cls: type) -> None:
+    """Allow unpickling of a class, e.g., an enum used in a setting."""
+    _SAFE_CLASSES.add((cls.__module__, cls.__qualname__))
+
+
+def _is_allowed(module: str, name: str, obj) -> bool:
+    if (module, name) in _SAFE_GLOBALS or (module, name) in _SAFE_CLASSES:
+        return True
+    if not isinstance(obj, type):
+        return False
+    if module == "builtins":
+        return obj in _SAFE_BUILTINS or issubclass(obj, BaseException)
+    if module.split(".")[0] == "numpy":
+        return issubclass(
+            obj, (numpy.ndarray, numpy.dtype, numpy.generic)
+        ) and not issubclass(obj, numpy.memmap)
+    return issubclass(obj, BaseException) and any(
+        module == package or module.startswith(package + ".")
+        for package in _EXCEPTION_PACKAGES
+    )
+
+
+class _RestrictedUnpickler(pickle.Unpickler):
+    def find_class(self, module, name):
+        obj = super().find_class(module, name)
+        if not _is_allowed(module, name, obj):
+            raise pickle.UnpicklingError(
+                "unpickling of '%s.%s' is not allowed" % (module, name)
+            )
+        return obj
+
+
+def _compress(codec: int, buffer: pickle.PickleBuffer) -> bytes:
+    if codec == _CODEC_LZ4:
+        import lz4.frame
+
+        return lz4.frame.compress(buffer.raw())
+    else:  # _CODEC_BLOSC
+        import blosc
+
+        # The shuffle is per element so it needs the element size,
+        # which is lost in the raw view.
+        return blosc.compress(
+            buffer.raw().tobytes(),
+            typesize=memoryview(buffer).itemsize,
+            shuffle=blosc.SHUFFLE,
+            cname="lz4",
+        )
+
+
+def _decompress(codec: int, data: memoryview) -> bytes:
+    if codec == _CODEC_LZ4:
+        import lz4.frame
+
+        return lz4.frame.decompress(data)
+    elif codec == _CODEC_BLOSC:
+        import blosc
+
+        return blosc.decompress(data.tobytes())
+    else:
+        raise Pyro4.errors.SerializeError("unknown codec %d" % codec)
+
+
+def dumps(data) -> bytes:
+    """Serialize data with its buffers out-of-band.
+
+    Pyro needs a single bytes object so the buffers are copied into
+    it, which is the same one copy that in-band pickle makes.
+    """
+    buffers: typing.List[pickle.PickleBuffer] = []
+    stream = pickle.dumps(data, protocol=5, buffer_callback=buffers.append)
+    parts = [_HEADER.pack(_MAGIC, len(buffers), len(stream))]
+    raws = []
+    for buffer in buffers:
+        raw = buffer.raw()
+        codec = _CODEC_NONE
+        if _compression != _CODEC_NONE and raw.nbytes >= _MIN_COMPRESS_SIZE:
+            codec = _compression
+            raw = _compress(codec, buffer)
+        parts.append(_BUFFER_HEADER.pack(codec, len(raw)))
+        raws.append(raw)
+    parts.append(stream)
+    parts.extend(raws)
+    return b"".join(parts)
+
+
+def loads(data):
+    """Deserialize data, arrays are read-only views of `data`."""
+    view = memoryview(data).cast("B")
+    magic, n_buffers, stream_length = _HEADER.unpack_from(view)
+    if magic != _MAGIC:
+        raise Pyro4.errors.SerializeError("not a pickle5 message")
+    offset = _HEADER.size
+    buffer_headers = []
+    for _ in range(n_buffers):
+        buffer_headers.append(_BUFFER_HEADER.unpack_from(view, offset))
+        offset += _BUFFER_HEADER.size
+    stream = view[offset : offset + stream_length]
+    offset += stream_length
+    buffers = []
+    for codec, length in buffer_headers:
+        buffer = view[offset : offset + length]
+        offset += length
+        if codec != _CODEC_NONE:
+            buffer = _decompress(codec, buffer)
+        buffers.append(buffer)
+    return _RestrictedUnpickler(io.BytesIO(stream), buffers=buffers).load()
+
+
+class Pickle5Serializer(Pyro4.util.SerializerBase):
+    """Pyro serializer using :func:`dumps` and :func:`loads`."""
+
+    serializer_id = _SERIALIZER_ID
+
+    def dumpsCall(self, obj, method, vargs, kwargs):
+        return dumps((obj, method, vargs, kwargs))
+
+    def dumps(self, data):
+        return dumps(data)
+
+    def loadsCall(self, data):
+        return loads(data)
+
+    def loads(self, data):
+        return loads(data)
+
+    @classmethod
+    def register_type_replacement(cls, object_type, replacement_function):
+        # Same as Pyro's pickle serializer, it's also pickle.
+        def copyreg_function(obj):
+            return replacement_function(obj).__reduce__()
+
+        copyreg.pickle(object_type, copyreg_function)
+
+
+def is_available() -> bool:
+    """Whether this Python supports the pickle5 serializer."""
+    return sys.version_info >= (3, 8)
+
+
+def register() -> None:
+    """Make the "pickle5" serializer available to Pyro.
+
+    Does nothing in Python versions before 3.8.
+    """
+    if not is_available() or NAME in Pyro4.util._serializers:
+        return
+    serializer = Pickle5Serializer()
+    Pyro4.util._serializers[NAME] = serializer
+    Pyro4.util._serializers_by_id[serializer.serializer_id] = serializer
+
+
+def configure(compression: typing.Optional[str] = None) -> None:
+    """Configure the compression of buffers sent from this process.
+
+    Args:
+        compression: "lz4", "blosc", or `None` for no compression.
+            The receiving side also needs the compression package.
+    """
+    global _compression
+    if compression is None:
+        _compression = _CODEC_NONE
+        return
+    if compression not in _CODECS:
+        raise ValueError("unknown compression '%s'" % compression)
+    # Fail now, and not when sending data, if it's not installed.
+    __import__("lz4.frame" if compression == "lz4" else "blosc")
+    _compression = _CODECS[compression]
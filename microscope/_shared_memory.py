@@ -0,0 +1,265 @@
+#!/usr/bin/env python3
+
+## Copyright (C) 2020 David Miguel Susano Pinto <carandraug@gmail.com>
+##
+## This file is part of Microscope.
+##
+## Microscope is free software: you can redistribute it and/or modify
+## it under the terms of the GNU General Public License as published by
+## the Free Software Foundation, either version 3 of the License, or
+## (at your option) any later version.
+##
+## Microscope is distributed in the hope that it will be useful,
+## but WITHOUT ANY WARRANTY; without even the implied warranty of
+## MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+## GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License
+## along with Microscope.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Shared memory transport of data for clients on the same computer.
+
+Instead of sending the whole data over Pyro, a :class:`DataDevice`
+can write it to a ring of slots in a shared memory block and only
+send to the client a :class:`SharedFrame`, a reference to a slot in
+the ring.  The client, if on the same computer, can then map the same
+shared memory block and get a view of the data without any copy.
+
+The ring is owned by the device.  The client views are only valid
+until the device writes to that slot again, i.e., after the ring
+wraps around.  Each slot has a generation number, incremented on
+each write, which is also in the :class:`SharedFrame`.  A frame
+whose slot has a different generation number was overwritten and is
+dropped by :meth:`SharedMemoryReader.resolve`.  A client that needs
+to keep the data for longer must copy it, which ``resolve`` does
+before checking the generation number again.
+
+This requires :mod:`multiprocessing.shared_memory` which is only
+available in Python 3.8 or later.
+
+"""
+
+import logging
+import typing
+
+import numpy
+
+import microscope
+
+
+_logger = logging.getLogger(__name__)
+
+
+# Number of slots in the ring.  This is the number of frames that a
+# client may keep a view of before the device starts overwriting
+# them.
+DEFAULT_N_SLOTS = 16
+
+# Slots start at offsets aligned to this number of bytes.
+_ALIGNMENT = 64
+
+# Each slot starts with its generation number, as an unsigned 64 bit
+# integer, and the data only starts after this number of bytes so
+# that it stays aligned.
+_HEADER_SIZE = _ALIGNMENT
+
+# Generation number of a slot being written.
+_WRITING = 0
+
+
+def _shared_memory_module():
+    try:
+        import multiprocessing.shared_memory
+    except ImportError as e:
+        raise microscope.UnsupportedFeatureError(
+            "shared memory transport requires Python 3.8 or later"
+        ) from e
+    return multiprocessing.shared_memory
+
+
+class SharedFrame(typing.NamedTuple):
+    """Reference to data in a slot of a :class:`SharedMemoryRing`.
+
+    This is what gets sent to the client instead of the data itself.
+    """
+
+    name: str
+    offset: int
+    shape: typing.Tuple[int, ...]
+    dtype: str
+    generation: int
+
+
+class SharedMemoryRing:
+    """Ring of fixed size slots on a shared memory block.
+
+    This is the device side of the transport.  The shared memory
+    block is created on construction and destroyed on :meth:`close`.
+
+    Args:
+        slot_size: minimum size, in bytes, of each slot.
+        n_slots: number of slots in the ring.
+
+    """
+
+    def __init__(self, slot_size: int, n_slots: int = DEFAULT_N_SLOTS):
+        if n_slots < 1:
+            raise ValueError("n_slots must be positive (was %d)" % n_slots)
+        shared_memory = _shared_memory_module()
+        # Round slot size up so that all slots are aligned.
+        self._slot_size = -(-max(slot_size, 1) // _ALIGNMENT) * _ALIGNMENT
+        self._n_slots = n_slots
+        self._next_slot = 0
+        self._generation = _WRITING
+        self._shm = shared_memory.SharedMemory(
+            create=True, size=(_HEADER_SIZE + self._slot_size) * self._n_slots
+        )
+        # A new block is all zeros so no slot has valid data yet.
+        self._headers = numpy.ndarray(
+            (self._n_slots,),
+            dtype=numpy.uint64,
+            buffer=self._shm.buf,
+            strides=(_HEADER_SIZE + self._slot_size,),
+        )
+        _logger.debug(
+            "created shared memory '%s' with %d slots of %d bytes",
+            self._shm.name,
+            self._n_slots,
+            self._slot_size,
+        )
+
+    @property
+    def name(self) -> str:
+        return self._shm.name
+
+    @property
+    def slot_size(self) -> int:
+        return self._slot_size
+
+    def fits(self, data: numpy.ndarray) -> bool:
+        return data.nbytes <= self._slot_size
+
+    def write(self, data: numpy.ndarray) -> SharedFrame:
+        """Copy data to the next slot and return a reference to it."""
+        if not self.fits(data):
+            raise ValueError(
+                "data with %d bytes does not fit on slots of %d bytes"
+                % (data.nbytes, self._slot_size)
+            )
+        index = self._next_slot
+        self._next_slot = (self._next_slot + 1) % self._n_slots
+        self._generation += 1
+        offset = index * (_HEADER_SIZE + self._slot_size) + _HEADER_SIZE
+        # Mark the slot as being written so that a client reading the
+        # previous data from it knows that it has been overwritten.
+        self._headers[index] = _WRITING
+        slot = numpy.ndarray(
+            data.shape, dtype=data.dtype, buffer=self._shm.buf, offset=offset
+        )
+        # This a single copy even if data is not contiguous, e.g., a
+        # view of a flipped image.
+        slot[...] = data
+        # Drop our view of the buffer or we won't be able to close
+        # the shared memory later.
+        del slot
+        self._headers[index] = self._generation
+        return SharedFrame(
+            self._shm.name,
+            offset,
+            data.shape,
+            data.dtype.str,
+            self._generation,
+        )
+
+    def close(self) -> None:
+        """Release and destroy the shared memory block."""
+        del self._headers
+        self._shm.close()
+        self._shm.unlink()
+
+
+class SharedMemoryReader:
+    """Maps shared memory blocks to resolve :class:`SharedFrame`.
+
+    This is the client side of the transport.  Shared memory blocks
+    are attached the first time they're referenced and kept open
+    until :meth:`close`.
+
+    """
+
+    def __init__(self) -> None:
+        self._blocks = {}
+
+    def _attach(self, name: str):
+        shared_memory = _shared_memory_module()
+        try:
+            # Python 3.13 added the track argument so that attaching
+            # does not register the block with the resource tracker.
+            return shared_memory.SharedMemory(name=name, track=False)
+        except TypeError:
+            pass
+        shm = shared_memory.SharedMemory(name=name)
+        # Before Python 3.13, attaching to an existing block also
+        # registers it on the resource tracker which will then
+        # destroy it when this process exits, despite the device
+        # being its owner (see https://bugs.python.org/issue39959).
+        try:
+            from multiprocessing import resource_tracker
+
+            resource_tracker.unregister(shm._name, "shared_memory")
+        except Exception:
+            pass
+        return shm
+
+    def resolve(
+        self, frame: SharedFrame, copy: bool = False
+    ) -> typing.Optional[numpy.ndarray]:
+        """Return the referenced data.
+
+        Args:
+            frame: the reference sent by the device.
+            copy: return a copy of the data instead of a view of the
+                shared memory.
+
+        Returns `None` if the device already wrote newer data to the
+        slot.  A view is only valid until the device writes to the
+        slot again, the copy is checked after it is made.
+        """
+        if frame.name not in self._blocks:
+            # A new block means the device replaced its ring,
+            # typically because the data no longer fits.  Try to
+            # release the older ones.
+            self._release_unused()
+            self._blocks[frame.name] = self._attach(frame.name)
+        buf = self._blocks[frame.name].buf
+        header = numpy.ndarray(
+            (),
+            dtype=numpy.uint64,
+            buffer=buf,
+            offset=frame.offset - _HEADER_SIZE,
+        )
+        if header != frame.generation:
+            return None
+        data = numpy.ndarray(
+            frame.shape,
+            dtype=numpy.dtype(frame.dtype),
+            buffer=buf,
+            offset=frame.offset,
+        )
+        if copy:
+            data = data.copy()
+            if header != frame.generation:
+                return None
+        return data
+
+    def _release_unused(self) -> None:
+        for name, shm in list(self._blocks.items()):
+            try:
+                shm.close()
+            except BufferError:
+                # There are still views of this block around.
+                continue
+            del self._blocks[name]
+
+    def close(self) -> None:
+        self._release_unused()
@@ -17,7 +17,12 @@
 ## You should have received a copy of the GNU General Public License
 ## along with Microscope.  If not, see <http://www.gnu.org/licenses/>.
 
+import collections
+import concurrent.futures
+import logging
+import queue
 import threading
+import time
 import typing
 
 import serial
@@ -26,6 +31,9 @@ import microscope
 import microscope.abc
 
 
+_logger = logging.getLogger(__name__)
+
+
 class OnlyTriggersOnceOnSoftwareMixin(microscope.abc.TriggerTargetMixin):
     """Utility mixin for devices that only trigger "once" with software.
 
@@ -91,6 +99,33 @@ class OnlyTriggersBulbOnSoftwareMixin(microscope.abc.TriggerTargetMixin):
         )
 
 
+def poll_until(
+    condition: typing.Callable[[], bool],
+    timeout: float,
+    min_interval: float = 0.001,
+    max_interval: float = 0.05,
+) -> bool:
+    """Call `condition` until it returns true, or the timeout expires.
+
+    The interval between calls starts at `min_interval`, so that
+    short waits, such as the move to the next filter, end soon after
+    the condition is met, and doubles up to `max_interval`, so that
+    long waits do not load the connection to the device.
+
+    Returns:
+        Whether the condition was met before the timeout.
+    """
+    deadline = time.monotonic() + timeout
+    interval = min_interval
+    while not condition():
+        remaining = deadline - time.monotonic()
+        if remaining <= 0.0:
+            return False
+        time.sleep(min(interval, remaining))
+        interval = min(2.0 * interval, max_interval)
+    return True
+
+
 class SharedSerial:
     """Wraps a `Serial` instance with a lock for synchronization."""
 
@@ -119,3 +154,209 @@ class SharedSerial:
     def write(self, data: bytes) -> int:
         with self._lock:
             return self._serial.write(data)
+
+
+class _SerialRequest:
+    def __init__(
+        self,
+        command: bytes,
+        matcher: typing.Optional[typing.Callable[[bytes], bool]],
+        timeout: float,
+    ) -> None:
+        self.command = command
+        self.matcher = matcher
+        self.timeout = timeout
+        self.future: concurrent.futures.Future = concurrent.futures.Future()
+        self.deadline = float("inf")
+
+
+class SerialEngine:
+    """Owns the I/O of a serial port and pipelines the commands.
+
+    Commands are queued with :meth:`submit`, which returns a future
+    for the reply, and are written by a writer thread while a reader
+    thread matches the replies to the commands.  Up to
+    `max_in_flight` commands are written before their replies are
+    read, which saves the round-trips when multiple threads, e.g.,
+    multiple channels of a light source, send commands at the same
+    time.
+
+    Replies are one line each.  A reply is matched to the oldest
+    command in flight whose `matcher` accepts it, or which has no
+    `matcher`.  Devices that reply in order only need a matcher to
+    validate replies, but devices that may reply out of order, e.g.,
+    multiple devices on the same port, must use matchers that can
+    tell the replies apart, like Zaber message IDs.  Lines that do
+    not match any command, e.g., unsolicited alert messages, are
+    discarded.  Without matchers, a late reply to a command that
+    timed out is taken as the reply to the next command.
+
+    Only use `max_in_flight` above 1 if the device buffers commands
+    and does not need to handle one before receiving the next.
+
+    Args:
+        serial: the serial port.  It must have a read timeout, which
+            is also how often the commands in flight are checked for
+            their own timeout.
+        max_in_flight: maximum number of commands written before
+            reading their replies.
+        timeout: default time, in seconds, to wait for the reply of
+            a command before failing it.
+
+    """
+
+    def __init__(
+        self,
+        serial: serial.Serial,
+        max_in_flight: int = 1,
+        timeout: float = 2.0,
+    ) -> None:
+        if not serial.timeout:
+            raise ValueError("serial port must have a positive read timeout")
+        if max_in_flight < 1:
+            raise ValueError("max_in_flight must be positive")
+        self._serial = serial
+        self._timeout = timeout
+        self._requests: queue.Queue = queue.Queue()
+        self._slots = threading.Semaphore(max_in_flight)
+        self._in_flight: typing.Deque[_SerialRequest] = collections.deque()
+        self._in_flight_lock = threading.Lock()
+        self._closed = threading.Event()
+        self._writer = threading.Thread(
+            target=self._write_loop, name="serial-writer", daemon=True
+        )
+        self._reader = threading.Thread(
+            target=self._read_loop, name="serial-reader", daemon=True
+        )
+        self._writer.start()
+        self._reader.start()
+
+    def submit(
+        self,
+        command: bytes,
+        matcher: typing.Optional[typing.Callable[[bytes], bool]] = None,
+        timeout: typing.Optional[float] = None,
+    ) -> concurrent.futures.Future:
+        """Queue a command and return a future for its reply line.
+
+        Args:
+            command: the bytes to write, including any terminator.
+            matcher: function that returns whether a line is the
+                reply to this command.
+            timeout: time, in seconds, to wait for the reply after
+                writing the command.  The future fails with
+                `microscope.DeviceError` on timeout.
+
+        """
+        if self._closed.is_set():
+            raise microscope.DeviceError("serial engine is closed")
+        request = _SerialRequest(
+            command, matcher, self._timeout if timeout is None else timeout
+        )
+        self._requests.put(request)
+        return request.future
+
+    def command(
+        self,
+        command: bytes,
+        matcher: typing.Optional[typing.Callable[[bytes], bool]] = None,
+        timeout: typing.Optional[float] = None,
+    ) -> bytes:
+        """Write a command and wait for its reply line."""
+        return self.submit(command, matcher, timeout).result()
+
+    def _write_loop(self) -> None:
+        while True:
+            request = self._requests.get()
+            if request is None or self._closed.is_set():
+                self._requests.put(request)
+                return
+            if not request.future.set_running_or_notify_cancel():
+                continue
+            while not self._slots.acquire(timeout=self._serial.timeout):
+                if self._closed.is_set():
+                    self._requests.put(request)
+                    return
+            with self._in_flight_lock:
+                request.deadline = time.monotonic() + request.timeout
+                self._in_flight.append(request)
+            try:
+                self._serial.write(request.command)
+            except Exception as err:
+                if self._take(request):
+                    request.future.set_exception(err)
+
+    def _take(self, request: _SerialRequest) -> bool:
+        with self._in_flight_lock:
+            try:
+                self._in_flight.remove(request)
+            except ValueError:
+                return False
+        self._slots.release()
+        return True
+
+    def _match(self, line: bytes) -> typing.Optional[_SerialRequest]:
+        with self._in_flight_lock:
+            for request in self._in_flight:
+                if request.matcher is None or request.matcher(line):
+                    self._in_flight.remove(request)
+                    self._slots.release()
+                    return request
+        return None
+
+    def _expire(self) -> None:
+        now = time.monotonic()
+        with self._in_flight_lock:
+            expired = [r for r in self._in_flight if r.deadline < now]
+        for request in expired:
+            if self._take(request):
+                request.future.set_exception(
+                    microscope.DeviceError(
+                        "no reply to %s after %f seconds"
+                        % (request.command, request.timeout)
+                    )
+                )
+
+    def _read_loop(self) -> None:
+        while not self._closed.is_set():
+            try:
+                line = self._serial.readline()
+            except Exception as err:
+                if self._closed.is_set():
+                    return
+                _logger.error("failed to read from serial", exc_info=err)
+                time.sleep(self._serial.timeout)
+                line = b""
+            if line:
+                request = self._match(line)
+                if request is None:
+                    _logger.debug("discarding unexpected reply %s", line)
+                else:
+                    request.future.set_result(line)
+            self._expire()
+
+    def close(self) -> None:
+        """Stop the I/O threads and fail the commands not yet replied.
+
+        This does not close the serial port.
+        """
+        self._closed.set()
+        self._requests.put(None)
+        self._writer.join()
+        self._reader.join()
+        pending = []
+        while True:
+            try:
+                request = self._requests.get_nowait()
+            except queue.Empty:
+                break
+            if request is not None:
+                pending.append(request)
+        with self._in_flight_lock:
+            pending.extend(self._in_flight)
+            self._in_flight.clear()
+        for request in pending:
+            if not request.future.done():
+                request.future.set_exception(
+                    microscope.DeviceError("serial engine was closed")
+                )
@@ -22,6 +22,8 @@
 """
 
 import abc
+import collections
+import concurrent.futures
 import functools
 import itertools
 import logging
@@ -37,6 +39,9 @@ import numpy
 import Pyro4
 
 import microscope
+import microscope._metrics
+import microscope._recorder
+import microscope._shared_memory
 
 
 _logger = logging.getLogger(__name__)
@@ -61,6 +66,11 @@ def _call_if_callable(f):
     return f() if callable(f) else f
 
 
+# Marker for a setting whose value is not known, since `None` is a
+# valid value.
+_UNKNOWN = object()
+
+
 class _Setting:
     """Create a setting.
 
@@ -77,6 +87,17 @@ class _Setting:
             function will return `True` or `False` to indicate its
             current state.  If set to no `None` (default), then its
             value will be dependent on the value of `set_func`.
+        volatile: whether the value may change without being set,
+            e.g., a temperature reading, in which case its cached
+            value is never used.  If `None` (default), settings
+            without `set_func` are volatile.
+        ttl: time, in seconds, for which a cached value is valid.  If
+            `None` (default), it is valid until a setting is set.
+        live: whether the setting can be set during acquisition
+            without stopping it, or a function that returns whether it
+            can be set now.  Only used by :class:`DataDevice`.
+        coerces: whether the device may take a different value than
+            the one set, e.g., the nearest one it supports.
 
     A client needs some way of knowing a setting name and data type,
     retrieving the current value and, if settable, a way to retrieve
@@ -87,6 +108,11 @@ class _Setting:
     * the setting value for int, float, bool and str;
     * the setting index into a list, dict or Enum type for enum.
 
+    The last value read, or pushed by the device with
+    :meth:`update_cache`, is cached.  The device serves
+    `get_all_settings` from this cache to avoid a query to the
+    hardware per setting, which is slow on serial devices.
+
     .. todo::
 
         refactor into subclasses to avoid if isinstance .. elif
@@ -104,6 +130,10 @@ class _Setting:
         set_func: typing.Optional[typing.Callable[[typing.Any], None]] = None,
         values: typing.Any = None,
         readonly: typing.Optional[typing.Callable[[], bool]] = None,
+        volatile: typing.Optional[bool] = None,
+        ttl: typing.Optional[float] = None,
+        live: typing.Union[bool, typing.Callable[[], bool]] = False,
+        coerces: bool = False,
     ) -> None:
         self.name = name
         if dtype not in DTYPES:
@@ -140,6 +170,22 @@ class _Setting:
             else:
                 self._readonly = readonly
 
+        if volatile is None:
+            volatile = set_func is None
+        self.volatile = volatile
+        self.ttl = ttl
+        self._live = live
+        self.coerces = coerces
+        self._cache_lock = threading.Lock()
+        self._cached_value = _UNKNOWN
+        self._cache_expires = 0.0
+
+    def is_live(self) -> bool:
+        """Whether the setting can be set now without pausing."""
+        if callable(self._live):
+            return bool(self._live())
+        return bool(self._live)
+
     def describe(self):
         return {
             "type": self.dtype,
@@ -148,19 +194,90 @@ class _Setting:
             "cached": self._last_written is not None,
         }
 
+    def from_device(self, value):
+        """Convert a value returned by the getter function."""
+        if isinstance(self._values, EnumMeta):
+            return self._values(value).value
+        else:
+            return value
+
     def get(self):
         if self._get is not None:
             value = self._get()
         else:
             value = self._last_written
-        if isinstance(self._values, EnumMeta):
-            return self._values(value).value
+        return self.from_device(value)
+
+    def get_cached(self):
+        """Return the cached value, or `_UNKNOWN` if it's not valid."""
+        if self.volatile:
+            return _UNKNOWN
+        with self._cache_lock:
+            if time.monotonic() < self._cache_expires:
+                return self._cached_value
+        return _UNKNOWN
+
+    def update_cache(self, value) -> bool:
+        """Cache a new value and return whether it changed.
+
+        `value` is the current value as returned by :meth:`get`.  A
+        value seen for the first time is not a change.
+        """
+        if self.ttl is None:
+            expires = float("inf")
         else:
-            return value
+            expires = time.monotonic() + self.ttl
+        with self._cache_lock:
+            previous = self._cached_value
+            self._cached_value = value
+            self._cache_expires = expires
+        if previous is _UNKNOWN:
+            return False
+        try:
+            return bool(previous != value)
+        except Exception:
+            # Values that can't be compared, e.g., arrays.
+            return True
+
+    def invalidate_cache(self) -> None:
+        """Mark the cached value as not valid, but keep it to compare."""
+        with self._cache_lock:
+            self._cache_expires = 0.0
 
     def readonly(self) -> bool:
         return self._readonly()
 
+    def validate(self, value) -> None:
+        """Raise `ValueError` if value is not one of the allowed values.
+
+        Only the range of int and float, the keys of enum, and the
+        length of str settings are checked.  The allowed values may
+        depend on the current value of other settings.
+        """
+        if self.dtype not in ("int", "float", "enum", "str"):
+            return
+        values = self.values()
+        if values is None:
+            return
+        if self.dtype in ("int", "float"):
+            if len(values) == 2 and None not in values:
+                if not values[0] <= value <= values[1]:
+                    raise ValueError(
+                        "value for '%s' must be in [%s, %s] (was %s)"
+                        % (self.name, values[0], values[1], value)
+                    )
+        elif self.dtype == "enum":
+            if value not in [key for key, _ in values]:
+                raise ValueError(
+                    "value for '%s' must be one of %s (was %s)"
+                    % (self.name, [key for key, _ in values], value)
+                )
+        elif len(value) > values:
+            raise ValueError(
+                "value for '%s' must have at most %d characters"
+                % (self.name, values)
+            )
+
     def set(self, value) -> None:
         """Set a setting."""
         if self._set is None:
@@ -221,9 +338,40 @@ class FloatingDeviceMixin(metaclass=abc.ABCMeta):
         pass
 
 
+class _TriggerSequence:
+    """Values to apply on each software trigger, for `queue_sequence`."""
+
+    def __init__(self, steps: typing.Sequence, repeat: bool) -> None:
+        self._steps = list(steps)
+        self._repeat = repeat
+        self._index = 0
+        self._lock = threading.Lock()
+
+    def next(self):
+        """Return the next step, or `_UNKNOWN` if there are no more."""
+        with self._lock:
+            if self._index == len(self._steps):
+                if not self._repeat:
+                    return _UNKNOWN
+                self._index = 0
+            step = self._steps[self._index]
+            self._index += 1
+            return step
+
+
 class TriggerTargetMixin(metaclass=abc.ABCMeta):
     """Mixin for a device that may be the target of a hardware trigger.
 
+    A sequence of values, e.g., power levels of a light source, can
+    be queued with :meth:`queue_sequence` so that each trigger
+    applies the next value without a call from the client.  Devices
+    that support sequences in hardware implement
+    `_do_queue_sequence`, otherwise the device applies each value on
+    :meth:`trigger` (the `_apply_sequence_step` method) before the
+    usual trigger (`_do_trigger`).  Device types whose value is the
+    whole effect of the trigger, e.g., the pattern of a deformable
+    mirror, set `_trigger_after_sequence_step` to `False`.
+
     .. todo::
 
         Need some way to retrieve the supported trigger types and
@@ -233,6 +381,15 @@ class TriggerTargetMixin(metaclass=abc.ABCMeta):
 
     """
 
+    # Whether a software trigger, after applying the next value of a
+    # sequence, also has its usual effect.
+    _trigger_after_sequence_step = True
+
+    def __init__(self, **kwargs) -> None:
+        super().__init__(**kwargs)
+        # Values to apply on each software trigger, if any.
+        self._trigger_sequence: typing.Optional[_TriggerSequence] = None
+
     @property
     @abc.abstractmethod
     def trigger_mode(self) -> microscope.TriggerMode:
@@ -280,15 +437,151 @@ class TriggerTargetMixin(metaclass=abc.ABCMeta):
                 "trigger type is not software"
             )
         _logger.debug("trigger by software")
+        sequence = self._trigger_sequence
+        if sequence is not None:
+            step = sequence.next()
+            if step is _UNKNOWN:
+                self._trigger_sequence = None
+            else:
+                self._apply_sequence_step(step)
+                if not self._trigger_after_sequence_step:
+                    return
         self._do_trigger()
 
+    def _do_queue_sequence(
+        self, sequence: typing.Sequence, repeat: bool
+    ) -> None:
+        """Send a sequence to the device, to apply on hardware triggers.
+
+        Devices that support sequences in hardware should implement
+        this method.  Raise `NotImplementedError` to use the software
+        fallback instead, e.g., if the trigger type is software.
+        """
+        raise NotImplementedError()
+
+    def _apply_sequence_step(self, step) -> None:
+        """Apply one value of a sequence, on a software trigger.
+
+        Device types that support sequences should implement this
+        method, e.g., a light source sets its power.
+        """
+        raise NotImplementedError()
+
+    def queue_sequence(
+        self, sequence: typing.Sequence, repeat: bool = False
+    ) -> None:
+        """Queue values to apply on each of the next triggers.
+
+        What the values of the sequence are depends on the device
+        type, e.g., power levels for a light source, or patterns for a
+        deformable mirror.  If the device supports it, the sequence is
+        sent to the hardware and advanced by hardware triggers.
+        Otherwise, each call to :meth:`trigger` applies the next
+        value, which saves sending them from the client.  Once all
+        values have been applied, `trigger` has its usual effect.
+
+        Args:
+            sequence: values to apply, one per trigger.
+            repeat: start again from the first value after the last.
+
+        Raises:
+            microscope.IncompatibleStateError: if the device does not
+                support sequences in hardware and the trigger type is
+                not software.
+            microscope.UnsupportedFeatureError: if the device type
+                does not support sequences.
+
+        """
+        sequence = list(sequence)
+        if not sequence:
+            raise ValueError("sequence has no values")
+        self._trigger_sequence = None
+        try:
+            self._do_queue_sequence(sequence, repeat)
+            return
+        except NotImplementedError:
+            pass
+        if type(self)._apply_sequence_step is (
+            TriggerTargetMixin._apply_sequence_step
+        ):
+            raise microscope.UnsupportedFeatureError(
+                "%s does not support sequences" % type(self).__name__
+            )
+        if self.trigger_type is not microscope.TriggerType.SOFTWARE:
+            raise microscope.IncompatibleStateError(
+                "sequences on this device require software trigger type"
+            )
+        self._trigger_sequence = _TriggerSequence(sequence, repeat)
+
+    def clear_sequence(self) -> None:
+        """Stop applying the values queued with :meth:`queue_sequence`."""
+        self._trigger_sequence = None
+        self._do_clear_sequence()
+
+    def _do_clear_sequence(self) -> None:
+        """Clear a sequence sent to the hardware, if any."""
+        pass
+
+
+def _observe_setting_call(func):
+    """Wrapper to observe the time of calls to settings methods.
+
+    Only the outermost call is observed, so nested calls, e.g.,
+    `get_setting` during `update_settings`, are not counted twice.
+    """
+
+    @functools.wraps(func)
+    def wrapper(self, *args, **kwargs):
+        if getattr(self._setting_call_local, "active", False):
+            return func(self, *args, **kwargs)
+        self._setting_call_local.active = True
+        start = time.perf_counter()
+        try:
+            return func(self, *args, **kwargs)
+        finally:
+            self._setting_call_local.active = False
+            self._setting_call_seconds.labels(func.__name__).observe(
+                time.perf_counter() - start
+            )
+
+    return wrapper
+
 
 class Device(metaclass=abc.ABCMeta):
-    """A base device class. All devices should subclass this class."""
+    """A base device class. All devices should subclass this class.
+
+    Devices keep metrics of their operation, such as the time taken
+    by calls to settings methods, in `_metrics` (see
+    :mod:`microscope._metrics`).  Clients get them with
+    :meth:`get_metrics`.
+
+    Settings values are cached (see :class:`_Setting`) and clients
+    can be notified of changes instead of polling them, see
+    :meth:`add_settings_listener`.  Implementations whose SDK reports
+    changes of settings, e.g., on a callback, should pass the new
+    values to :meth:`_settings_changed`.
+
+    """
 
     def __init__(self) -> None:
         self.enabled = False
         self._settings: typing.Dict[str, _Setting] = {}
+        self._metrics = microscope._metrics.Metrics()
+        self._setting_call_seconds = self._metrics.histogram(
+            "setting_call_seconds",
+            "Time to handle calls to settings methods.",
+            labelnames=("method",),
+        )
+        self._setting_call_local = threading.local()
+        self._setting_cache_reads = self._metrics.counter(
+            "setting_cache_reads_total",
+            "Settings read by get_all_settings, by cache result.",
+            labelnames=("result",),
+        )
+        self._settings_listeners: typing.List = []
+        self._settings_listeners_lock = threading.Lock()
+        self._settings_changes: queue.Queue = queue.Queue()
+        self._settings_notifier: typing.Optional[threading.Thread] = None
 
     def __del__(self) -> None:
         self.shutdown()
@@ -296,6 +589,17 @@ class Device(metaclass=abc.ABCMeta):
     def get_is_enabled(self) -> bool:
         return self.enabled
 
+    def get_metrics(
+        self,
+    ) -> typing.Dict[str, microscope._metrics.MetricSnapshot]:
+        """Return the current value of all metrics of this device.
+
+        The returned mapping of metric names to
+        :class:`microscope._metrics.MetricSnapshot` can be formatted
+        for Prometheus with :func:`microscope._metrics.format_prometheus`.
+        """
+        return self._metrics.snapshot()
+
     def _do_disable(self):
         """Do any device-specific work on disable.
 
@@ -309,6 +613,7 @@ class Device(metaclass=abc.ABCMeta):
         """Disable the device for a short period for inactivity."""
         self._do_disable()
         self.enabled = False
+        self._invalidate_settings_cache()
 
     def _do_enable(self):
         """Do any device specific work on enable.
@@ -325,6 +630,7 @@ class Device(metaclass=abc.ABCMeta):
             self.enabled = self._do_enable()
         except Exception as err:
             _logger.debug("Error in _do_enable:", exc_info=err)
+        self._invalidate_settings_cache()
 
     @abc.abstractmethod
     def _do_shutdown(self) -> None:
@@ -395,6 +701,8 @@ class Device(metaclass=abc.ABCMeta):
             _logger.warning("Exception in disable() during shutdown: %s", e)
         _logger.info("Shutting down ... ... ...")
         self._do_shutdown()
+        if getattr(self, "_settings_notifier", None) is not None:
+            self._settings_changes.put((None, None))
         _logger.info("... ... ... ... shut down completed.")
 
     def add_setting(
@@ -405,6 +713,10 @@ class Device(metaclass=abc.ABCMeta):
         set_func,
         values,
         readonly: typing.Optional[typing.Callable[[], bool]] = None,
+        volatile: typing.Optional[bool] = None,
+        ttl: typing.Optional[float] = None,
+        live: typing.Union[bool, typing.Callable[[], bool]] = False,
+        coerces: bool = False,
     ) -> None:
         """Add a setting definition.
 
@@ -422,6 +734,24 @@ class Device(metaclass=abc.ABCMeta):
                 indicate its current state.  If set to no `None`
                 (default), then its value will be dependent on the
                 value of `set_func`.
+            volatile: whether the value may change without being
+                set, e.g., a temperature reading, in which case
+                `get_all_settings` always reads it from the device.
+                If `None` (default), settings without `set_func` are
+                volatile.
+            ttl: time, in seconds, for which a cached value is
+                valid.  If `None` (default), it is valid until a
+                setting is set or the device is enabled or disabled.
+                Use this for values that may also be changed on the
+                hardware, e.g., on a front panel.
+            live: whether a :class:`DataDevice` can set it during
+                acquisition without stopping the acquisition, or a
+                function that returns whether it can be set now, e.g.,
+                because the hardware reports the feature writable.
+            coerces: whether the device may take a different value
+                than the one set, e.g., the nearest exposure time it
+                supports.  If so, the value is read back after being
+                set to notify the settings listeners.
 
         A client needs some way of knowing a setting name and data
         type, retrieving the current value and, if settable, a way to
@@ -442,30 +772,185 @@ class Device(metaclass=abc.ABCMeta):
             )
         else:
             self._settings[name] = _Setting(
-                name, dtype, get_func, set_func, values, readonly
+                name,
+                dtype,
+                get_func,
+                set_func,
+                values,
+                readonly,
+                volatile=volatile,
+                ttl=ttl,
+                live=live,
+                coerces=coerces,
             )
 
+    def _read_setting(self, name: str):
+        """Read a setting from the device and update its cache."""
+        value = self._settings[name].get()
+        if self._settings[name].update_cache(value):
+            self._notify_settings(None, {name: value})
+        return value
+
+    def _invalidate_settings_cache(self) -> None:
+        """Mark cached values of all settings as not valid.
+
+        Setting one value may change others, e.g., the exposure time
+        may change with the readout mode, so all are invalidated.
+        """
+        for setting in self._settings.values():
+            setting.invalidate_cache()
+
+    def _refresh_settings_cache(self) -> None:
+        """Read the settings whose cached value is not valid.
+
+        Methods other than :meth:`set_setting`, e.g.,
+        `set_exposure_time`, only invalidate the cache when they
+        change a setting.  This reads those settings again so that
+        the settings listeners are notified of their new values.
+        Volatile settings, which are always read, are skipped.
+        """
+        for name, setting in self._settings.items():
+            if setting.volatile or setting.get_cached() is not _UNKNOWN:
+                continue
+            try:
+                self._read_setting(name)
+            except Exception as err:
+                _logger.debug("failed to refresh %s: %s", name, err)
+
+    def _settings_changed(self, changes: typing.Mapping) -> None:
+        """Update the cache with new values reported by the device.
+
+        Args:
+            changes: map of setting names to their new values, as
+                returned by the setting getter function.
+
+        Listeners are notified of the values that changed.
+        """
+        changed = {}
+        for name, value in changes.items():
+            setting = self._settings[name]
+            value = setting.from_device(value)
+            if setting.update_cache(value):
+                changed[name] = value
+        if changed:
+            self._notify_settings(None, changed)
+
+    def _notify_settings(self, listener, changes) -> None:
+        # A listener of None means all listeners.
+        if self._settings_listeners or listener is not None:
+            self._settings_changes.put((listener, changes))
+
+    def _notify_settings_loop(self) -> None:
+        while True:
+            listener, changes = self._settings_changes.get()
+            if changes is None:
+                return
+            if listener is not None:
+                listeners = [listener]
+            else:
+                with self._settings_listeners_lock:
+                    listeners = list(self._settings_listeners)
+            for listener in listeners:
+                try:
+                    listener.settings_changed(changes)
+                except (
+                    Pyro4.errors.ConnectionClosedError,
+                    Pyro4.errors.CommunicationError,
+                ):
+                    _logger.info(
+                        "Removing settings listener %s: disconnected.",
+                        str(listener),
+                    )
+                    self._remove_settings_listener(listener)
+                except Exception as err:
+                    _logger.error(
+                        "failed to notify %s of settings changes",
+                        str(listener),
+                        exc_info=err,
+                    )
+
+    def add_settings_listener(self, listener) -> None:
+        """Notify a listener of changes to the settings values.
+
+        The listener `settings_changed` method is called with a map
+        of setting names to their new values, first with the values
+        of all settings and then with the values that change.  Calls
+        are made from a separate thread, in order.
+
+        Changes are noticed when a setting is set, when it's read
+        from the device, e.g., in `get_all_settings` after its cached
+        value expired, and when the device reports them.
+
+        Args:
+            listener: an object with a `settings_changed` method, or
+                its Pyro URI.
+
+        """
+        if isinstance(listener, (str, Pyro4.core.URI)):
+            listener = Pyro4.Proxy(listener)
+        snapshot = self.get_all_settings()
+        with self._settings_listeners_lock:
+            if listener not in self._settings_listeners:
+                self._settings_listeners.append(listener)
+            if self._settings_notifier is None:
+                self._settings_notifier = threading.Thread(
+                    target=self._notify_settings_loop,
+                    name="settings-notifier",
+                    daemon=True,
+                )
+                self._settings_notifier.start()
+        self._notify_settings(listener, snapshot)
+
+    def remove_settings_listener(self, listener) -> None:
+        """Stop notifying a listener added with `add_settings_listener`."""
+        if isinstance(listener, (str, Pyro4.core.URI)):
+            listener = Pyro4.Proxy(listener)
+        if not self._remove_settings_listener(listener):
+            raise ValueError("%s is not a settings listener" % str(listener))
+
+    def _remove_settings_listener(self, listener) -> bool:
+        with self._settings_listeners_lock:
+            try:
+                self._settings_listeners.remove(listener)
+            except ValueError:
+                return False
+        return True
+
+    @_observe_setting_call
     def get_setting(self, name: str):
         """Return the current value of a setting."""
         try:
-            return self._settings[name].get()
+            return self._read_setting(name)
         except Exception as err:
             _logger.error("in get_setting(%s):", name, exc_info=err)
             raise
 
+    @_observe_setting_call
     def get_all_settings(self):
-        """Return ordered settings as a list of dicts."""
+        """Return ordered settings as a list of dicts.
+
+        Values are served from the cache and only volatile settings,
+        or those whose cached value is no longer valid, are read from
+        the device.  Use :meth:`get_setting` to always read a value
+        from the device.
+        """
         # Fetching some settings may fail depending on device state.
         # Report these values as 'None' and continue fetching other settings.
-        def catch(f):
+        def catch(name, setting):
+            value = setting.get_cached()
+            if value is not _UNKNOWN:
+                self._setting_cache_reads.labels("hit").inc()
+                return value
+            self._setting_cache_reads.labels("miss").inc()
             try:
-                return f()
+                return self._read_setting(name)
             except Exception as err:
-                _logger.error("getting %s: %s", f.__self__.name, err)
+                _logger.error("getting %s: %s", name, err)
                 return None
 
-        return {k: catch(v.get) for k, v in self._settings.items()}
+        return {k: catch(k, v) for k, v in self._settings.items()}
 
+    @_observe_setting_call
     def set_setting(self, name: str, value) -> None:
         """Set a setting."""
         try:
@@ -473,6 +958,20 @@ class Device(metaclass=abc.ABCMeta):
         except Exception as err:
             _logger.error("in set_setting(%s):", name, exc_info=err)
             raise
+        finally:
+            self._invalidate_settings_cache()
+        if self._settings_listeners:
+            setting = self._settings[name]
+            if setting.volatile or setting.coerces:
+                # Read it back, it may differ from the value set.
+                try:
+                    self._read_setting(name)
+                except Exception as err:
+                    _logger.error(
+                        "reading %s after set:", name, exc_info=err
+                    )
+            else:
+                self._settings_changed({name: value})
 
     def describe_setting(self, name: str):
         """Return ordered setting descriptions as a list of dicts."""
@@ -482,61 +981,784 @@ class Device(metaclass=abc.ABCMeta):
         """Return ordered setting descriptions as a list of dicts."""
         return [(k, v.describe()) for (k, v) in self._settings.items()]
 
+    @_observe_setting_call
     def update_settings(self, incoming, init: bool = False):
-        """Update settings based on dict of settings and values."""
+        """Update multiple settings at once.
+
+        Settings are set in the order of `incoming` so that settings
+        whose allowed values depend on others, e.g., the exposure time
+        on the readout mode, can be given after them.  Unknown
+        settings are reported before any setting is changed, and each
+        value is validated, against the allowed values at that time,
+        just before it is set.  Readonly settings are not set.
+
+        This is the preferred way to reconfigure a device, namely a
+        :class:`DataDevice` which only pauses and resumes acquisition
+        once for all settings instead of once per setting.
+
+        Args:
+            incoming: map of setting names to their new values.
+            init: if `True`, `incoming` must have all settings, and
+                all are set.  Otherwise, only settings with a value
+                different from the current value are set.
+
+        Returns:
+            A map of the setting names to their values after the
+            update.  The value of unknown settings is
+            `NotImplemented`.
+
+        """
         if init:
-            # Assume nothing about state: set everything.
-            my_keys = set(self._settings.keys())
-            their_keys = set(incoming.keys())
-            update_keys = my_keys & their_keys
-            if update_keys != my_keys:
-                missing = ", ".join([k for k in my_keys - their_keys])
-                msg = (
-                    "update_settings init=True but missing keys: %s." % missing
+            missing = set(self._settings.keys()) - set(incoming.keys())
+            if missing:
+                msg = "update_settings init=True but missing keys: %s." % (
+                    ", ".join(missing)
                 )
                 _logger.debug(msg)
                 raise Exception(msg)
-        else:
-            # Only update changed values.
-            my_keys = set(self._settings.keys())
-            their_keys = set(incoming.keys())
-            update_keys = set(
-                key
-                for key in my_keys & their_keys
-                if self.get_setting(key) != incoming[key]
-            )
         results = {}
-        # Update values.
-        for key in update_keys:
-            if key not in my_keys or not self._settings[key].set:
-                # Setting not recognised or no set function implemented
+        known = []
+        for key in incoming.keys():
+            if key in self._settings:
+                known.append(key)
+            else:
                 results[key] = NotImplemented
-                update_keys.remove(key)
-                continue
-            if self._settings[key].readonly():
+        applied = []
+        for key in known:
+            setting = self._settings[key]
+            value = incoming[key]
+            if setting.readonly() or (not init and setting.get() == value):
                 continue
-            self._settings[key].set(incoming[key])
-        # Read back values in second loop.
-        for key in update_keys:
-            results[key] = self._settings[key].get()
+            try:
+                setting.validate(value)
+                setting.set(value)
+            except Exception as err:
+                _logger.error(
+                    "in update_settings, failed to set '%s' after setting %s",
+                    key,
+                    applied,
+                    exc_info=err,
+                )
+                raise
+            finally:
+                self._invalidate_settings_cache()
+            applied.append(key)
+        # Read back values once all are set since setting one may
+        # change the value of others.
+        for key in known:
+            results[key] = self._read_setting(key)
         return results
 
 
-def keep_acquiring(func):
-    """Wrapper to preserve acquiring state of data capture devices."""
+class FramePool:
+    """Pool of reusable arrays for acquired data.
+
+    Allocating a new array for each acquired frame, at high frame
+    rates and with large frames, causes latency spikes and memory
+    fragmentation.  Instead, devices can get an array from the pool
+    with :meth:`get` and the array is returned to the pool, by the
+    :class:`DataDevice` dispatch, once the data has been sent to the
+    client.
+
+    Arrays are kept by shape and dtype, and the pool may hold arrays
+    of different shapes at the same time.  Use :meth:`clear` to
+    discard all arrays when they are no longer useful, e.g., after a
+    change of ROI or binning.  Arrays that are out of the pool on
+    :meth:`clear` are not returned to it.
+
+    Devices that can send data without copying it, e.g., views of
+    the driver's own buffers, use :meth:`lend` to be told when the
+    data has been sent and the buffer can be given back to the
+    driver.  The :class:`DataDevice` dispatch copies lent data for
+    clients that may keep a reference to it.
+
+    Args:
+        max_free: maximum number of unused arrays kept for each shape
+            and dtype.
+        alignment: memory alignment, in bytes, of the arrays.
+
+    """
+
+    def __init__(self, max_free: int = 16, alignment: int = 64) -> None:
+        self._max_free = max_free
+        self._alignment = alignment
+        self._lock = threading.Lock()
+        self._free: typing.Dict[
+            typing.Tuple[typing.Tuple[int, ...], numpy.dtype],
+            typing.List[numpy.ndarray],
+        ] = {}
+        # Arrays currently out of the pool, by id.  We need to keep
+        # track of them to not put into the pool arrays that never
+        # came from it, and to not put back arrays taken before clear.
+        self._in_use: typing.Dict[int, numpy.ndarray] = {}
+        # Arrays lent by the device, by id, with their release
+        # function.  These are kept on clear.
+        self._lent: typing.Dict[
+            int, typing.Tuple[numpy.ndarray, typing.Callable[[], None]]
+        ] = {}
+
+    def _allocate(self, shape, dtype: numpy.dtype) -> numpy.ndarray:
+        nbytes = int(numpy.prod(shape)) * dtype.itemsize
+        raw = numpy.empty(nbytes + self._alignment, dtype=numpy.uint8)
+        offset = -raw.ctypes.data % self._alignment
+        return raw[offset : offset + nbytes].view(dtype).reshape(shape)
+
+    def get(self, shape, dtype) -> numpy.ndarray:
+        """Return an uninitialised, C contiguous and aligned, array."""
+        key = (tuple(shape), numpy.dtype(dtype))
+        with self._lock:
+            try:
+                array = self._free[key].pop()
+            except (KeyError, IndexError):
+                array = self._allocate(*key)
+            self._in_use[id(array)] = array
+        return array
 
+    def lend(self, array, release: typing.Callable[[], None]) -> None:
+        """Track an array that is not from the pool until it is sent.
+
+        Args:
+            array: the data, typically a view of a driver buffer.
+            release: function called, once, when the array is
+                released or discarded.  It is not put into the pool.
+        """
+        with self._lock:
+            self._lent[id(array)] = (array, release)
+
+    def is_lent(self, array) -> bool:
+        """Whether the array was lent with :meth:`lend`."""
+        with self._lock:
+            return self._lent.get(id(array), (None,))[0] is array
+
+    def _return_lent(self, array) -> bool:
+        """Call the release function of a lent array, if it's lent."""
+        with self._lock:
+            lent = self._lent.get(id(array), None)
+            if lent is None or lent[0] is not array:
+                return False
+            del self._lent[id(array)]
+        lent[1]()
+        return True
+
+    def release(self, array) -> None:
+        """Put array back into the pool to be reused.
+
+        Does nothing if the array did not come from the pool.
+        """
+        if self._return_lent(array):
+            return
+        with self._lock:
+            if self._in_use.pop(id(array), None) is not array:
+                return
+            free = self._free.setdefault((array.shape, array.dtype), [])
+            if len(free) < self._max_free:
+                free.append(array)
+
+    def discard(self, array) -> None:
+        """Drop array from the pool, e.g., because someone else keeps it.
+
+        Does nothing if the array did not come from the pool.  Lent
+        arrays are released since they can't be kept.
+        """
+        if self._return_lent(array):
+            return
+        with self._lock:
+            if self._in_use.get(id(array), None) is array:
+                del self._in_use[id(array)]
+
+    def copy_lent(self, array):
+        """Return a copy from the pool of a lent array and release it.
+
+        Arrays that were not lent are returned as they are.
+        """
+        if not self.is_lent(array):
+            return array
+        copy = self.get(array.shape, array.dtype)
+        numpy.copyto(copy, array)
+        self.release(array)
+        return copy
+
+    def clear(self) -> None:
+        """Drop all arrays, including those currently in use."""
+        with self._lock:
+            self._free.clear()
+            self._in_use.clear()
+
+
+class BufferArena:
+    """Acquisition buffers memory kept across changes of ROI or binning.
+
+    Cameras acquire into a set of buffers given to the driver.
+    Reallocating all of them on each change of ROI or binning takes
+    hundreds of milliseconds for large numbers of buffers.  Instead,
+    an arena keeps the memory of the largest buffers requested so far
+    and returns views of it for smaller buffers.  Memory is only
+    allocated when more, or larger, buffers are needed.
+
+    The views are only valid until the next :meth:`get`.  Unlike the
+    arrays from :class:`FramePool`, they are for the driver and
+    should not be sent to clients.
+
+    Args:
+        alignment: memory alignment, in bytes, of the buffers.
+
+    """
+
+    def __init__(self, alignment: int = 64) -> None:
+        self._alignment = alignment
+        self._blocks: typing.List[numpy.ndarray] = []
+        self._capacity = 0
+
+    @property
+    def capacity(self) -> int:
+        """Size, in bytes, of the largest buffer without reallocation."""
+        return self._capacity
+
+    def _allocate(self, nbytes: int) -> numpy.ndarray:
+        raw = numpy.empty(nbytes + self._alignment, dtype=numpy.uint8)
+        offset = -raw.ctypes.data % self._alignment
+        return raw[offset : offset + nbytes]
+
+    def get(self, count: int, nbytes: int) -> typing.List[numpy.ndarray]:
+        """Return `count` separate uint8 buffers of `nbytes` each."""
+        if nbytes > self._capacity:
+            _logger.debug("Growing buffer arena to %d bytes.", nbytes)
+            self._capacity = nbytes
+            self._blocks = []
+        while len(self._blocks) < count:
+            self._blocks.append(self._allocate(self._capacity))
+        return [block[:nbytes] for block in self._blocks[:count]]
+
+    def clear(self) -> None:
+        """Free the memory of all buffers."""
+        self._blocks = []
+        self._capacity = 0
+
+
+def _make_transform_view(lr: bool, ud: bool, rot: bool):
+    # The transform is a 90 degrees rotation, as numpy.rot90, followed
+    # by the flips.  A rotation is a transpose plus a row flip so it
+    # all reduces to a possible transpose and one step per axis.
+    row_step = -1 if rot != ud else 1
+    col_step = -1 if lr else 1
+
+    def transform_view(data: numpy.ndarray) -> numpy.ndarray:
+        if rot:
+            data = data.swapaxes(0, 1)
+        return data[::row_step, ::col_step]
+
+    return transform_view
+
+
+_TRANSFORM_VIEWS = {
+    transform: _make_transform_view(*transform)
+    for transform in itertools.product(*3 * [[False, True]])
+}
+
+
+def transform_view(data: numpy.ndarray, transform) -> numpy.ndarray:
+    """Return a view of data with a camera transform applied.
+
+    Args:
+        data: the data, with rows on the first axis and columns on
+            the second.
+        transform: a tuple of the (fliplr, flipud, rot90) flags, as
+            in :attr:`Camera.ALLOWED_TRANSFORMS`.
+
+    The view is not contiguous unless the transform does nothing.
+    """
+    return _TRANSFORM_VIEWS[tuple(bool(t) for t in transform)](data)
+
+
+def unpack_mono12packed(
+    data: numpy.ndarray, width: typing.Optional[int] = None
+) -> numpy.ndarray:
+    """Unpack rows of 12 bit packed pixels to a uint16 array.
+
+    In the Mono12Packed encoding, as used by GenICam and Andor SDK3,
+    each pair of pixels is packed into 3 bytes: the 8 high bits of
+    the first pixel, the 4 low bits of the first and second pixels
+    on the low and high nibble, and the 8 high bits of the second
+    pixel.
+
+    Args:
+        data: uint8 array with the packed bytes of each row on the
+            last axis.
+        width: number of pixels in each row.  Defaults to all the
+            pixels in the packed bytes.
+    """
+    data = numpy.asarray(data, dtype=numpy.uint8)
+    if width is None:
+        width = data.shape[-1] * 2 // 3
+    n_pairs = (width + 1) // 2
+    if data.shape[-1] < 3 * n_pairs:
+        # Rows with an odd number of pixels may be missing the last
+        # byte, which would only have the high bits of a pixel that
+        # does not exist.
+        padding = [(0, 0)] * (data.ndim - 1) + [
+            (0, 3 * n_pairs - data.shape[-1])
+        ]
+        data = numpy.pad(data, padding)
+    triplets = data[..., : 3 * n_pairs].reshape(
+        data.shape[:-1] + (n_pairs, 3)
+    )
+    high0 = triplets[..., 0].astype(numpy.uint16)
+    low = triplets[..., 1]
+    high1 = triplets[..., 2].astype(numpy.uint16)
+    unpacked = numpy.empty(data.shape[:-1] + (2 * n_pairs,), numpy.uint16)
+    unpacked[..., 0::2] = (high0 << 4) | (low & 0x0F)
+    unpacked[..., 1::2] = (high1 << 4) | (low >> 4)
+    return unpacked[..., :width]
+
+
+_UNPACKERS = {"Mono12Packed": unpack_mono12packed}
+
+
+def unpack_pixels(data: numpy.ndarray, encoding: str) -> numpy.ndarray:
+    """Unpack data from a camera that sends packed pixels.
+
+    Cameras that send their native pixel encoding set the
+    `pixel_encoding` field of :class:`microscope.FrameMetadata`.
+    This unpacks the data into one array element per pixel.
+
+    Raises:
+        ValueError: if the encoding is not known.
+    """
+    try:
+        unpacker = _UNPACKERS[encoding]
+    except KeyError:
+        raise ValueError("unknown pixel encoding '%s'" % encoding)
+    return unpacker(data)
+
+
+def _client_label(client) -> str:
+    """Name of a client for the metrics labels."""
+    if isinstance(client, Pyro4.Proxy):
+        return str(client._pyroUri)
+    if isinstance(client, _ProcessingStage):
+        return type(client.stage).__name__
+    return type(client).__name__
+
+
+def _client_has_method(client, name: str) -> bool:
+    """Whether a client, maybe a Pyro proxy, has a method.
+
+    `hasattr` on a Pyro proxy may connect to the client to get its
+    metadata, and it's true for any name if metadata is disabled.
+    Instead, check the methods of the proxy, which
+    :func:`_fetch_client_methods` got when the client was set.
+    """
+    if isinstance(client, Pyro4.Proxy):
+        return name in client._pyroMethods
+    return hasattr(client, name)
+
+
+def _fetch_client_methods(client) -> None:
+    """Get the methods of a Pyro proxy client, before sending it data.
+
+    A Pyro proxy only knows the methods of the remote object after
+    its first call, and never if Pyro metadata is disabled, so ask
+    for them explicitly.  Otherwise, the first data would be sent to
+    `receiveData` even if the client only has `put`.
+    """
+    if not isinstance(client, Pyro4.Proxy) or client._pyroMethods:
+        return
+    try:
+        client._pyroGetMetadata()
+    except Pyro4.errors.PyroError as ex:
+        _logger.warning(
+            "failed to get the methods of client %s: %s",
+            client._pyroUri,
+            ex,
+        )
+
+
+def keep_acquiring(
+    func=None, *, live: typing.Optional[typing.Callable] = None
+):
+    """Wrapper to preserve acquiring state of data capture devices.
+
+    The acquisition is stopped before calling the wrapped method, and
+    enabled again after.  Changes that the hardware accepts during
+    acquisition, e.g., the exposure time on some cameras, can skip
+    this with `live`, a function called with the device and the
+    arguments of the wrapped method, which returns whether the change
+    can be made now without stopping::
+
+        @keep_acquiring(live=lambda self, value: self._exposure_live())
+        def set_exposure_time(self, value):
+            ...
+
+    The wrapped method changes the device state so the cached values
+    of its settings are invalidated after the call.
+
+    """
+    if func is None:
+        return functools.partial(keep_acquiring, live=live)
+
+    @functools.wraps(func)
     def wrapper(self, *args, **kwargs):
-        if self._acquiring:
-            self.abort()
-            result = func(self, *args, **kwargs)
-            self._do_enable()
-        else:
-            result = func(self, *args, **kwargs)
+        try:
+            if self._acquiring and not (
+                live is not None and live(self, *args, **kwargs)
+            ):
+                self.abort()
+                result = func(self, *args, **kwargs)
+                self._do_enable()
+            else:
+                result = func(self, *args, **kwargs)
+        finally:
+            self._invalidate_settings_cache()
         return result
 
     return wrapper
 
 
+class _ProcessingStage:
+    """Local client that calls a processing stage with the data.
+
+    Processing stages compare equal to the function they wrap so that
+    they can be found in the subscribers by that function.  Errors
+    sent by the device are logged instead of passed to the stage.
+    """
+
+    def __init__(self, stage: typing.Callable) -> None:
+        self.stage = stage
+
+    def __eq__(self, other) -> bool:
+        if isinstance(other, _ProcessingStage):
+            other = other.stage
+        return self.stage == other
+
+    def __hash__(self) -> int:
+        return hash(self.stage)
+
+    def __str__(self) -> str:
+        return "processing stage %s" % str(self.stage)
+
+    # noinspection PyPep8Naming
+    def receiveData(self, data, timestamp, metadata=None) -> None:
+        if isinstance(data, Exception):
+            _logger.error("not processing error from device: %s", data)
+            return
+        self.stage(data, timestamp, metadata)
+
+
+class _Subscriber:
+    """A client that gets all data via its own queue and thread.
+
+    The device puts the data on the subscriber queue, following the
+    drop policy if the queue is full, and the subscriber thread sends
+    it to the client.  This way, a slow client only delays itself.
+
+    Args:
+        device: the device sending data.
+        client: the client receiving data.
+        drop_policy: what to do if the queue is full.
+        queue_size: maximum number of data in the queue.  Ignored for
+            `DropPolicy.LATEST_ONLY`.
+        max_rate: if not `None`, maximum number of data per second to
+            send.  Of the data arriving faster than that, only the
+            latest is kept and sent when the interval expires.
+        max_size: if not `None`, images larger than this, on any
+            side, are decimated to fit, i.e., only every n-th pixel
+            is sent on both axes.
+
+    """
+
+    # Put on the queue to stop the subscriber thread.
+    _STOP = None
+
+    def __init__(
+        self,
+        device: "DataDevice",
+        client,
+        drop_policy: microscope.DropPolicy,
+        queue_size: int,
+        max_rate: typing.Optional[float] = None,
+        max_size: typing.Optional[int] = None,
+    ) -> None:
+        if drop_policy == microscope.DropPolicy.LATEST_ONLY:
+            queue_size = 1
+        elif queue_size < 1:
+            raise ValueError("queue size must be positive")
+        if max_rate is not None and max_rate <= 0:
+            raise ValueError("max rate must be positive")
+        if max_size is not None and max_size < 1:
+            raise ValueError("max size must be positive")
+        self._device = device
+        self.client = client
+        self.drop_policy = drop_policy
+        self._min_interval = 0.0 if max_rate is None else 1.0 / max_rate
+        self._last_put = -float("inf")
+        # Latest data that arrived too soon after the previous one,
+        # and the timer that puts it on the queue.
+        self._pending = None
+        self._pending_timer: typing.Optional[threading.Timer] = None
+        self._pending_lock = threading.Lock()
+        self._max_size = max_size
+        # Number of data dropped because the queue was full or
+        # because of the maximum rate.
+        self.dropped = 0
+        self._running = True
+        self._queue = queue.Queue(maxsize=queue_size)
+        self._thread = Thread(target=self._run)
+        self._thread.daemon = True
+        self._thread.start()
+
+    def _count_dropped(self) -> None:
+        self.dropped += 1
+        self._device._data_dropped_total.labels(
+            _client_label(self.client)
+        ).inc()
+
+    def _put_dropping_oldest(self, item) -> None:
+        while True:
+            try:
+                self._queue.put_nowait(item)
+                return
+            except queue.Full:
+                pass
+            try:
+                self._queue.get_nowait()
+            except queue.Empty:
+                continue
+            if item is not self._STOP:
+                self._count_dropped()
+
+    def put(self, item) -> None:
+        """Put an item, a tuple as in the dispatch buffer, on the queue."""
+        if self._min_interval:
+            with self._pending_lock:
+                now = time.monotonic()
+                wait = self._last_put + self._min_interval - now
+                if wait > 0:
+                    # Keep only the latest so that the last data of a
+                    # burst is not lost.
+                    if self._pending is not None:
+                        self._count_dropped()
+                    self._pending = item
+                    if self._pending_timer is None:
+                        self._pending_timer = threading.Timer(
+                            wait, self._put_pending
+                        )
+                        self._pending_timer.daemon = True
+                        self._pending_timer.start()
+                    return
+                self._last_put = now
+        self._enqueue(item)
+
+    def _put_pending(self) -> None:
+        with self._pending_lock:
+            item = self._pending
+            self._pending = None
+            self._pending_timer = None
+            if item is not None and self._running:
+                self._last_put = time.monotonic()
+                self._enqueue(item)
+
+    def _enqueue(self, item) -> None:
+        if self.drop_policy == microscope.DropPolicy.BLOCK:
+            # Check once in a while if we have been closed so that
+            # we don't block forever.
+            while self._running:
+                try:
+                    self._queue.put(item, timeout=0.1)
+                    return
+                except queue.Full:
+                    continue
+        elif self.drop_policy == microscope.DropPolicy.DROP_NEWEST:
+            try:
+                self._queue.put_nowait(item)
+            except queue.Full:
+                self._count_dropped()
+        else:
+            self._put_dropping_oldest(item)
+
+    def _decimate(self, item):
+        client, data, timestamp, metadata = item
+        if isinstance(data, numpy.ndarray) and data.ndim >= 2:
+            step = -(-max(data.shape[:2]) // self._max_size)
+            if step > 1:
+                data = data[::step, ::step]
+        return (client, data, timestamp, metadata)
+
+    def _run(self) -> None:
+        while True:
+            items = self._device._get_dispatch_items(self._queue)
+            stop = self._STOP in items
+            if stop:
+                # The items in front of the stop are still sent if
+                # draining, even if they come in the same batch.
+                items = items[: items.index(self._STOP)]
+                if not self._running:
+                    items = []
+            if items:
+                if self._max_size is not None:
+                    items = [self._decimate(item) for item in items]
+                self._device._dispatch_items(items, subscriber=True)
+            if stop:
+                return
+
+    def close(self, drain: bool = False) -> None:
+        """Stop the subscriber thread.
+
+        Args:
+            drain: if `True`, wait for the data still in the queue to
+                be sent.  Otherwise, that data is dropped.
+        """
+        if not drain:
+            self._running = False
+        with self._pending_lock:
+            if self._pending_timer is not None:
+                self._pending_timer.cancel()
+                self._pending_timer = None
+            pending = self._pending
+            self._pending = None
+        if drain:
+            if pending is not None:
+                self._enqueue(pending)
+            self._queue.put(self._STOP)
+            self._thread.join()
+            self._running = False
+        else:
+            self._put_dropping_oldest(self._STOP)
+
+
+class _DispatchBuffer:
+    """Queue of items to dispatch, bounded by length and by memory.
+
+    This has the subset of the :class:`queue.Queue` interface used by
+    the dispatch loop.  Items are tuples as in the dispatch buffer and
+    their size is the number of bytes of their data.  When the buffer
+    is full, the overflow policy defines what happens to new items.
+    A single item larger than the memory budget is still accepted if
+    the buffer is empty, otherwise it would never be.
+
+    Dropped items are passed to `on_drop`, and the number of dropped
+    data is added to the `dropped_frames` of the metadata of the next
+    item that leaves the buffer after the gap, so that the client
+    learns of the loss.
+
+    Args:
+        max_length: maximum number of items.  Zero for no limit.
+        max_bytes: maximum number of bytes of data.  Zero for no
+            limit.
+        overflow_policy: what to do with new items when full.
+            `DropPolicy.LATEST_ONLY` keeps a single item.
+        on_drop: function called with each dropped item.
+
+    """
+
+    def __init__(
+        self,
+        max_length: int = 0,
+        max_bytes: int = 0,
+        overflow_policy: microscope.DropPolicy = microscope.DropPolicy.BLOCK,
+        on_drop: typing.Optional[typing.Callable[[typing.Any], None]] = None,
+    ) -> None:
+        if max_length < 0 or max_bytes < 0:
+            raise ValueError("buffer length and size can't be negative")
+        if overflow_policy == microscope.DropPolicy.LATEST_ONLY:
+            max_length = 1
+            overflow_policy = microscope.DropPolicy.DROP_OLDEST
+        self._max_length = max_length
+        self._max_bytes = max_bytes
+        self._overflow_policy = overflow_policy
+        self._on_drop = on_drop
+        self._items: typing.Deque = collections.deque()
+        self._nbytes = 0
+        # Number of data dropped before the oldest item, i.e., before
+        # the next item to be got (DROP_OLDEST), and before the next
+        # item to be put (DROP_NEWEST).
+        self._dropped_before_head = 0
+        self._dropped_before_next = 0
+        self._condition = threading.Condition()
+
+    @staticmethod
+    def _item_nbytes(item) -> int:
+        data = item[1]
+        return data.nbytes if isinstance(data, numpy.ndarray) else 0
+
+    @staticmethod
+    def _add_dropped(item, n_dropped: int):
+        client, data, timestamp, metadata = item
+        if n_dropped and metadata is not None:
+            metadata = metadata._replace(
+                dropped_frames=(metadata.dropped_frames or 0) + n_dropped
+            )
+        return (client, data, timestamp, metadata)
+
+    def _is_full(self, nbytes: int) -> bool:
+        if not self._items:
+            return False
+        if self._max_length and len(self._items) >= self._max_length:
+            return True
+        if self._max_bytes and self._nbytes + nbytes > self._max_bytes:
+            return True
+        return False
+
+    def _drop(self, item) -> int:
+        """Drop an item and return the number of data dropped.
+
+        This includes the data that had already been dropped before
+        it, which would otherwise go unreported.
+        """
+        if self._on_drop is not None:
+            self._on_drop(item)
+        if isinstance(item[1], Exception):
+            return 0
+        return 1 + ((item[3] and item[3].dropped_frames) or 0)
+
+    def qsize(self) -> int:
+        return len(self._items)
+
+    @property
+    def nbytes(self) -> int:
+        """Number of bytes of data in the buffer."""
+        return self._nbytes
+
+    def put(self, item) -> None:
+        nbytes = self._item_nbytes(item)
+        with self._condition:
+            if self._overflow_policy == microscope.DropPolicy.BLOCK:
+                while self._is_full(nbytes):
+                    self._condition.wait()
+            elif self._overflow_policy == microscope.DropPolicy.DROP_NEWEST:
+                if self._is_full(nbytes):
+                    self._dropped_before_next += self._drop(item)
+                    return
+                item = self._add_dropped(item, self._dropped_before_next)
+                self._dropped_before_next = 0
+            else:
+                while self._is_full(nbytes):
+                    oldest = self._items.popleft()
+                    self._nbytes -= self._item_nbytes(oldest)
+                    self._dropped_before_head += self._drop(oldest)
+            self._items.append(item)
+            self._nbytes += nbytes
+            self._condition.notify_all()
+
+    def get(self, block: bool = True, timeout: typing.Optional[float] = None):
+        with self._condition:
+            if not block:
+                if not self._items:
+                    raise queue.Empty
+            elif not self._condition.wait_for(
+                lambda: self._items, timeout=timeout
+            ):
+                raise queue.Empty
+            item = self._items.popleft()
+            self._nbytes -= self._item_nbytes(item)
+            item = self._add_dropped(item, self._dropped_before_head)
+            self._dropped_before_head = 0
+            self._condition.notify_all()
+            return item
+
+    def get_nowait(self):
+        return self.get(block=False)
+
+
 class DataDevice(Device, metaclass=abc.ABCMeta):
     """A data capture device.
 
@@ -548,42 +1770,254 @@ class DataDevice(Device, metaclass=abc.ABCMeta):
 
     * :meth:`abort` (required)
     * :meth:`_fetch_data` (required)
+    * :meth:`_wait_for_data` (optional but recommended)
     * :meth:`_process_data` (optional)
 
+    Derived classes should get the arrays for the acquired data from
+    `_frame_pool` (see :class:`FramePool`) instead of allocating new
+    arrays for each frame.
+
+    Clients which have a `receiveDataBatch` method can receive
+    multiple data in a single call, stacked on a new first axis,
+    together with a list of their timestamps.  This reduces the
+    overhead per data for high frame rates and is configured with the
+    "dispatch batch size" and "dispatch batch timeout" settings.
+    Other clients, such as Cockpit, keep receiving data one at a time.
+
+    Acquired data waits in a dispatch buffer to be sent to the client.
+    By default, the buffer has no limit which means that a client
+    that can't keep up makes the buffer grow until the computer runs
+    out of memory.  The buffer can be limited by number of data, with
+    `buffer_length`, and by memory, with `buffer_max_bytes`.  When the
+    buffer is full, `buffer_overflow_policy` defines whether the fetch
+    of new data waits for space (`DropPolicy.BLOCK`), or data is
+    dropped (`DropPolicy.DROP_OLDEST` or `DropPolicy.DROP_NEWEST`).
+    The number of data dropped is added to the `dropped_frames`
+    metadata of the next data sent and to the `data_dropped_total`
+    metric.
+
     Derived classes may override `__init__`, `enable` and `disable`,
     but must ensure to call this class's implementations as indicated
     in the docstrings.
 
     """
 
-    def __init__(self, buffer_length: int = 0, **kwargs) -> None:
+    def __init__(
+        self,
+        buffer_length: int = 0,
+        buffer_max_bytes: int = 0,
+        buffer_overflow_policy: microscope.DropPolicy = (
+            microscope.DropPolicy.BLOCK
+        ),
+        **kwargs,
+    ) -> None:
         """Derived.__init__ must call this at some point."""
         super().__init__(**kwargs)
         # A thread to fetch and dispatch data.
         self._fetch_thread = None
         # A flag to control the _fetch_thread.
         self._fetch_thread_run = False
+        # Maximum time, in seconds, that the fetch loop waits for new
+        # data before checking if it should stop.
+        self._fetch_wait_timeout = 0.1
         # A flag to indicate that this class uses a fetch callback.
         self._using_callback = False
         # Clients to which we send data.
         self._clientStack = []
         # A set of live clients to avoid repeated dispatch to disconnected client.
         self._liveClients = set()
+        # Map of clients that receive data via shared memory to their
+        # ring.  The ring is only created when the first data is sent
+        # since that's when we know the size of the slots.
+        self._shared_memory_rings: typing.Dict[
+            typing.Any,
+            typing.Optional[microscope._shared_memory.SharedMemoryRing],
+        ] = {}
+        self._shared_memory_lock = threading.Lock()
+        # Clients that receive a FrameMetadata with the data.
+        self._metadata_clients = set()
+        # Map of clients to their _Subscriber, for clients that get
+        # all data regardless of the client stack.
+        self._subscribers: typing.Dict[typing.Any, _Subscriber] = {}
+        self._subscribers_lock = threading.Lock()
+        # Frame number of the last data with a frame number, to
+        # compute the number of dropped frames.
+        self._last_frame_number = None
         # A thread to dispatch data.
         self._dispatch_thread = None
         # A buffer for data dispatch.
-        self._dispatch_buffer = queue.Queue(maxsize=buffer_length)
+        self._dispatch_buffer = _DispatchBuffer(
+            buffer_length,
+            buffer_max_bytes,
+            buffer_overflow_policy,
+            on_drop=self._drop_dispatch_item,
+        )
         # A flag to indicate if device is ready to acquire.
         self._acquiring = False
         # A condition to signal arrival of a new data and unblock grab_next_data
         self._new_data_condition = threading.Condition()
+        # Reusable arrays for the acquired data.
+        self._frame_pool = FramePool()
+        # Maximum number of data, and maximum time in seconds to wait
+        # for them, to send in a single call to clients that support
+        # batches.  A batch size of 1 disables batching.
+        self._dispatch_batch_size = 1
+        self._dispatch_batch_timeout = 0.0
+        # Recorder of data to disk (see the "recording" setting).
+        self._recording_path = ""
+        self._recorder: typing.Optional[microscope._recorder.RawRecorder]
+        self._recorder = None
+
+        # Metrics of the data path, from fetching to sending.
+        self._fetch_data_seconds = self._metrics.histogram(
+            "fetch_data_seconds", "Time to fetch each data from the device."
+        )
+        self._process_data_seconds = self._metrics.histogram(
+            "process_data_seconds", "Time to process each data."
+        )
+        self._send_data_seconds = self._metrics.histogram(
+            "send_data_seconds",
+            "Time to send data, single or batch, to a client.",
+            labelnames=("client",),
+        )
+        self._dispatch_buffer_depth = self._metrics.gauge(
+            "dispatch_buffer_depth",
+            "Number of data waiting in the dispatch buffer.",
+        )
+        self._dispatch_buffer_bytes = self._metrics.gauge(
+            "dispatch_buffer_bytes",
+            "Number of bytes of data waiting in the dispatch buffer.",
+        )
+        self._data_fetched_total = self._metrics.counter(
+            "data_fetched_total", "Number of data fetched from the device."
+        )
+        self._fetch_errors_total = self._metrics.counter(
+            "fetch_errors_total", "Number of errors while fetching data."
+        )
+        self._device_dropped_frames_total = self._metrics.counter(
+            "device_dropped_frames_total",
+            "Number of frames dropped by the device, from frame numbers.",
+        )
+        self._data_sent_total = self._metrics.counter(
+            "data_sent_total",
+            "Number of data sent to a client.",
+            labelnames=("client",),
+        )
+        self._data_dropped_total = self._metrics.counter(
+            "data_dropped_total",
+            "Number of data dropped before being sent to a client.",
+            labelnames=("client",),
+        )
+        self._clients_removed_total = self._metrics.counter(
+            "clients_removed_total",
+            "Number of clients removed because they disconnected.",
+        )
+
+        self.add_setting(
+            "dispatch batch size",
+            "int",
+            lambda: self._dispatch_batch_size,
+            self._set_dispatch_batch_size,
+            (1, 1024),
+            live=True,
+        )
+        self.add_setting(
+            "dispatch batch timeout",
+            "float",
+            lambda: self._dispatch_batch_timeout,
+            self._set_dispatch_batch_timeout,
+            (0.0, 10.0),
+            live=True,
+        )
+        self.add_setting(
+            "recording path",
+            "str",
+            lambda: self._recording_path,
+            self._set_recording_path,
+            4096,
+            readonly=lambda: self._recorder is not None,
+            live=True,
+        )
+        self.add_setting(
+            "recording",
+            "bool",
+            lambda: self._recorder is not None,
+            self._set_recording,
+            None,
+            live=True,
+        )
 
     def __del__(self):
         self.disable()
         super().__del__()
 
-    # Wrap set_setting to pause and resume acquisition.
-    set_setting = keep_acquiring(Device.set_setting)
+    def shutdown(self) -> None:
+        super().shutdown()
+        self._set_recording(False)
+        for client in list(self._subscribers.keys()):
+            self.remove_client(client)
+        for client in list(self._shared_memory_rings.keys()):
+            self._close_shared_memory(client)
+
+    def _set_dispatch_batch_size(self, size: int) -> None:
+        if size < 1:
+            raise ValueError("batch size must be positive (was %d)" % size)
+        self._dispatch_batch_size = size
+
+    def _set_dispatch_batch_timeout(self, timeout: float) -> None:
+        if timeout < 0.0:
+            raise ValueError("batch timeout can't be negative")
+        self._dispatch_batch_timeout = timeout
+
+    def _set_recording_path(self, path: str) -> None:
+        if self._recorder is not None:
+            raise microscope.IncompatibleStateError(
+                "can't change recording path while recording"
+            )
+        self._recording_path = path
+
+    def _set_recording(self, value: bool) -> None:
+        """Start or stop recording data to disk, on the device side.
+
+        The recorder is a subscriber that blocks when its queue is
+        full so no data is lost (see :mod:`microscope._recorder`).
+        """
+        if value and self._recorder is None:
+            if not self._recording_path:
+                raise microscope.IncompatibleStateError(
+                    "the recording path needs to be set to start recording"
+                )
+            recorder = microscope._recorder.RawRecorder(self._recording_path)
+            self._add_subscriber(
+                recorder, False, True, microscope.DropPolicy.BLOCK, 64
+            )
+            self._recorder = recorder
+        elif not value and self._recorder is not None:
+            recorder = self._recorder
+            self._recorder = None
+            self._remove_subscriber(recorder, drain=True)
+            recorder.close()
+
+    def _settings_are_live(self, names: typing.Iterable[str]) -> bool:
+        """Whether all settings can be set without pausing acquisition.
+
+        Unknown settings are not set so they don't need a pause.
+        """
+        return all(
+            self._settings[name].is_live()
+            for name in names
+            if name in self._settings
+        )
+
+    # Wrap set_setting to pause and resume acquisition, unless the
+    # setting is live.  The call time is observed on the outside so
+    # that it includes the pause and resume.
+    set_setting = _observe_setting_call(
+        keep_acquiring(
+            Device.set_setting,
+            live=lambda self, name, value: self._settings_are_live([name]),
+        )
+    )
 
     @abc.abstractmethod
     def abort(self) -> None:
@@ -598,6 +2032,8 @@ class DataDevice(Device, metaclass=abc.ABCMeta):
 
         """
         _logger.debug("Enabling ...")
+        # Devices may restart their frame count on a new acquisition.
+        self._last_frame_number = None
         # Call device-specific code.
         try:
             result = self._do_enable()
@@ -649,72 +2085,334 @@ class DataDevice(Device, metaclass=abc.ABCMeta):
         then return a reference to the copy.  Otherwise, if the SDK
         returns a data object that will not be written to again, this
         function can just return a reference to the object.  If no
-        data is available, return `None`.
+        data is available, return `None`.  Waiting for data should be
+        done in :meth:`_wait_for_data` and not here.
+
+        If the device provides metadata for the data, such as a
+        hardware timestamp or a frame number, this function can
+        instead return a tuple of the data and a
+        :class:`microscope.FrameMetadata`.
 
         """
         return None
 
+    def _wait_for_data(self, timeout: float) -> None:
+        """Wait until there may be new data for :meth:`_fetch_data`.
+
+        The fetch loop calls this when :meth:`_fetch_data` returns
+        `None`, it should return as soon as new data is available or
+        after `timeout` seconds, whichever happens first.  It is fine
+        to return early, the fetch loop will call :meth:`_fetch_data`
+        again and, if there is still no data, this again.  It must not
+        block for much longer than `timeout` because the fetch loop
+        only checks if it should stop in between calls.
+
+        Derived classes should implement this with a blocking wait,
+        either on the SDK or on a condition variable.  The default
+        implementation sleeps for 1 millisecond which makes the fetch
+        loop poll for data.
+
+        """
+        time.sleep(0.001)
+
     def _process_data(self, data):
         """Do any data processing and return data."""
         return data
 
-    def _send_data(self, client, data, timestamp):
+    def _observed_process_data(self, data):
+        """Call :meth:`_process_data` and observe the time it takes."""
+        start = time.perf_counter()
+        processed = self._process_data(data)
+        self._process_data_seconds.observe(time.perf_counter() - start)
+        return processed
+
+    def _to_shared_memory(self, client, data):
+        """Write data to the client ring and return a reference to it."""
+        ring = self._shared_memory_rings[client]
+        if ring is None or not ring.fits(data):
+            if ring is not None:
+                ring.close()
+            ring = microscope._shared_memory.SharedMemoryRing(data.nbytes)
+            self._shared_memory_rings[client] = ring
+        return ring.write(data)
+
+    def _close_shared_memory(self, client) -> None:
+        """Destroy the shared memory ring of a client, if any."""
+        with self._shared_memory_lock:
+            ring = self._shared_memory_rings.pop(client, None)
+            if ring is not None:
+                ring.close()
+
+    def _send_data(
+        self,
+        client,
+        data,
+        timestamp,
+        metadata: typing.Optional[microscope.FrameMetadata] = None,
+    ):
         """Dispatch data to the client."""
+        start = time.perf_counter()
         try:
+            if isinstance(data, numpy.ndarray):
+                with self._shared_memory_lock:
+                    if client in self._shared_memory_rings:
+                        data = self._to_shared_memory(client, data)
             # Cockpit will send a client with receiveData and expects
-            # two arguments (data and timestamp).  But we really want
-            # to use Python's Queue and instead of just the timestamp
-            # we should be sending some proper metadata object.  We
-            # don't have that proper metadata class yet so just send
-            # the image data as a numpy ndarray for now.
-            if hasattr(client, "put"):
+            # two arguments (data and timestamp).  Clients that asked
+            # for it get the metadata as an extra argument.  Clients
+            # with put, i.e., Python's Queue, only get the data.
+            if _client_has_method(client, "put"):
                 client.put(data)
+            elif metadata is not None and client in self._metadata_clients:
+                client.receiveData(data, timestamp, metadata)
             else:
                 client.receiveData(data, timestamp)
         except (
             Pyro4.errors.ConnectionClosedError,
             Pyro4.errors.CommunicationError,
         ):
-            # Client not listening
-            _logger.info(
-                "Removing %s from client stack: disconnected.", client._pyroUri
-            )
-            self._clientStack = list(filter(client.__ne__, self._clientStack))
-            self._liveClients = self._liveClients.difference([client])
+            self._remove_disconnected_client(client)
+        else:
+            self._observe_send(client, start, 1)
+
+    def _send_data_batch(self, client, data, timestamps, metadata=None):
+        """Dispatch multiple data, stacked on the first axis, to the client.
+
+        The client must have a `receiveDataBatch` method.
+        """
+        start = time.perf_counter()
+        try:
+            with self._shared_memory_lock:
+                if client in self._shared_memory_rings:
+                    data = self._to_shared_memory(client, data)
+            if metadata is not None and client in self._metadata_clients:
+                client.receiveDataBatch(data, timestamps, metadata)
+            else:
+                client.receiveDataBatch(data, timestamps)
+        except (
+            Pyro4.errors.ConnectionClosedError,
+            Pyro4.errors.CommunicationError,
+        ):
+            self._remove_disconnected_client(client)
+        else:
+            self._observe_send(client, start, len(timestamps))
 
-    def _dispatch_loop(self) -> None:
-        """Process data and send results to any client."""
-        while True:
-            client, data, timestamp = self._dispatch_buffer.get(block=True)
-            if client not in self._liveClients:
+    def _observe_send(self, client, start: float, n_data: int) -> None:
+        label = _client_label(client)
+        self._send_data_seconds.labels(label).observe(
+            time.perf_counter() - start
+        )
+        self._data_sent_total.labels(label).inc(n_data)
+
+    def _remove_disconnected_client(self, client) -> None:
+        # Client not listening
+        _logger.info(
+            "Removing %s from client stack: disconnected.", client._pyroUri
+        )
+        self._clients_removed_total.inc()
+        self._clientStack = list(filter(client.__ne__, self._clientStack))
+        self._liveClients = self._liveClients.difference([client])
+        with self._subscribers_lock:
+            subscriber = self._subscribers.pop(client, None)
+        if subscriber is not None:
+            subscriber.close()
+        self._metadata_clients.discard(client)
+        self._close_shared_memory(client)
+        self._forget_client_metrics(client)
+
+    def _forget_client_metrics(self, client) -> None:
+        """Remove the metrics labelled with a client that went away.
+
+        Clients that are not Pyro proxies are labelled with their
+        type so the metrics are kept while there are other clients
+        with the same label.
+        """
+        label = _client_label(client)
+        with self._subscribers_lock:
+            clients = list(self._clientStack) + list(self._subscribers)
+        if any(_client_label(other) == label for other in clients):
+            return
+        for family in (
+            self._send_data_seconds,
+            self._data_sent_total,
+            self._data_dropped_total,
+        ):
+            family.remove(label)
+
+    def _client_keeps_data(self, client) -> bool:
+        """Whether the client may keep a reference to the data sent.
+
+        Data sent via Pyro or via shared memory has been copied and
+        can be reused.  Processing stages must not keep a reference
+        to it either.  Other local clients may keep a reference to it
+        so it can't be reused.
+        """
+        return not (
+            isinstance(client, (Pyro4.Proxy, _ProcessingStage))
+            or client in self._shared_memory_rings
+        )
+
+    def _recycle_data(self, client, data) -> None:
+        """Return data to the frame pool if the client does not keep it."""
+        if self._client_keeps_data(client):
+            self._frame_pool.discard(data)
+        else:
+            self._frame_pool.release(data)
+
+    def _get_dispatch_items(self, buffer) -> typing.List:
+        """Wait for the next items in a dispatch buffer.
+
+        Blocks until there is at least one item.  If batching is
+        enabled, keeps waiting for more items until the batch is full
+        or the batch timeout expires.
+        """
+        items = [buffer.get(block=True)]
+        deadline = time.monotonic() + self._dispatch_batch_timeout
+        while len(items) < self._dispatch_batch_size:
+            remaining = deadline - time.monotonic()
+            try:
+                if remaining > 0.0:
+                    items.append(buffer.get(timeout=remaining))
+                else:
+                    items.append(buffer.get_nowait())
+            except queue.Empty:
+                break
+        return items
+
+    def _dispatch_item(self, client, data, timestamp, metadata) -> None:
+        """Process and send a single data to a client."""
+        err = None
+        if isinstance(data, Exception):
+            standard_exception = Exception(str(data).encode("ascii"))
+            try:
+                self._send_data(client, standard_exception, timestamp)
+            except Exception as e:
+                err = e
+        else:
+            processed = data
+            try:
+                processed = self._observed_process_data(data)
+                if self._client_keeps_data(client):
+                    processed = self._frame_pool.copy_lent(processed)
+                self._send_data(client, processed, timestamp, metadata)
+            except Exception as e:
+                err = e
+            self._recycle_data(client, data)
+            if processed is not data:
+                self._recycle_data(client, processed)
+        if err:
+            # Raising an exception will kill the dispatch loop. We need
+            # another way to notify the client that there was a problem.
+            _logger.error("in _dispatch_loop:", exc_info=err)
+
+    def _dispatch_batch(self, client, items) -> None:
+        """Process and send multiple data to a client in a single call.
+
+        Only arrays of the same shape and type can be stacked.
+        Exceptions, and data that can't be stacked with its
+        neighbours, e.g., after a change of ROI, are sent one by one.
+        """
+
+        def stack_key(item):
+            data = item[1]
+            if not isinstance(data, numpy.ndarray):
+                return None
+            return (data.shape, data.dtype)
+
+        for key, run in itertools.groupby(items, key=stack_key):
+            run = list(run)
+            if key is None or len(run) == 1:
+                for item in run:
+                    self._dispatch_item(*item)
                 continue
             err = None
-            if isinstance(data, Exception):
-                standard_exception = Exception(str(data).encode("ascii"))
-                try:
-                    self._send_data(client, standard_exception, timestamp)
-                except Exception as e:
-                    err = e
-            else:
-                try:
-                    self._send_data(
-                        client, self._process_data(data), timestamp
-                    )
-                except Exception as e:
-                    err = e
+            processed = []
+            try:
+                for item in run:
+                    processed.append(self._observed_process_data(item[1]))
+                stack = self._frame_pool.get(
+                    (len(processed),) + processed[0].shape, processed[0].dtype
+                )
+                numpy.stack(processed, out=stack)
+                timestamps = [item[2] for item in run]
+                metadata = [item[3] for item in run]
+                self._send_data_batch(client, stack, timestamps, metadata)
+                self._recycle_data(client, stack)
+            except Exception as e:
+                err = e
+            # The stack is a copy so all other arrays can be reused.
+            for item, processed_data in itertools.zip_longest(run, processed):
+                self._frame_pool.release(item[1])
+                if processed_data is not None and (
+                    processed_data is not item[1]
+                ):
+                    self._frame_pool.release(processed_data)
             if err:
-                # Raising an exception will kill the dispatch loop. We need
-                # another way to notify the client that there was a problem.
                 _logger.error("in _dispatch_loop:", exc_info=err)
-            self._dispatch_buffer.task_done()
+
+    def _dispatch_items(self, items, subscriber: bool = False) -> None:
+        """Process and send items, tuples as in the dispatch buffer.
+
+        Args:
+            items: the items to process and send.
+            subscriber: whether the items are for a subscriber, which
+                is always live, instead of a client on the stack.
+        """
+        for client, group in itertools.groupby(items, key=lambda i: i[0]):
+            group = list(group)
+            if not subscriber and client not in self._liveClients:
+                if client is not None:
+                    self._data_dropped_total.labels(
+                        _client_label(client)
+                    ).inc(len(group))
+                for item in group:
+                    self._frame_pool.release(item[1])
+            elif len(group) > 1 and _client_has_method(
+                client, "receiveDataBatch"
+            ):
+                self._dispatch_batch(client, group)
+            else:
+                for item in group:
+                    self._dispatch_item(*item)
+
+    def _dispatch_loop(self) -> None:
+        """Process data and send results to the current client."""
+        while True:
+            items = self._get_dispatch_items(self._dispatch_buffer)
+            self._observe_dispatch_buffer()
+            self._dispatch_items(items)
+
+    def _observe_dispatch_buffer(self) -> None:
+        self._dispatch_buffer_depth.set(self._dispatch_buffer.qsize())
+        self._dispatch_buffer_bytes.set(self._dispatch_buffer.nbytes)
+
+    def _drop_dispatch_item(self, item) -> None:
+        """Account for data dropped because the dispatch buffer is full."""
+        client, data = item[:2]
+        if client is not None:
+            self._data_dropped_total.labels(_client_label(client)).inc()
+        self._frame_pool.release(data)
 
     def _fetch_loop(self) -> None:
         """Poll source for data and put it into dispatch buffer."""
         self._fetch_thread_run = True
 
         while self._fetch_thread_run:
+            metadata = None
             try:
+                start = time.perf_counter()
                 data = self._fetch_data()
+                if data is not None:
+                    self._fetch_data_seconds.observe(
+                        time.perf_counter() - start
+                    )
+                if isinstance(data, tuple) and (
+                    len(data) == 2
+                    and isinstance(data[1], microscope.FrameMetadata)
+                ):
+                    data, metadata = data
+                if data is None:
+                    self._wait_for_data(self._fetch_wait_timeout)
             except Exception as e:
                 _logger.error("in _fetch_loop:", exc_info=e)
                 # Raising an exception will kill the fetch loop. We need
@@ -723,11 +2421,8 @@ class DataDevice(Device, metaclass=abc.ABCMeta):
                 self._put(e, timestamp)
                 data = None
             if data is not None:
-                # TODO Add support for timestamp from hardware.
                 timestamp = time.time()
-                self._put(data, timestamp)
-            else:
-                time.sleep(0.001)
+                self._put(data, timestamp, metadata)
 
     @property
     def _client(self):
@@ -738,18 +2433,94 @@ class DataDevice(Device, metaclass=abc.ABCMeta):
     def _client(self, val):
         """Push or pop a client from the _clientStack."""
         if val is None:
-            self._clientStack.pop()
+            old_client = self._clientStack.pop()
+            if (
+                old_client not in self._clientStack
+                and old_client not in self._subscribers
+            ):
+                self._metadata_clients.discard(old_client)
+                self._close_shared_memory(old_client)
+                self._forget_client_metrics(old_client)
         else:
             self._clientStack.append(val)
         self._liveClients = set(self._clientStack)
 
-    def _put(self, data, timestamp) -> None:
-        """Put data and timestamp into dispatch buffer with target dispatch client."""
-        self._dispatch_buffer.put((self._client, data, timestamp))
+    def _put(
+        self,
+        data,
+        timestamp,
+        metadata: typing.Optional[microscope.FrameMetadata] = None,
+    ) -> None:
+        """Put data and timestamp into dispatch buffer with target dispatch client.
 
-    def set_client(self, new_client) -> None:
+        Args:
+            data: the data or an exception.
+            timestamp: time when the data was fetched.
+            metadata: the metadata from the device, if any.  Its
+                `timestamp` is replaced with `timestamp` and, if it
+                has a frame number, the number of dropped frames is
+                computed.
+        """
+        if isinstance(data, Exception):
+            self._fetch_errors_total.inc()
+        else:
+            self._data_fetched_total.inc()
+        if metadata is None:
+            metadata = microscope.FrameMetadata()
+        metadata = metadata._replace(timestamp=timestamp)
+        if metadata.frame_number is not None:
+            if (
+                metadata.dropped_frames is None
+                and self._last_frame_number is not None
+            ):
+                dropped = metadata.frame_number - self._last_frame_number - 1
+                metadata = metadata._replace(dropped_frames=max(dropped, 0))
+            self._last_frame_number = metadata.frame_number
+        if metadata.dropped_frames:
+            self._device_dropped_frames_total.inc(metadata.dropped_frames)
+        with self._subscribers_lock:
+            subscribers = list(self._subscribers.values())
+        if subscribers:
+            # Multiple clients may be sending this same data at the
+            # same time so we can't know when to reuse it.
+            if not isinstance(data, Exception):
+                data = self._frame_pool.copy_lent(data)
+            self._frame_pool.discard(data)
+            for subscriber in subscribers:
+                subscriber.put((subscriber.client, data, timestamp, metadata))
+        self._dispatch_buffer.put((self._client, data, timestamp, metadata))
+        self._observe_dispatch_buffer()
+
+    def set_client(
+        self,
+        new_client,
+        shared_memory: bool = False,
+        metadata: bool = False,
+        drop_policy: typing.Optional[microscope.DropPolicy] = None,
+        queue_size: int = 16,
+    ) -> None:
         """Set up a connection to our client.
 
+        Args:
+            new_client: the client, its Pyro URI, or `None` to remove
+                the current client.
+            shared_memory: if `True`, data is written to a shared
+                memory ring and the client only receives a
+                :class:`microscope._shared_memory.SharedFrame`
+                referencing it.  Only works if the client is on the
+                same computer.  See :mod:`microscope._shared_memory`.
+            metadata: if `True`, the client also receives a
+                :class:`microscope.FrameMetadata` as an extra argument
+                to `receiveData` (a list of them to
+                `receiveDataBatch`).  Clients that don't ask for it,
+                such as Cockpit, only get the data and timestamp.
+            drop_policy: if not `None`, the client is a subscriber
+                instead of being added to the client stack (see
+                below).  It defines what to do when the subscriber
+                queue is full.
+            queue_size: maximum number of data in the queue of a
+                subscriber.
+
         Clients now sit in a stack so that a single device may send
         different data to multiple clients in a single experiment.
         The usage is currently::
@@ -763,12 +2534,33 @@ class DataDevice(Device, metaclass=abc.ABCMeta):
         rework here to identify the caller and remove only that caller
         from the client stack.
 
+        Subscribers, clients set with a `drop_policy`, are not part
+        of the stack.  They get all data, independently of the stack
+        and of each other, each with its own queue and thread.  This
+        allows, for example, a recorder, a live preview, and a monitor
+        to all get data from the same device without a slow client
+        delaying the others.  Remove them with :meth:`remove_client`::
+
+            device.set_client(preview, drop_policy=DropPolicy.LATEST_ONLY)
+            # do stuff, send triggers, receive data
+            device.remove_client(preview)
+
         """
+        if drop_policy is not None:
+            self._add_subscriber(
+                new_client, shared_memory, metadata, drop_policy, queue_size
+            )
+            return
         if new_client is not None:
             if isinstance(new_client, (str, Pyro4.core.URI)):
-                self._client = Pyro4.Proxy(new_client)
-            else:
-                self._client = new_client
+                new_client = Pyro4.Proxy(new_client)
+            _fetch_client_methods(new_client)
+            if shared_memory:
+                with self._shared_memory_lock:
+                    self._shared_memory_rings.setdefault(new_client, None)
+            if metadata:
+                self._metadata_clients.add(new_client)
+            self._client = new_client
         else:
             self._client = None
         # _client uses a setter. Log the result of assignment.
@@ -777,10 +2569,160 @@ class DataDevice(Device, metaclass=abc.ABCMeta):
         else:
             _logger.info("Current client is %s.", str(self._client))
 
-    @keep_acquiring
-    def update_settings(self, settings, init: bool = False) -> None:
-        """Update settings, toggling acquisition if necessary."""
-        super().update_settings(settings, init)
+    def _add_subscriber(
+        self,
+        client,
+        shared_memory: bool,
+        metadata: bool,
+        drop_policy: microscope.DropPolicy,
+        queue_size: int,
+        **kwargs,
+    ) -> None:
+        if client is None:
+            raise ValueError("a subscriber can't be None")
+        if isinstance(client, (str, Pyro4.core.URI)):
+            client = Pyro4.Proxy(client)
+        _fetch_client_methods(client)
+        subscriber = _Subscriber(
+            self, client, drop_policy, queue_size, **kwargs
+        )
+        if shared_memory:
+            with self._shared_memory_lock:
+                self._shared_memory_rings.setdefault(client, None)
+        if metadata:
+            self._metadata_clients.add(client)
+        with self._subscribers_lock:
+            previous = self._subscribers.get(client, None)
+            self._subscribers[client] = subscriber
+        if previous is not None:
+            previous.close()
+        _logger.info("Added subscriber %s.", str(client))
+
+    def set_preview_client(
+        self,
+        client,
+        shared_memory: bool = False,
+        max_rate: typing.Optional[float] = None,
+        max_size: typing.Optional[int] = None,
+    ) -> None:
+        """Add a subscriber that only gets the newest data, for previews.
+
+        This is a subscriber (see :meth:`set_client`) with
+        `DropPolicy.LATEST_ONLY` that may also lower the rate and the
+        size of the data on the device, before sending it.  This
+        reduces the cost of a remote live view.  Remove it with
+        :meth:`remove_client`.
+
+        Args:
+            client: the client or its Pyro URI.
+            shared_memory: as in :meth:`set_client`.
+            max_rate: maximum number of data per second.  Data
+                arriving faster than that is not sent.
+            max_size: maximum size, in pixels, of the longest side of
+                an image.  Larger images are decimated to fit.
+
+        """
+        self._add_subscriber(
+            client,
+            shared_memory,
+            False,
+            microscope.DropPolicy.LATEST_ONLY,
+            1,
+            max_rate=max_rate,
+            max_size=max_size,
+        )
+
+    def add_processing_stage(
+        self,
+        stage: typing.Callable,
+        drop_policy: microscope.DropPolicy = microscope.DropPolicy.LATEST_ONLY,
+        queue_size: int = 1,
+    ) -> None:
+        """Add a function that processes the data inside the device server.
+
+        The processing stage is a subscriber (see :meth:`set_client`)
+        in the same process as the device, so it gets the data after
+        :meth:`_process_data` without it being serialized or copied.
+        It is called like ``stage(data, timestamp, metadata)`` on its
+        own thread so that it does not delay the other clients.  It
+        can then call other devices in the same process directly, for
+        example, to apply a pattern in a deformable mirror for each
+        image of a wavefront sensor camera, without going over the
+        network (see :ref:`composite-devices`).
+
+        The data may be reused for later data once the stage returns,
+        so the stage must not keep a reference to it; copy it if
+        needed.  To keep up with the device, the stage should
+        preallocate its own buffers, such as the pattern to apply,
+        instead of allocating new ones on each call.  The default
+        drop policy only keeps the newest data which, in a closed
+        loop, avoids acting on old data if the stage is slower than
+        the device.
+
+        This is only meant to be called in the device server process.
+        Remove the stage with :meth:`remove_processing_stage`.
+
+        Args:
+            stage: function called with data, timestamp, and
+                :class:`microscope.FrameMetadata`.
+            drop_policy: as in :meth:`set_client`.
+            queue_size: as in :meth:`set_client`.
+
+        """
+        self._add_subscriber(
+            _ProcessingStage(stage), False, True, drop_policy, queue_size
+        )
+
+    def remove_processing_stage(
+        self, stage: typing.Callable, drain: bool = False
+    ) -> None:
+        """Remove a function added with :meth:`add_processing_stage`.
+
+        Args:
+            stage: the function to remove.
+            drain: if `True`, wait for the stage to process the data
+                still in its queue.  Otherwise, that data is dropped.
+        """
+        self._remove_subscriber(_ProcessingStage(stage), drain=drain)
+
+    def remove_client(self, client) -> None:
+        """Remove a subscriber set with :meth:`set_client`.
+
+        Data still in the subscriber queue is dropped.
+        """
+        if isinstance(client, (str, Pyro4.core.URI)):
+            client = Pyro4.Proxy(client)
+        self._remove_subscriber(client)
+
+    def _remove_subscriber(self, client, drain: bool = False) -> None:
+        with self._subscribers_lock:
+            subscriber = self._subscribers.pop(client, None)
+        if subscriber is None:
+            raise ValueError("%s is not a subscriber" % str(client))
+        subscriber.close(drain=drain)
+        if subscriber.dropped:
+            _logger.info(
+                "Subscriber %s dropped %d data.",
+                str(client),
+                subscriber.dropped,
+            )
+        if client not in self._clientStack:
+            self._metadata_clients.discard(client)
+            self._close_shared_memory(client)
+            self._forget_client_metrics(client)
+
+    @_observe_setting_call
+    @keep_acquiring(
+        live=lambda self, settings, init=False: self._settings_are_live(
+            settings.keys()
+        )
+    )
+    def update_settings(self, settings, init: bool = False):
+        """Update settings, pausing acquisition only once for all.
+
+        Acquisition is not paused if all settings are live.
+        """
+        return super().update_settings(settings, init)
 
     # noinspection PyPep8Naming
     def receiveClient(self, client_uri: str) -> None:
@@ -821,7 +2763,10 @@ class Camera(TriggerTargetMixin, DataDevice):
     """Adds functionality to :class:`DataDevice` to support cameras.
 
     Defines the interface for cameras.  Applies a transform to
-    acquired data in the processing step.
+    acquired data in the processing step.  If the "transform on
+    client" setting is enabled, the data is sent as acquired and the
+    transform to apply is in the `FrameMetadata` sent to clients that
+    requested it (see :func:`transform_view`).
 
     """
 
@@ -840,6 +2785,9 @@ class Camera(TriggerTargetMixin, DataDevice):
         self._client_transform = (False, False, False)
         # Result of combining client and readout transforms
         self._transform = (False, False, False)
+        self._transform_view = _TRANSFORM_VIEWS[self._transform]
+        # Whether to leave the transform to the clients.
+        self._transform_on_client = False
         # A transform provided by the client.
         self.add_setting(
             "transform",
@@ -856,23 +2804,38 @@ class Camera(TriggerTargetMixin, DataDevice):
             lambda: self._readout_modes,
         )
         self.add_setting("roi", "tuple", self.get_roi, self.set_roi, None)
+        self.add_setting(
+            "transform on client",
+            "bool",
+            lambda: self._transform_on_client,
+            self._set_transform_on_client,
+            None,
+        )
 
     def _process_data(self, data):
-        """Apply self._transform to data."""
-        flips = (self._transform[0], self._transform[1])
-        rot = self._transform[2]
-
-        # Choose appropriate transform based on (flips, rot).
-        # Do rotation
-        data = numpy.rot90(data, rot)
-        # Flip
-        data = {
-            (0, 0): lambda d: d,
-            (0, 1): numpy.flipud,
-            (1, 0): numpy.fliplr,
-            (1, 1): lambda d: numpy.fliplr(numpy.flipud(d)),
-        }[flips](data)
-        return super()._process_data(data)
+        """Apply self._transform to data.
+
+        The transformed data is copied, in a single pass, to a C
+        contiguous array from the frame pool.  Nothing is done if
+        transforms are applied on the client (see the "transform on
+        client" setting).
+        """
+        if self._transform_on_client or not any(self._transform):
+            return super()._process_data(data)
+        view = self._transform_view(data)
+        transformed = self._frame_pool.get(view.shape, view.dtype)
+        numpy.copyto(transformed, view)
+        return super()._process_data(transformed)
+
+    def _put(self, data, timestamp, metadata=None) -> None:
+        if self._transform_on_client:
+            metadata = (metadata or microscope.FrameMetadata())._replace(
+                transform=self._transform
+            )
+        super()._put(data, timestamp, metadata)
+
+    def _set_transform_on_client(self, value: bool) -> None:
+        self._transform_on_client = bool(value)
 
     def set_readout_mode(self, description):
         """Set the readout mode and _readout_transform."""
@@ -893,7 +2856,10 @@ class Camera(TriggerTargetMixin, DataDevice):
         if self._readout_transform[2] and self._client_transform[2]:
             lr = not lr
             ud = not ud
-        self._transform = (lr, ud, rot)
+        self._transform = (bool(lr), bool(ud), bool(rot))
+        self._transform_view = _TRANSFORM_VIEWS[self._transform]
+        # The sensor shape, binning, and ROI are corrected for it.
+        self._invalidate_settings_cache()
 
     def _set_readout_transform(self, new_transform):
         """Update readout transform and update resultant transform."""
@@ -952,7 +2918,12 @@ class Camera(TriggerTargetMixin, DataDevice):
             binning = microscope.Binning(v_bin, h_bin)
         else:
             binning = microscope.Binning(h_bin, v_bin)
-        return self._set_binning(binning)
+        # Frames will have a different shape so drop the old arrays.
+        self._frame_pool.clear()
+        try:
+            return self._set_binning(binning)
+        finally:
+            self._invalidate_settings_cache()
 
     @abc.abstractmethod
     def _get_roi(self) -> microscope.ROI:
@@ -988,7 +2959,12 @@ class Camera(TriggerTargetMixin, DataDevice):
             roi = microscope.ROI(left, top, height, width)
         else:
             roi = microscope.ROI(left, top, width, height)
-        return self._set_roi(roi)
+        # Frames will have a different shape so drop the old arrays.
+        self._frame_pool.clear()
+        try:
+            return self._set_roi(roi)
+        finally:
+            self._invalidate_settings_cache()
 
 
 class SerialDeviceMixin(metaclass=abc.ABCMeta):
@@ -1072,13 +3048,26 @@ class DeformableMirror(TriggerTargetMixin, Device, metaclass=abc.ABCMeta):
     initialized to `None` to support the queueing of patterns and
     software triggering.
 
+    Patterns that are used many times, e.g., a modal basis in an
+    adaptive optics loop, can be uploaded once with
+    :meth:`upload_patterns`.  They are validated and converted to
+    the values sent to the device only once, and then used by name
+    with :meth:`queue_cached_patterns` and
+    :meth:`apply_cached_pattern`.
+
     """
 
+    # Applying a pattern of a sequence is the whole trigger.
+    _trigger_after_sequence_step = False
+
     @abc.abstractmethod
     def __init__(self, **kwargs) -> None:
         super().__init__(**kwargs)
         self._patterns: typing.Optional[numpy.ndarray] = None
         self._pattern_idx: int = -1
+        # Whether _patterns came from _prepare_patterns.
+        self._patterns_prepared = False
+        self._pattern_cache: typing.Dict[str, numpy.ndarray] = {}
 
     @property
     @abc.abstractmethod
@@ -1112,6 +3101,99 @@ class DeformableMirror(TriggerTargetMixin, Device, metaclass=abc.ABCMeta):
     def _do_apply_pattern(self, pattern: numpy.ndarray) -> None:
         raise NotImplementedError()
 
+    def _prepare_patterns(self, patterns: numpy.ndarray) -> numpy.ndarray:
+        """Convert validated patterns to the values sent to the device.
+
+        Devices that need to convert the patterns before sending them,
+        e.g., to a different range, should override this method and
+        :meth:`_do_apply_prepared_pattern`.  This is only called once
+        per pattern set uploaded with :meth:`upload_patterns`.
+
+        Returns:
+            A new `KxN` C contiguous array.  By default, of type
+            float64 and with the values unchanged.
+        """
+        return numpy.array(
+            numpy.atleast_2d(patterns), dtype=numpy.float64, order="C"
+        )
+
+    def _do_apply_prepared_pattern(self, pattern: numpy.ndarray) -> None:
+        """Apply one pattern, a row from :meth:`_prepare_patterns`."""
+        self._do_apply_pattern(pattern)
+
+    def _do_queue_prepared_patterns(self, patterns: numpy.ndarray) -> None:
+        """Queue patterns from :meth:`_prepare_patterns` on the device.
+
+        Devices that can queue patterns to apply on hardware triggers
+        should implement this.  Raise `NotImplementedError` to use the
+        software fallback, i.e., a pattern is applied on each call to
+        :meth:`trigger`.
+        """
+        raise NotImplementedError()
+
+    def upload_patterns(self, name: str, patterns: numpy.ndarray) -> None:
+        """Keep a set of patterns on the device, to use them by name.
+
+        Args:
+            name: name to refer to the patterns.  Patterns previously
+                uploaded with the same name are replaced.
+            patterns: an `KxN` elements array of values in the range
+                `[0 1]`, as for :meth:`queue_patterns`.
+
+        """
+        patterns = numpy.asarray(patterns)
+        self._validate_patterns(patterns)
+        prepared = self._prepare_patterns(patterns)
+        prepared.flags.writeable = False
+        self._pattern_cache[name] = prepared
+
+    def remove_patterns(self, name: str) -> None:
+        """Remove patterns uploaded with :meth:`upload_patterns`."""
+        self._cached_patterns(name)
+        del self._pattern_cache[name]
+
+    def get_pattern_names(self) -> typing.List[str]:
+        """Return the names of the uploaded patterns."""
+        return list(self._pattern_cache.keys())
+
+    def _cached_patterns(self, name: str) -> numpy.ndarray:
+        try:
+            return self._pattern_cache[name]
+        except KeyError:
+            raise ValueError("no patterns named '%s'" % name)
+
+    def queue_cached_patterns(self, name: str) -> None:
+        """Queue uploaded patterns, as :meth:`queue_patterns` does.
+
+        If the device supports it, the patterns are applied on
+        hardware triggers.
+        """
+        patterns = self._cached_patterns(name)
+        try:
+            self._do_queue_prepared_patterns(patterns)
+        except NotImplementedError:
+            self._patterns = patterns
+            self._patterns_prepared = True
+            self._pattern_idx = -1  # none is applied yet
+
+    def apply_cached_pattern(self, name: str, index: int = 0) -> None:
+        """Apply one of the uploaded patterns.
+
+        Args:
+            name: name of the uploaded patterns.
+            index: index of the pattern in the pattern set.
+
+        Raises:
+            microscope.IncompatibleStateError: if device trigger type is
+                not set to software.
+
+        """
+        if self.trigger_type is not microscope.TriggerType.SOFTWARE:
+            raise microscope.IncompatibleStateError(
+                "apply_cached_pattern requires software trigger type"
+            )
+        self._do_apply_prepared_pattern(self._cached_patterns(name)[index])
+
     def apply_pattern(self, pattern: numpy.ndarray) -> None:
         """Apply this pattern.
 
@@ -1145,6 +3227,7 @@ class DeformableMirror(TriggerTargetMixin, Device, metaclass=abc.ABCMeta):
         """
         self._validate_patterns(patterns)
         self._patterns = patterns
+        self._patterns_prepared = False
         self._pattern_idx = -1  # none is applied yet
 
     def next_pattern(self) -> None:
@@ -1175,7 +3258,13 @@ class DeformableMirror(TriggerTargetMixin, Device, metaclass=abc.ABCMeta):
         if self._patterns is None:
             raise microscope.DeviceError("no pattern queued to apply")
         self._pattern_idx += 1
-        self.apply_pattern(self._patterns[self._pattern_idx, :])
+        # The patterns were validated when queued, and trigger
+        # already checked for software trigger type.
+        pattern = self._patterns[self._pattern_idx, :]
+        if self._patterns_prepared:
+            self._do_apply_prepared_pattern(pattern)
+        else:
+            self._do_apply_pattern(pattern)
 
     def trigger(self) -> None:
         """Apply the next pattern in the queue."""
@@ -1183,6 +3272,27 @@ class DeformableMirror(TriggerTargetMixin, Device, metaclass=abc.ABCMeta):
         # and only exists for the docstring.
         return super().trigger()
 
+    def _do_queue_sequence(
+        self, sequence: typing.Sequence, repeat: bool
+    ) -> None:
+        # queue_patterns sends the patterns to the hardware, and has
+        # its own fallback for software trigger, but does not repeat.
+        if repeat:
+            if self.trigger_type is microscope.TriggerType.SOFTWARE:
+                raise NotImplementedError()
+            raise microscope.UnsupportedFeatureError(
+                "repeat of patterns is not supported on hardware trigger"
+            )
+        self.queue_patterns(numpy.stack(sequence))
+
+    def _apply_sequence_step(self, step) -> None:
+        self.apply_pattern(step)
+
+    def _do_clear_sequence(self) -> None:
+        self._patterns = None
+        self._patterns_prepared = False
+        self._pattern_idx = -1
+
 
 class LightSource(TriggerTargetMixin, Device, metaclass=abc.ABCMeta):
     """Light source such as lasers or LEDs.
@@ -1197,8 +3307,14 @@ class LightSource(TriggerTargetMixin, Device, metaclass=abc.ABCMeta):
     set and unset the laser such that it only emits light while
     receiving a high or low TTL, or digital, input signal.
 
+    The values of a sequence (see :meth:`queue_sequence`) are power
+    levels.  Setting the power is the whole trigger, the usual
+    trigger only makes sense for some trigger modes.
+
     """
 
+    _trigger_after_sequence_step = False
+
     @abc.abstractmethod
     def __init__(self, **kwargs):
         super().__init__(**kwargs)
@@ -1242,13 +3358,159 @@ class LightSource(TriggerTargetMixin, Device, metaclass=abc.ABCMeta):
         The power value will be clipped to [0, 1] interval.
         """
         clipped_power = max(min(power, 1.0), 0.0)
-        self._do_set_power(clipped_power)
-        self._set_point = clipped_power
+        try:
+            self._do_set_power(clipped_power)
+            self._set_point = clipped_power
+        finally:
+            self._invalidate_settings_cache()
 
     def get_set_power(self) -> float:
         """Return the power set point."""
         return self._set_point
 
+    def _apply_sequence_step(self, step) -> None:
+        self.power = step
+
+
+class _MoveRunner:
+    """Moves done in order, one at a time, on a separate thread.
+
+    This implements the moves that are started without waiting for
+    them to finish, such as :meth:`Stage.start_move_to`.  A client of
+    a move has its `move_finished` method called, once the move is
+    done, with the position after the move and the exception if the
+    move failed, or `None` otherwise.  Moves that wait, with
+    :meth:`run`, also go through here so they are done after the
+    moves already started.
+
+    Args:
+        name: name of what moves, for the error messages.
+
+    """
+
+    def __init__(self, name: str) -> None:
+        self._name = name
+        self._executor: typing.Optional[
+            concurrent.futures.ThreadPoolExecutor
+        ] = None
+        self._lock = threading.Lock()
+        self._last: typing.Optional[concurrent.futures.Future] = None
+        # The error of the first move that failed since the last wait.
+        self._error: typing.Optional[BaseException] = None
+        # Marks the thread of the executor, where moves that wait can
+        # be done directly, e.g., the axis moves of a stage move.
+        self._local = threading.local()
+
+    def start(
+        self,
+        move: typing.Callable,
+        target,
+        get_position: typing.Callable,
+        client=None,
+    ) -> None:
+        """Call `move` with `target` after the previous moves."""
+        if isinstance(client, (str, Pyro4.core.URI)):
+            client = Pyro4.Proxy(client)
+
+        def run():
+            error = None
+            try:
+                move(target)
+            except Exception as err:
+                _logger.error("failed to move to %s", target, exc_info=err)
+                error = err
+                with self._lock:
+                    if self._error is None:
+                        self._error = err
+            if client is not None:
+                try:
+                    client.move_finished(get_position(), error)
+                except Exception as err:
+                    _logger.error(
+                        "failed to notify %s of move", client, exc_info=err
+                    )
+
+        self._submit(run)
+
+    def run(self, move: typing.Callable, *args):
+        """Call `move` with `args` after the previous moves and wait.
+
+        Returns what `move` returns.  Errors of this move are raised
+        here, and not by :meth:`wait`.
+        """
+        if getattr(self._local, "is_runner", False):
+            # Already part of a move.
+            return move(*args)
+        return self._submit(move, *args).result()
+
+    def _mark_runner_thread(self) -> None:
+        self._local.is_runner = True
+
+    def _submit(self, fn: typing.Callable, *args) -> concurrent.futures.Future:
+        with self._lock:
+            if self._executor is None:
+                self._executor = concurrent.futures.ThreadPoolExecutor(
+                    max_workers=1,
+                    thread_name_prefix=self._name + "-move",
+                    initializer=self._mark_runner_thread,
+                )
+            self._last = self._executor.submit(fn, *args)
+            return self._last
+
+    @property
+    def is_moving(self) -> bool:
+        last = self._last
+        return last is not None and not last.done()
+
+    def wait(self, timeout: typing.Optional[float] = None) -> None:
+        """Wait for all moves, and raise the first error since last wait."""
+        last = self._last
+        if last is not None:
+            done, _ = concurrent.futures.wait([last], timeout)
+            if not done:
+                raise TimeoutError(
+                    "%s still moving after %s" % (self._name, timeout)
+                )
+        with self._lock:
+            error, self._error = self._error, None
+        if error is not None:
+            raise error
+
+    def shutdown(self) -> None:
+        """Wait for the moves to finish and stop the thread."""
+        with self._lock:
+            executor, self._executor = self._executor, None
+        if executor is not None:
+            executor.shutdown(wait=True)
+
+
+def ordered_move(func):
+    """Wrapper to do a stage, or stage axis, move in order with the others.
+
+    Moves started without waiting, such as with
+    :meth:`Stage.start_move_to`, are done one after the other on a
+    separate thread.  Implementations of :meth:`Stage.move_to`,
+    :meth:`Stage.move_by`, and of the :class:`StageAxis` methods of
+    the same name, should be wrapped so that moves that wait are also
+    done on that thread, after the moves already started::
+
+        @microscope.abc.ordered_move
+        def move_to(self, position):
+            ...
+
+    """
+
+    @functools.wraps(func)
+    def wrapper(self, *args, **kwargs):
+        if isinstance(self, Stage):
+            self._share_moves_with_axes()
+        moves = self._moves
+        if moves is None:
+            return func(self, *args, **kwargs)
+        return moves.run(functools.partial(func, self, *args, **kwargs))
+
+    return wrapper
+
 
 class FilterWheel(Device, metaclass=abc.ABCMeta):
     """ABC for filter wheels, cube turrets, and filter sliders.
@@ -1258,6 +3520,16 @@ class FilterWheel(Device, metaclass=abc.ABCMeta):
     any of those positions, including positions that may not hold a
     filter.
 
+    A move can be started without waiting for it to finish, with
+    ``set_position(position, wait=False)``, so that it overlaps with
+    the moves of other devices or the readout of a camera:
+
+    .. code-block:: python
+
+        wheel.set_position(2, wait=False)
+        stage.move_to({"x": 100.0})
+        wheel.wait_for_move(timeout=5.0)
+
     Args:
         positions: total number of filter positions on this device.
 
@@ -1280,6 +3552,8 @@ class FilterWheel(Device, metaclass=abc.ABCMeta):
             self.set_position,
             lambda: (0, self.get_num_positions()),
         )
+        # Moves started with set_position(wait=False).
+        self._moves = _MoveRunner("filter wheel")
 
     @property
     def n_positions(self) -> int:
@@ -1293,12 +3567,14 @@ class FilterWheel(Device, metaclass=abc.ABCMeta):
 
     @position.setter
     def position(self, new_position: int) -> None:
-        if 0 <= new_position < self.n_positions:
-            return self._do_set_position(new_position)
-        else:
+        self._check_position(new_position)
+        return self._do_set_position(new_position)
+
+    def _check_position(self, position: int) -> None:
+        if not 0 <= position < self.n_positions:
             raise ValueError(
                 "can't move to position %d, limits are [0 %d]"
-                % (new_position, self.n_positions - 1)
+                % (position, self.n_positions - 1)
             )
 
     @abc.abstractmethod
@@ -1317,8 +3593,46 @@ class FilterWheel(Device, metaclass=abc.ABCMeta):
     def get_position(self) -> int:
         return self.position
 
-    def set_position(self, position: int) -> None:
-        self.position = position
+    def set_position(
+        self, position: int, wait: bool = True, client=None
+    ) -> None:
+        """Move to a position.
+
+        Args:
+            position: the position to move to (zero-based).
+            wait: if `False`, start the move and return without
+                waiting for it to finish.  Moves are done in order,
+                one after the other, on a separate thread, so a move
+                that waits is only done after those already started.
+            client: optional object, or its Pyro URI, whose
+                `move_finished` method is called when a move started
+                with `wait=False` finishes, with the position and the
+                exception if the move failed, or `None` otherwise.
+
+        """
+        self._check_position(position)
+        if wait:
+            self._moves.run(self._do_set_position, position)
+            return
+        self._moves.start(
+            self._do_set_position, position, self._do_get_position, client
+        )
+
+    @property
+    def is_moving(self) -> bool:
+        """Whether moves started with `wait=False` are unfinished."""
+        return self._moves.is_moving
+
+    def wait_for_move(self, timeout: typing.Optional[float] = None) -> None:
+        """Wait for the moves started with `wait=False` to finish.
+
+        See :meth:`Stage.wait_for_move`.
+        """
+        self._moves.wait(timeout)
+
+    def shutdown(self) -> None:
+        self._moves.shutdown()
+        super().shutdown()
 
 
 class Controller(Device, metaclass=abc.ABCMeta):
@@ -1363,6 +3677,10 @@ class StageAxis(metaclass=abc.ABCMeta):
 
     """
 
+    # Moves of the stage, set by the stage, so that moves of the axis
+    # are done in order with them (see :func:`ordered_move`).
+    _moves: typing.Optional[_MoveRunner] = None
+
     @abc.abstractmethod
     def move_by(self, delta: float) -> None:
         """Move axis by given amount."""
@@ -1450,8 +3768,32 @@ class Stage(Device, metaclass=abc.ABCMeta):
     Some stages need to find a reference position, home, before being
     able to be moved.  If required, this happens automatically during
     :func:`enable`.
+
+    Moves can also be started without waiting for them to finish,
+    with :func:`start_move_to` and :func:`start_move_by`, which
+    optionally notify a client when the move finishes.  A path of
+    positions, e.g., the tiles of a mosaic, can be queued with
+    :func:`queue_positions` so that each move only needs a call to
+    :func:`move_to_next_position`:
+
+    .. code-block:: python
+
+        stage.queue_positions([{'x': 0, 'y': 0}, {'x': 100, 'y': 0}])
+        for i in range(2):
+            stage.wait_for_move()
+            camera.trigger()
+            # Wait for the exposure, but not for the readout, to end
+            stage.move_to_next_position()
     """
 
+    def __init__(self, **kwargs) -> None:
+        super().__init__(**kwargs)
+        # Moves started with start_move_*, and those that wait.
+        self._moves = _MoveRunner("stage")
+        self._queued_positions: typing.Deque[
+            typing.Mapping[str, float]
+        ] = collections.deque()
+
     @property
     @abc.abstractmethod
     def axes(self) -> typing.Mapping[str, StageAxis]:
@@ -1505,7 +3847,7 @@ class Stage(Device, metaclass=abc.ABCMeta):
         """
         return {name: axis.limits for name, axis in self.axes.items()}
 
-    @abc.abstractmethod
+    @ordered_move
     def move_by(self, delta: typing.Mapping[str, float]) -> None:
         """Move axes by the corresponding amounts.
 
@@ -1526,12 +3868,13 @@ class Stage(Device, metaclass=abc.ABCMeta):
         Instead, the stage will move until the axis limit.
 
         """
-        # TODO: implement a software fallback that moves the
-        # individual axis, for stages that don't have provide
-        # simultaneous move of multiple axes.
-        raise NotImplementedError()
+        # Software fallback that moves the individual axis, for
+        # stages that don't provide simultaneous move of multiple
+        # axes.  Stages that do should override this method.
+        for name, axis_delta in delta.items():
+            self.axes[name].move_by(axis_delta)
 
-    @abc.abstractmethod
+    @ordered_move
     def move_to(self, position: typing.Mapping[str, float]) -> None:
         """Move axes to the corresponding positions.
 
@@ -1552,4 +3895,102 @@ class Stage(Device, metaclass=abc.ABCMeta):
         stage will move until the axes limit.
 
         """
-        raise NotImplementedError()
+        # Software fallback, see move_by.
+        for name, axis_position in position.items():
+            self.axes[name].move_to(axis_position)
+
+    def _share_moves_with_axes(self) -> None:
+        # Axes can also be moved on their own, e.g., by clients of
+        # the axis, and those moves need to wait for the stage moves.
+        for axis in self.axes.values():
+            axis._moves = self._moves
+
+    def _start_move(self, move, target, client) -> None:
+        unknown = set(target.keys()) - set(self.axes.keys())
+        if unknown:
+            raise ValueError("unknown axes %s" % sorted(unknown))
+        self._share_moves_with_axes()
+        self._moves.start(move, target, lambda: self.position, client)
+
+    def start_move_to(
+        self, position: typing.Mapping[str, float], client=None
+    ) -> None:
+        """Start moving axes to positions, and return without waiting.
+
+        Args:
+            position: map of axis name to the positions to move to,
+                as for :func:`move_to`.
+            client: optional object, or its Pyro URI, whose
+                `move_finished` method is called when the move
+                finishes with the stage position and the exception if
+                the move failed, or `None` otherwise.
+
+        Moves started this way are done in order, one after the
+        other.  Use :func:`wait_for_move` to wait for them to finish.
+        """
+        self._start_move(self.move_to, position, client)
+
+    def start_move_by(
+        self, delta: typing.Mapping[str, float], client=None
+    ) -> None:
+        """Start moving axes by amounts, and return without waiting.
+
+        See :func:`start_move_to`.
+        """
+        self._start_move(self.move_by, delta, client)
+
+    @property
+    def is_moving(self) -> bool:
+        """Whether moves started with `start_move_*` are unfinished."""
+        return self._moves.is_moving
+
+    def wait_for_move(self, timeout: typing.Optional[float] = None) -> None:
+        """Wait for the moves started with `start_move_*` to finish.
+
+        Args:
+            timeout: maximum time, in seconds, to wait.
+
+        Raises:
+            TimeoutError: if the moves did not finish in `timeout`.
+            Exception: the error of the first move that failed since
+                the last call to `wait_for_move`.
+        """
+        self._moves.wait(timeout)
+
+    def queue_positions(
+        self, positions: typing.Sequence[typing.Mapping[str, float]]
+    ) -> None:
+        """Queue positions to move to, with :func:`move_to_next_position`.
+
+        The positions replace any that are still queued.
+        """
+        axes = set(self.axes.keys())
+        for position in positions:
+            if not set(position.keys()) <= axes:
+                raise ValueError(
+                    "unknown axes %s" % sorted(set(position.keys()) - axes)
+                )
+        self._queued_positions = collections.deque(positions)
+
+    def move_to_next_position(self, client=None) -> int:
+        """Start the move to the next position queued.
+
+        Args:
+            client: as for :func:`start_move_to`.
+
+        Returns:
+            The number of positions still queued after this one.
+
+        Raises:
+            microscope.DeviceError: if there are no positions queued.
+        """
+        try:
+            position = self._queued_positions.popleft()
+        except IndexError:
+            raise microscope.DeviceError("no positions queued")
+        self.start_move_to(position, client)
+        return len(self._queued_positions)
+
+    def shutdown(self) -> None:
+        self._moves.shutdown()
+        super().shutdown()
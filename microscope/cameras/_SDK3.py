@@ -23,6 +23,8 @@ import ctypes
 import os
 from ctypes import POINTER, c_double, c_int, c_uint, c_void_p
 
+import microscope._library
+
 
 #### typedefs
 AT_H = ctypes.c_int
@@ -31,15 +33,34 @@ AT_64 = ctypes.c_int64
 AT_U8 = ctypes.c_uint8
 AT_WC = ctypes.c_wchar
 
-_stdcall_libraries = {}
 
+def _initialise_utility_library(lib) -> None:
+    lib.AT_InitialiseUtilityLibrary()
+
+
+# The libraries are only loaded when first used.  The utility library
+# is initialised once loaded.
 if os.name in ("nt", "ce"):
-    _stdcall_libraries["ATCORE"] = ctypes.WinDLL("atcore")
-    _stdcall_libraries["ATUTIL"] = ctypes.WinDLL("atutility")
+    _stdcall_libraries = {
+        "ATCORE": microscope._library.LazyLibrary(
+            lambda: ctypes.WinDLL("atcore")
+        ),
+        "ATUTIL": microscope._library.LazyLibrary(
+            lambda: ctypes.WinDLL("atutility"),
+            on_load=_initialise_utility_library,
+        ),
+    }
     CALLBACKTYPE = ctypes.WINFUNCTYPE(c_int, AT_H, POINTER(AT_WC), c_void_p)
 else:
-    _stdcall_libraries["ATCORE"] = ctypes.CDLL("atcore.so")
-    _stdcall_libraries["ATUTIL"] = ctypes.CDLL("atutility.so")
+    _stdcall_libraries = {
+        "ATCORE": microscope._library.LazyLibrary(
+            lambda: ctypes.CDLL("atcore.so")
+        ),
+        "ATUTIL": microscope._library.LazyLibrary(
+            lambda: ctypes.CDLL("atutility.so"),
+            on_load=_initialise_utility_library,
+        ),
+    }
     CALLBACKTYPE = ctypes.CFUNCTYPE(c_int, AT_H, POINTER(AT_WC), c_void_p)
 
 #### Defines
@@ -167,9 +188,9 @@ def stripMeta(val):
 
 class dllFunction:
     def __init__(self, name, args=[], argnames=[], lib="ATCORE"):
-        self.f = getattr(_stdcall_libraries[lib], name)
-        self.f.restype = c_int
-        self.f.argtypes = [stripMeta(a) for a in args]
+        self._lib = _stdcall_libraries[lib]
+        self._f = None
+        self.argtypes = [stripMeta(a) for a in args]
 
         self.fargs = args
         self.fargnames = argnames
@@ -191,7 +212,18 @@ class dllFunction:
                 an = argnames[i]
             ds += "\t%s\t%s\n" % (args[i], an)
 
-        self.f.__doc__ = ds
+        self.__doc__ = ds
+
+    @property
+    def f(self):
+        """The library function, looked up on first use."""
+        if self._f is None:
+            f = getattr(self._lib, self.name)
+            f.restype = c_int
+            f.argtypes = self.argtypes
+            f.__doc__ = self.__doc__
+            self._f = f
+        return self._f
 
     def __call__(self, *args):
         ars = []
@@ -316,6 +348,3 @@ dllFunc(
     [POINTER(AT_U8), POINTER(AT_U8), AT_64, STRING],
     lib="ATUTIL",
 )
-
-# Initialize the utility library
-InitialiseUtilityLibrary()
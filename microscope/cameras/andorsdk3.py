@@ -26,6 +26,7 @@ a camera and all its settings to be exposed over Pyro.
 import logging
 import queue
 import time
+import typing
 
 import numpy as np
 
@@ -202,8 +203,50 @@ INVALIDATES_BUFFERS = [
     "_aoi_top",
     "_aoi_width",
     "_aoi_height",
+    "_metadata_enable",
+    "_metadata_timestamp",
+    "_pixel_encoding",
 ]
 
+# Pixel encodings with the "native pixel encoding" setting.  Unpacked
+# encodings are sent as they are, other than removing the row
+# padding.  Packed encodings are sent as bytes for the client to
+# unpack (see microscope.abc.unpack_pixels).  Other encodings are
+# always converted to Mono16.
+_UNPACKED_ENCODINGS = {
+    "Mono8": np.uint8,
+    "Mono12": np.uint16,
+    "Mono16": np.uint16,
+    "Mono32": np.uint32,
+}
+_PACKED_ENCODINGS = {"Mono12Packed"}
+
+# Identifiers of the metadata blocks appended to the image data.
+_METADATA_CID_FRAME = 0
+_METADATA_CID_TICKS = 1
+
+
+def _metadata_ticks(buf: np.ndarray) -> typing.Optional[int]:
+    """Find the timestamp, in clock ticks, on the metadata of a buffer.
+
+    Each metadata block is made of its data followed by a 4 bytes
+    identifier and a 4 bytes length (of identifier and data).  The
+    blocks are appended to the image data so must be read from the
+    end of the buffer.
+    """
+    end = buf.size
+    while end >= 8:
+        length = int(buf[end - 4 : end].view("<u4")[0])
+        cid = int(buf[end - 8 : end - 4].view("<u4")[0])
+        start = end - 4 - length
+        if start < 0 or cid == _METADATA_CID_FRAME:
+            break
+        if cid == _METADATA_CID_TICKS:
+            return int(buf[start : start + 8].view("<u8")[0])
+        end = start
+    return None
+
+
 
 class AndorSDK3(
     microscope.abc.FloatingDeviceMixin, microscope.abc.Camera,
@@ -316,13 +359,30 @@ class AndorSDK3(
             lambda: (1, 100),
         )
         self.buffers = queue.Queue()
+        # Memory of the buffers, kept when the image size changes.
+        self._buffer_arena = microscope.abc.BufferArena(alignment=8)
         self._buffer_size = None
         self._img_stride = None
         self._img_width = None
         self._img_height = None
         self._img_encoding = None
+        # Send the pixel encoding of the camera instead of Mono16.
+        self._native_encoding = False
+        self.add_setting(
+            "native pixel encoding",
+            "bool",
+            lambda: self._native_encoding,
+            self._set_native_encoding,
+            None,
+        )
+        # Frequency of the timestamp clock, or None if the buffers
+        # have no timestamp metadata.
+        self._timestamp_frequency = None
         self._buffers_valid = False
         self._exposure_callback = None
+        # Pointer and length of a buffer returned by WaitBuffer in
+        # _wait_for_data and not yet processed by _fetch_data.
+        self._waited_buffer = None
 
         self.initialize()
 
@@ -368,6 +428,7 @@ class AndorSDK3(
                 "Can not modify buffers while camera acquiring."
             )
         SDK3.Flush(self.handle)
+        self._waited_buffer = None
         while True:
             try:
                 self.buffers.get(block=False)
@@ -388,12 +449,21 @@ class AndorSDK3(
         self._img_encoding = self._pixel_encoding.get_string()
         img_size = self._image_size_bytes.get_value()
         self._buffer_size = img_size
-        for i in range(num):
-            buf = np.require(
-                np.empty(img_size),
-                dtype="uint8",
-                requirements=["C_CONTIGUOUS", "ALIGNED", "OWNDATA"],
-            )
+        self._timestamp_frequency = None
+        try:
+            if (
+                self._metadata_enable.get_value()
+                and self._metadata_timestamp.get_value()
+            ):
+                self._timestamp_frequency = (
+                    self._timestamp_clock_frequency.get_value()
+                )
+        except AttributeError:
+            # Metadata not implemented on this camera.
+            pass
+        # Most changes of AOI or binning make the image smaller, so
+        # this only allocates memory when the number of buffers grows.
+        for buf in self._buffer_arena.get(num, img_size):
             self.buffers.put(buf)
             SDK3.QueueBuffer(
                 self.handle, buf.ctypes.data_as(DPTR_TYPE), img_size
@@ -407,32 +477,60 @@ class AndorSDK3(
         def wrapper(self, *args, **kwargs):
             func(self, *args, **kwargs)
             outerself._buffers_valid = False
+            outerself._frame_pool.clear()
 
         return wrapper
 
-    def _fetch_data(self, timeout=5, debug=False):
-        """Fetch data and recycle buffers."""
+    def _wait_for_data(self, timeout):
+        if self._waited_buffer is not None:
+            return
         try:
-            ptr, length = SDK3.WaitBuffer(self.handle, timeout)
-        except SDK3.TimeoutError as e:
-            if debug:
-                _logger.debug(e)
-            return None
+            self._waited_buffer = SDK3.WaitBuffer(
+                self.handle, int(timeout * 1000)
+            )
+        except SDK3.TimeoutError:
+            pass
+
+    def _fetch_data(self, timeout=0, debug=False):
+        """Fetch data and its metadata and recycle buffers.
+
+        Args:
+            timeout: time, in milliseconds, to wait for a buffer.
+                Only used if there is no buffer from
+                :meth:`_wait_for_data`.
+        """
+        if self._waited_buffer is not None:
+            ptr, length = self._waited_buffer
+            self._waited_buffer = None
+        else:
+            try:
+                ptr, length = SDK3.WaitBuffer(self.handle, timeout)
+            except SDK3.TimeoutError as e:
+                if debug:
+                    _logger.debug(e)
+                return None
 
         raw = self.buffers.get()
-        width = self._img_width
-        height = self._img_height
-        data = raw  # .reshape((-1, bytes_per_row))[:, 0:width].copy()
-        data = np.empty((height, width), dtype="uint16")
-        SDK3.ConvertBuffer(
-            ptr,
-            data.ctypes.data_as(DPTR_TYPE),
-            width,
-            height,
-            self._img_stride,
-            self._img_encoding,
-            "Mono16",
-        )
+        data, metadata = self._native_data(raw)
+        if data is None:
+            width = self._img_width
+            height = self._img_height
+            data = self._frame_pool.get((height, width), "uint16")
+            SDK3.ConvertBuffer(
+                ptr,
+                data.ctypes.data_as(DPTR_TYPE),
+                width,
+                height,
+                self._img_stride,
+                self._img_encoding,
+                "Mono16",
+            )
+        if self._timestamp_frequency:
+            ticks = _metadata_ticks(raw)
+            if ticks is not None:
+                metadata = metadata._replace(
+                    hardware_timestamp=ticks / self._timestamp_frequency
+                )
         # Requeue the buffer if buffer size has not been changed elsewhere.
         if raw.size == self._buffer_size:
             self.buffers.put(raw)
@@ -440,7 +538,44 @@ class AndorSDK3(
         else:
             del raw
 
-        return data
+        return data, metadata
+
+    def _native_data(self, raw: np.ndarray):
+        """Copy the image in its native encoding without the padding.
+
+        Returns `None` for the data if it needs to be converted to
+        Mono16 instead.  Packed data is not transformed so it's only
+        sent if the transform is done by the client, or there's no
+        transform.
+        """
+        metadata = microscope.FrameMetadata()
+        if not self._native_encoding:
+            return None, metadata
+        width = self._img_width
+        height = self._img_height
+        if self._img_encoding in _UNPACKED_ENCODINGS:
+            dtype = _UNPACKED_ENCODINGS[self._img_encoding]
+            data = self._frame_pool.get((height, width), dtype)
+            row_bytes = width * data.itemsize
+        elif self._img_encoding in _PACKED_ENCODINGS and (
+            self._transform_on_client or not any(self._transform)
+        ):
+            row_bytes = (width * 3 + 1) // 2
+            data = self._frame_pool.get((height, row_bytes), np.uint8)
+            metadata = metadata._replace(pixel_encoding=self._img_encoding)
+        else:
+            return None, metadata
+        rows = raw[: height * self._img_stride].reshape(
+            height, self._img_stride
+        )
+        np.copyto(
+            data.view(np.uint8).reshape(height, row_bytes),
+            rows[:, :row_bytes],
+        )
+        return data, metadata
+
+    def _set_native_encoding(self, value: bool) -> None:
+        self._native_encoding = bool(value)
 
     def abort(self):
         """Abort acquisition."""
@@ -489,6 +624,11 @@ class AndorSDK3(
 
                 if name in INVALIDATES_BUFFERS:
                     set_func = self.invalidate_buffers(set_func)
+                    live = False
+                else:
+                    # Features that the camera reports writable during
+                    # acquisition are changed without stopping it.
+                    live = lambda f=is_readonly_func: not f()
 
                 self.add_setting(
                     name.lstrip("_"),
@@ -497,9 +637,11 @@ class AndorSDK3(
                     set_func,
                     vals_func,
                     is_readonly_func,
+                    live=live,
                 )
         # Default setup.
         self.set_cooling(True)
+        self._enable_timestamp_metadata()
         if not self._camera_model.getValue().startswith("SIMCAM"):
             self._trigger_mode.set_string("Software")
             self._cycle_mode.set_string("Continuous")
@@ -507,10 +649,11 @@ class AndorSDK3(
             _logger.warn("No hardware found - using SIMCAM")
 
         def callback(*args):
-            data = self._fetch_data(timeout=500)
+            result = self._fetch_data(timeout=500)
             timestamp = time.time()
-            if data is not None:
-                self._put(data, timestamp)
+            if result is not None:
+                data, metadata = result
+                self._put(data, timestamp, metadata)
                 return 0
             else:
                 return -1
@@ -523,6 +666,13 @@ class AndorSDK3(
         except AttributeError:
             pass
 
+    def _enable_timestamp_metadata(self):
+        try:
+            self._metadata_enable.set_value(True)
+            self._metadata_timestamp.set_value(True)
+        except AttributeError:
+            pass
+
     def get_id(self):
         return self._serial_number.get_value()
 
@@ -543,7 +693,9 @@ class AndorSDK3(
         _logger.debug("Acquisition enabled: %s.", self._acquiring)
         return True
 
-    @microscope.abc.keep_acquiring
+    @microscope.abc.keep_acquiring(
+        live=lambda self, value: not self._exposure_time.is_readonly()
+    )
     def set_exposure_time(self, value):
         bounded_value = sorted(
             (self._exposure_time.min(), self._exposure_time.max(), value)
@@ -608,7 +760,7 @@ class AndorSDK3(
         as_text = "%dx%d" % (binning.h, binning.v)
         if as_text in modes:
             self._aoi_binning.set_string(as_text)
-            self._create_buffers()
+            self._buffers_valid = False
             return True
         else:
             return False
@@ -637,6 +789,7 @@ class AndorSDK3(
             self._aoi_left.set_value(current.left)
             self._aoi_top.set_value(current.top)
             return False
+        self._buffers_valid = False
         return True
 
     def get_gain(self):
@@ -64,6 +64,7 @@ import numpy as np
 from numpy.ctypeslib import ndpointer
 
 import microscope
+import microscope._library
 import microscope.abc
 
 
@@ -88,9 +89,11 @@ if arch == "32bit":
 else:
     _dllName = "atmcd64d"
 if os.name in ("nt", "ce"):
-    _dll = ctypes.WinDLL(_dllName)
+    _dll = microscope._library.LazyLibrary(lambda: ctypes.WinDLL(_dllName))
 else:
-    _dll = ctypes.CDLL(_dllName + ".so")
+    _dll = microscope._library.LazyLibrary(
+        lambda: ctypes.CDLL(_dllName + ".so")
+    )
 
 # Andor's types
 at_32 = c_long
@@ -625,12 +628,11 @@ class dllFunction:
     """A wrapper class for DLL functions to make them available in python."""
 
     def __init__(self, name, args=[], argnames=[], rstatus=False, lib=_dll):
-        # the library function
-        self.f = getattr(lib, name)
-        # dll call return type
-        self.f.restype = c_uint
+        # the library, the function is only looked up on first use
+        self._lib = lib
+        self._f = None
         # dll call parameter types
-        self.f.argtypes = [stripMeta(a) for a in args]
+        self.argtypes = [stripMeta(a) for a in args]
         # dll call parameters, with their meta wrappers
         self.fargs = args
         # dll call parameter names, used to generate helpstrings
@@ -658,10 +660,31 @@ class dllFunction:
             if i < len(argnames):
                 an = argnames[i]
             ds += "\t%s\t%s\n" % (args[i], an)
-        self.f.__doc__ = ds
+        self.__doc__ = ds
 
-    def __call__(self, *args):
-        """Parse arguments, allocate any required storage, and execute the call."""
+    @property
+    def f(self):
+        """The library function, looked up on first use."""
+        if self._f is None:
+            try:
+                f = getattr(self._lib, self.name)
+            except AttributeError as e:
+                raise microscope.LibraryLoadError(
+                    "Error wrapping dll function '%s'" % self.name
+                ) from e
+            # dll call return type
+            f.restype = c_uint
+            f.argtypes = self.argtypes
+            f.__doc__ = self.__doc__
+            self._f = f
+        return self._f
+
+    def __call__(self, *args, out=None):
+        """Parse arguments, allocate any required storage, and execute the call.
+
+        If `out` is given, it is used as storage for an output array
+        instead of allocating a new one.
+        """
         # The C function arguments
         c_args = []
         i = 0
@@ -682,7 +705,10 @@ class dllFunction:
                     size = args[self.arr_size_arg_pos]
                 else:
                     size = bs
-                r, c_arg = farg.getVar(size)
+                if out is not None and isinstance(farg, OUTARR):
+                    r, c_arg = out, out
+                else:
+                    r, c_arg = farg.getVar(size)
                 c_args.append(c_arg)
                 ret.append(r)
             elif isinstance(farg, _OUTSTRLEN):
@@ -1595,6 +1621,25 @@ class AndorAtmcd(
                 name, "bool", None, self._bind(SetHighCapacity), None
             )
 
+    def _wait_for_data(self, timeout):
+        # Waiting by handle does not require to select this camera
+        # so we can do it without holding the lock.
+        start = time.monotonic()
+        try:
+            WaitForAcquisitionByHandleTimeOut(
+                self._handle, int(timeout * 1000)
+            )
+        except AtmcdException as e:
+            # The wait was cancelled or timed out.
+            if e.status != DRV_NO_NEW_DATA:
+                raise e
+            # It also fails immediately if the camera is not
+            # acquiring.  Sleep for the rest of the timeout, otherwise
+            # the fetch loop spins while the camera is idle.
+            remaining = timeout - (time.monotonic() - start)
+            if remaining > 0:
+                time.sleep(remaining)
+
     def _fetch_data(self):
         """Poll for data and return it, with minimal processing.
 
@@ -1604,10 +1649,12 @@ class AndorAtmcd(
         roi = self._roi
         width = roi.width // binning.h
         height = roi.height // binning.v
+        data = self._frame_pool.get((height, width), "uint16")
         try:
             with self:
-                data = GetOldestImage16(width * height).reshape(height, width)
+                GetOldestImage16(width * height, out=data)
         except AtmcdException as e:
+            self._frame_pool.release(data)
             if e.status == DRV_NO_NEW_DATA:
                 return None
             else:
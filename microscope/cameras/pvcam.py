@@ -26,7 +26,9 @@
 This module exposes pvcam C library functions in python.
 
 .. todo::
-   Support frame metadata.  The following functions are still not implemented::
+   Support extended frame metadata.  Of the following functions,
+   only `pl_md_frame_decode`, `pl_md_create_frame_struct_cont`, and
+   `pl_md_release_frame_struct` are implemented::
 
     /*****************************************************************************/
     /*****************************************************************************/
@@ -133,17 +135,21 @@ This module exposes pvcam C library functions in python.
 
 """
 
+import collections
 import ctypes
 import logging
 import os
 import platform
+import threading
 import time
+import typing
 import weakref
 
 import numpy as np
 import Pyro4
 
 import microscope
+import microscope._library
 import microscope.abc
 
 
@@ -674,13 +680,19 @@ class md_frame(ctypes.Structure):
     ]
 
 
-if os.name in ("nt", "ce"):
-    if platform.architecture()[0] == "32bit":
-        _lib = ctypes.WinDLL("pvcam32")
+def _load_lib():
+    if os.name in ("nt", "ce"):
+        if platform.architecture()[0] == "32bit":
+            return ctypes.WinDLL("pvcam32")
+        else:
+            return ctypes.WinDLL("pvcam64")
     else:
-        _lib = ctypes.WinDLL("pvcam64")
-else:
-    _lib = ctypes.CDLL("pvcam.so")
+        return ctypes.CDLL("pvcam.so")
+
+
+# The library is only loaded, and its functions looked up, when first
+# used and not when this module is imported.
+_lib = microscope._library.LazyLibrary(_load_lib)
 
 ### Functions ###
 STRING = ctypes.c_char_p
@@ -736,9 +748,9 @@ class dllFunction:
     (Again, largely nicked from PYME.)"""
 
     def __init__(self, name, args=[], argnames=[], buf_len=-1, lib=_lib):
-        self.f = getattr(lib, name)
-        self.f.restype = rs_bool
-        self.f.argtypes = [stripMeta(a) for a in args]
+        self._lib = lib
+        self._f = None
+        self.argtypes = [stripMeta(a) for a in args]
 
         self.fargs = args
         self.fargnames = argnames
@@ -757,7 +769,18 @@ class dllFunction:
                 an = argnames[i]
             docstring += "\t%s\t%s\n" % (args[i], an)
 
-        self.f.__doc__ = docstring
+        self.__doc__ = docstring
+
+    @property
+    def f(self):
+        """The library function, looked up on first use."""
+        if self._f is None:
+            f = getattr(self._lib, self.name)
+            f.restype = rs_bool
+            f.argtypes = self.argtypes
+            f.__doc__ = self.__doc__
+            self._f = f
+        return self._f
 
     def __call__(self, *args, **kwargs):
         ars = []
@@ -780,7 +803,7 @@ class dllFunction:
 
         for j in range(len(self.inp)):
             if self.inp[j]:  # an input
-                if self.f.argtypes[j] is CALLBACK and not isinstance(
+                if self.argtypes[j] is CALLBACK and not isinstance(
                     args[i], CALLBACK
                 ):
                     ars.append(CALLBACK(args[i]))
@@ -1005,6 +1028,22 @@ dllFunc("pl_exp_abort", [int16, int16], ["hcam", "cam_state"])
 dllFunc(
     "pl_exp_finish_seq", [int16, ctypes.c_void_p], ["hcam", "pixel_stream"]
 )
+# Frame metadata functions.
+dllFunc(
+    "pl_md_frame_decode",
+    [ctypes.POINTER(md_frame), ctypes.c_void_p, uns32],
+    ["pDstFrame", "pSrcBuf", "srcBufSize"],
+)
+dllFunc(
+    "pl_md_create_frame_struct_cont",
+    [OUTPUT(ctypes.POINTER(md_frame)), uns16],
+    ["pFrame", "roiCount"],
+)
+dllFunc(
+    "pl_md_release_frame_struct",
+    [ctypes.POINTER(md_frame)],
+    ["pFrame"],
+)
 
 
 # Map ATTR_ enums to the return type for that ATTR.
@@ -1393,8 +1432,32 @@ class PVCamera(
         self.exposure_time = 0.001  # in seconds
         # Cycle time
         self.cycle_time = self.exposure_time
-        # Data buffer.
+        # Data buffer, a view of the buffer arena which keeps its
+        # memory across enables and changes of ROI.  It has the raw
+        # frames, of _frame_bytes each, which may include metadata.
         self._buffer = None
+        self._buffer_arena = microscope.abc.BufferArena()
+        self._frame_bytes = 0
+        self._frame_dtype = np.dtype("uint16")
+        self._frame_shape = (0, 0)
+        # Regions for multi-ROI acquisition.  If empty, the single
+        # region from roi is used.
+        self._rois: typing.List[microscope.ROI] = []
+        # Structure to decode frames with multiple regions.
+        self._md_frame = None
+        # In circular buffer mode, whether frames are sent as views of
+        # the buffer instead of copies.
+        self._zero_copy = False
+        # Frames of the circular buffer with views still to be sent,
+        # oldest first, each as a list with the number of views not
+        # yet released.  The acquisition id changes on abort.
+        self._locked_frames = collections.deque()
+        # Number of frames acquired but not yet fetched from the
+        # circular buffer, and whether a thread is fetching them.
+        self._pending_frames = 0
+        self._fetching_frames = False
+        self._locked_frames_lock = threading.Lock()
+        self._acquisition_id = 0
         # This devices PVCAM parameters.
         self._params = {}
         # Circular buffer length.
@@ -1422,21 +1485,16 @@ class PVCamera(
             lambda value: setattr(self, "_circ_buffer_length", value),
             (2, 100),
         )
+        self.add_setting(
+            "zero-copy frames",
+            "bool",
+            lambda: self._zero_copy,
+            self._set_zero_copy,
+            None,
+        )
 
         self.initialize()
 
-    @property
-    def _region(self):
-        """Return a rgn_type for current roi and binning settings."""
-        return rgn_type(
-            self.roi.left,
-            self.roi.left + self.roi.width - 1,
-            self.binning.h,
-            self.roi.top,
-            self.roi.top + self.roi.height - 1,
-            self.binning.v,
-        )
-
     """Private methods, called here and within super classes."""
 
     def _fetch_data(self):
@@ -1462,6 +1520,16 @@ class PVCamera(
         buffer_dtype = "uint16"
         if self._params[PARAM_BIT_DEPTH].current == 8:
             buffer_dtype = "uint8"
+        self._frame_dtype = np.dtype(buffer_dtype)
+        self._frame_shape = (
+            self.roi.height // self.binning.v,
+            self.roi.width // self.binning.h,
+        )
+        regions = self._regions()
+        # Multiple regions are only described in the frame metadata.
+        if PARAM_METADATA_ENABLED in self._params:
+            self._params[PARAM_METADATA_ENABLED].set_value(len(regions) > 1)
+        self._prepare_frame_decoding(len(regions))
         # Configure camera, allocate buffer, and register callback.
         if self._trigger == TRIG_SOFT:
             # Software triggering for single frames.
@@ -1471,10 +1539,15 @@ class PVCamera(
             def cb():
                 """Soft trigger mode end-of-frame callback."""
                 timestamp = time.time()
-                frame = self._buffer.copy()
+                frames = []
+                for view, roi in self._frame_views(self._buffer):
+                    frame = self._frame_pool.get(view.shape, view.dtype)
+                    np.copyto(frame, view)
+                    frames.append((frame, microscope.FrameMetadata(roi=roi)))
                 _logger.debug("Fetched single frame.")
                 _exp_finish_seq(self.handle, CCS_CLEAR)
-                self._put(frame, timestamp)
+                for frame, metadata in frames:
+                    self._put(frame, timestamp, metadata)
                 return
 
             # Need to keep a reference to the callback.
@@ -1485,40 +1558,44 @@ class PVCamera(
             nbytes = _exp_setup_seq(
                 self.handle,
                 1,
-                1,  # cam, num epxosures, num regions
-                self._region,
+                len(regions),  # cam, num epxosures, num regions
+                regions,
                 TRIGGER_MODES[self._trigger].pv_mode,
                 t_exp,
-            )
-            buffer_shape = (
-                self.roi.height // self.binning.v,
-                self.roi.width // self.binning.h,
-            )
-            self._buffer = np.require(
-                np.zeros(buffer_shape, dtype=buffer_dtype),
-                requirements=["C_CONTIGUOUS", "ALIGNED", "OWNDATA"],
-            )
+            ).value
+            self._frame_bytes = nbytes
+            (self._buffer,) = self._buffer_arena.get(1, nbytes)
         else:
             # Use a circular buffer.
             self._using_callback = True
 
-            # Determine the data type of the frame
-            frame_type = uns16
-            if buffer_dtype == "uint8":
-                frame_type = uns8
+            # Filled by PVCAM with the frame number and timestamps.
+            frame_info = FRAME_INFO()
 
             def cb():
                 """Circular buffer mode end-of-frame callback."""
+                if self._zero_copy:
+                    with self._locked_frames_lock:
+                        self._pending_frames += 1
+                    self._fetch_locked_frames()
+                    return
                 timestamp = time.time()
-                frame_p = ctypes.cast(
-                    _exp_get_latest_frame(self.handle),
-                    ctypes.POINTER(frame_type),
+                address = _exp_get_latest_frame_ex(self.handle, frame_info)
+                views = self._frame_views(self._buffer_frame(address.value))
+                # The frame timestamps are in units of 100 ns.  Lost
+                # frames show as gaps in the frame numbers.
+                metadata = microscope.FrameMetadata(
+                    hardware_timestamp=frame_info.TimeStamp * 1e-7,
+                    frame_number=frame_info.FrameNr,
                 )
-                frame = np.ctypeslib.as_array(
-                    frame_p, (self.roi[2], self.roi[3])
-                ).copy()
+                frames = []
+                for view, roi in views:
+                    frame = self._frame_pool.get(view.shape, view.dtype)
+                    np.copyto(frame, view)
+                    frames.append((frame, roi))
                 _logger.debug("Fetched frame from circular buffer.")
-                self._put(frame, timestamp)
+                for frame, roi in frames:
+                    self._put(frame, timestamp, metadata._replace(roi=roi))
                 return
 
             # Need to keep a reference to the callback.
@@ -1526,24 +1603,20 @@ class PVCamera(
             _cam_register_callback(
                 self.handle, PL_CALLBACK_EOF, self._eof_callback
             )
-            buffer_shape = (
-                self._circ_buffer_length,
-                self.roi.height // self.binning.v,
-                self.roi.width // self.binning.h,
-            )
-            self._buffer = np.require(
-                np.zeros(buffer_shape, dtype=buffer_dtype),
-                requirements=["C_CONTIGUOUS", "ALIGNED", "OWNDATA"],
-            )
+            # Without overwrite, frames sent as views of the buffer
+            # are kept until released.
             nbytes = _exp_setup_cont(
                 self.handle,
-                1,
-                self._region,
+                len(regions),
+                regions,
                 TRIGGER_MODES[self._trigger].pv_mode,
                 t_exp,
-                CIRC_OVERWRITE,
+                CIRC_NO_OVERWRITE if self._zero_copy else CIRC_OVERWRITE,
             ).value
-
+            self._frame_bytes = nbytes
+            (self._buffer,) = self._buffer_arena.get(
+                1, self._circ_buffer_length * nbytes
+            )
         # Read back exposure time.
         t_readback = self._params[PARAM_EXPOSURE_TIME].current
         t_resolution = self._params[PARAM_EXP_RES].current
@@ -1577,6 +1650,155 @@ class PVCamera(
         self._acquiring = True
         return self._acquiring
 
+    def _regions(self):
+        """Return an array of rgn_type for the ROIs and binning."""
+        rois = self._rois or [self.roi]
+        regions = (rgn_type * len(rois))()
+        for region, roi in zip(regions, rois):
+            region.s1 = roi.left
+            region.s2 = roi.left + roi.width - 1
+            region.sbin = self.binning.h
+            region.p1 = roi.top
+            region.p2 = roi.top + roi.height - 1
+            region.pbin = self.binning.v
+        return regions
+
+    def _prepare_frame_decoding(self, n_regions: int) -> None:
+        """Create the structure to decode frames with multiple regions."""
+        if self._md_frame is not None:
+            _md_release_frame_struct(self._md_frame)
+            self._md_frame = None
+        if n_regions > 1:
+            self._md_frame = _md_create_frame_struct_cont(n_regions)
+
+    def _buffer_frame(self, address: int) -> np.ndarray:
+        """Return the frame at address as a view of the buffer."""
+        offset = address - self._buffer.ctypes.data
+        return self._buffer[offset : offset + self._frame_bytes]
+
+    def _frame_views(self, frame: np.ndarray) -> typing.List[tuple]:
+        """Return views of the image of each region in a raw frame.
+
+        Returns a list of tuples with the image and its region.  The
+        region is `None` if there is only the one from
+        :meth:`set_roi`.  The views keep a reference to the buffer so
+        its memory stays valid, if not its content, while they exist.
+        """
+        if self._md_frame is None:
+            n_pixels = int(np.prod(self._frame_shape))
+            image = frame[: n_pixels * self._frame_dtype.itemsize].view(
+                self._frame_dtype
+            )
+            return [(image.reshape(self._frame_shape), None)]
+        _md_frame_decode(
+            self._md_frame, frame.ctypes.data_as(ctypes.c_void_p), frame.nbytes
+        )
+        md_frame = self._md_frame.contents
+        views = []
+        for md_roi in md_frame.roiArray[: md_frame.roiCount]:
+            rgn = md_roi.header.contents.roi
+            width = rgn.s2 - rgn.s1 + 1
+            height = rgn.p2 - rgn.p1 + 1
+            offset = md_roi.data - frame.ctypes.data
+            data = frame[offset : offset + md_roi.dataSize]
+            views.append(
+                (
+                    data.view(self._frame_dtype).reshape(
+                        height // rgn.pbin, width // rgn.sbin
+                    ),
+                    microscope.ROI(rgn.s1, rgn.p1, width, height),
+                )
+            )
+        return views
+
+    def _fetch_locked_frames(self) -> None:
+        """Send the acquired frames as views of the circular buffer.
+
+        PVCAM only gives the oldest frame in the buffer, which stays
+        the same until it is unlocked, so frames are fetched one at a
+        time, in order, when the previous one has been released.  This
+        is called on each end of frame and when a frame is unlocked.
+        Only one thread fetches at a time, any other returns and
+        leaves the frames to that one.
+        """
+        while True:
+            with self._locked_frames_lock:
+                if (
+                    self._fetching_frames
+                    or not self._pending_frames
+                    or self._locked_frames
+                ):
+                    return
+                timestamp = time.time()
+                frame_info = FRAME_INFO()
+                address = _exp_get_oldest_frame_ex(self.handle, frame_info)
+                views = self._frame_views(self._buffer_frame(address.value))
+                self._pending_frames -= 1
+                if self._pending_frames >= self._circ_buffer_length - 1:
+                    _logger.warning(
+                        "circular buffer is full, frames will be lost until"
+                        " the data is sent"
+                    )
+                release = self._lock_frame(len(views))
+                for view, roi in views:
+                    self._frame_pool.lend(view, release)
+                self._fetching_frames = True
+            # The frame timestamps are in units of 100 ns.  Lost
+            # frames show as gaps in the frame numbers.
+            metadata = microscope.FrameMetadata(
+                hardware_timestamp=frame_info.TimeStamp * 1e-7,
+                frame_number=frame_info.FrameNr,
+            )
+            _logger.debug("Fetched frame from circular buffer.")
+            try:
+                for view, roi in views:
+                    self._put(view, timestamp, metadata._replace(roi=roi))
+            finally:
+                with self._locked_frames_lock:
+                    self._fetching_frames = False
+
+    def _lock_frame(self, n_views: int) -> typing.Callable[[], None]:
+        """Keep the oldest frame locked until all its views are released.
+
+        Must be called with the locked frames lock held.  Returns the
+        function to call when each view is released.  PVCAM unlocks
+        frames in order so a frame is only unlocked when it, and all
+        frames before it, have been released.
+        """
+        counter = [n_views]
+        acquisition = self._acquisition_id
+        self._locked_frames.append(counter)
+
+        def release():
+            with self._locked_frames_lock:
+                if acquisition != self._acquisition_id:
+                    return
+                counter[0] -= 1
+                while self._locked_frames and self._locked_frames[0][0] <= 0:
+                    self._locked_frames.popleft()
+                    try:
+                        _exp_unlock_oldest_frame(self.handle)
+                    except microscope.DeviceError as e:
+                        _logger.error("failed to unlock frame", exc_info=e)
+            try:
+                self._fetch_locked_frames()
+            except Exception as e:
+                _logger.error("failed to fetch frame", exc_info=e)
+
+        return release
+
+    def _forget_locked_frames(self) -> None:
+        """Stop tracking the frames locked by an acquisition that ended."""
+        with self._locked_frames_lock:
+            self._acquisition_id += 1
+            if self._locked_frames:
+                # Views of the buffer that are still to be sent keep
+                # a reference to its memory.  Use new memory for the
+                # next acquisitions so it is not overwritten.
+                self._buffer_arena = microscope.abc.BufferArena()
+            self._locked_frames.clear()
+            self._pending_frames = 0
+
     def _do_disable(self):
         """Disable the hardware for a short period of inactivity."""
         self.abort()
@@ -1585,6 +1807,7 @@ class PVCamera(
     def _do_shutdown(self) -> None:
         """Disable the hardware for a prolonged period of inactivity."""
         self.abort()
+        self._prepare_frame_decoding(0)
         _cam_close(self.handle)
         PVCamera.open_cameras.remove(self.handle)
         if not PVCamera.open_cameras:
@@ -1606,7 +1829,8 @@ class PVCamera(
     @microscope.abc.keep_acquiring
     def _set_binning(self, binning):
         """Set binning to (h, v)."""
-        #  The keep_acquiring decorator will cause recreation of buffers.
+        #  The keep_acquiring decorator will cause reconfiguration of
+        #  the acquisition and buffers.
         self.binning = microscope.Binning(binning.h, binning.v)
 
     def _get_roi(self):
@@ -1618,12 +1842,51 @@ class PVCamera(
         """Set the ROI to (left, tip, width, height)."""
         right = roi.left + roi.width
         bottom = roi.top + roi.height
-        if (right, bottom) > self.shape:
+        if right > self.shape[0] or bottom > self.shape[1]:
             raise ValueError("ROI exceeds sensor area.")
         self.roi = roi
 
+    @microscope.abc.keep_acquiring
+    def _set_zero_copy(self, value: bool) -> None:
+        self._zero_copy = value
+
     """Public methods, callable from client."""
 
+    def get_rois(self) -> typing.List[microscope.ROI]:
+        """Return the regions for multi-ROI acquisition."""
+        return list(self._rois)
+
+    @microscope.abc.keep_acquiring
+    def set_rois(self, rois: typing.Sequence[microscope.ROI]) -> None:
+        """Acquire multiple regions in each frame.
+
+        Each region is sent as separate data, all with the same frame
+        number and with the region in the `roi` field of their
+        :class:`microscope.FrameMetadata`.  Like the hardware ROI, the
+        regions are in sensor coordinates, without the transform, and
+        share the binning.  An empty list goes back to the single ROI
+        from :meth:`set_roi`.  Multiple regions require a camera with
+        frame metadata.
+        """
+        rois = [microscope.ROI(*roi) for roi in rois]
+        if len(rois) > 1:
+            if PARAM_METADATA_ENABLED not in self._params:
+                raise microscope.UnsupportedFeatureError(
+                    "multiple ROIs require frame metadata"
+                )
+            max_count = 1
+            if PARAM_ROI_COUNT in self._params:
+                max_count = self._params[PARAM_ROI_COUNT].values[1]
+            if len(rois) > max_count:
+                raise ValueError("camera supports up to %d ROIs" % max_count)
+        for roi in rois:
+            right = roi.left + roi.width
+            bottom = roi.top + roi.height
+            if right > self.shape[0] or bottom > self.shape[1]:
+                raise ValueError("ROI %s exceeds sensor area." % (roi,))
+        self._frame_pool.clear()
+        self._rois = rois
+
     def get_id(self):
         """Get hardware's unique identifier."""
         return self._params[PARAM_HEAD_SER_NUM_ALPHA].current
@@ -1638,6 +1901,7 @@ class PVCamera(
         else:
             _exp_stop_cont(self.handle, CCS_CLEAR)
         _exp_abort(self.handle, CCS_HALT)
+        self._forget_locked_frames()
         self._acquiring = False
 
     def initialize(self):
@@ -34,9 +34,21 @@ Modifying the following settings require acquisition to be stopped:
 - ROIs
 - binning
 - trigger type (trigger source)
+- image data format
+- buffers queue size
 
 For more details, see the [XiAPI manual](https://www.ximea.com/support/wiki/apis/XiAPI_Manual#Flushing-the-queue).
 
+Buffers
+-------
+
+XiAPI keeps a queue of acquired images, in the "buffers queue size"
+setting, that have not been read yet.  Images are copied from there
+directly into arrays from the camera frame pool so that each frame
+has its own memory and is not overwritten by the next frame.  This
+is only possible for the monochrome and raw image data formats, for
+others the image is copied once read.
+
 Hardware trigger
 ----------------
 
@@ -57,8 +69,10 @@ PyPI.  See Ximea's website for `install instructions
 """
 
 import contextlib
+import ctypes
 import enum
 import logging
+import time
 import typing
 
 import numpy as np
@@ -81,6 +95,17 @@ _XI_ACQUISITION_STOPED = 45
 _XI_UNKNOWN_PARAM = 100
 
 
+# Image data formats in the "image data format" setting and the
+# dtype of their pixels.  The raw formats skip the processing on the
+# PC, which XiAPI does for the monochrome formats.
+_DATA_FORMAT_DTYPES = {
+    "XI_MONO8": np.uint8,
+    "XI_MONO16": np.uint16,
+    "XI_RAW8": np.uint8,
+    "XI_RAW16": np.uint16,
+}
+
+
 # During acquisition, we rely on catching timeout errors which then
 # get discarded.  However, with debug level set to warning (XiApi
 # default log level), we get XiApi messages on stderr for each timeout
@@ -189,6 +214,15 @@ class XimeaCamera(microscope.abc.Camera):
         self._acquiring = False
         self._handle = xiapi.Camera()
         self._img = xiapi.Image()
+        # Whether _img has an image from _wait_for_data that has not
+        # been returned by _fetch_data yet.
+        self._img_ready = False
+        # Array from the frame pool into which XiAPI copies the next
+        # image, and its shape and dtype.  The shape is None if images
+        # are not copied directly (see _prepare_image_buffer).
+        self._img_buffer: typing.Optional[np.ndarray] = None
+        self._img_shape: typing.Optional[typing.Tuple[int, int]] = None
+        self._img_dtype = None
         self._serial_number = serial_number
         self._sensor_shape = (0, 0)
         self._roi = microscope.ROI(None, None, None, None)
@@ -213,34 +247,92 @@ class XimeaCamera(microscope.abc.Camera):
             trg_source_names,
         )
 
+        data_format_names = list(_DATA_FORMAT_DTYPES.keys())
+
+        def _data_format_setter(index: int) -> None:
+            with _disabled_camera(self):
+                self._handle.set_imgdataformat(data_format_names[index])
+
+        def _data_format_getter() -> int:
+            return data_format_names.index(self._handle.get_imgdataformat())
+
+        self.add_setting(
+            "image data format",
+            "enum",
+            _data_format_getter,
+            _data_format_setter,
+            data_format_names,
+        )
+
+        def _queue_size_setter(size: int) -> None:
+            with _disabled_camera(self):
+                self._handle.set_buffers_queue_size(size)
+
+        self.add_setting(
+            "buffers queue size",
+            "int",
+            self._handle.get_buffers_queue_size,
+            _queue_size_setter,
+            lambda: (
+                self._handle.get_buffers_queue_size_minimum(),
+                self._handle.get_buffers_queue_size_maximum(),
+            ),
+        )
+
         self.initialize()
 
-    def _fetch_data(self) -> typing.Optional[np.ndarray]:
+    def _wait_for_data(self, timeout: float) -> None:
+        if self._img_ready:
+            return
         if not self._acquiring:
-            return None
-
+            # There's nothing to wait on, get_image would fail
+            # immediately.
+            time.sleep(timeout)
+            return
+
+        if self._img_shape is not None and self._img_buffer is None:
+            self._img_buffer = self._frame_pool.get(
+                self._img_shape, self._img_dtype
+            )
+            self._img.bp = self._img_buffer.ctypes.data_as(ctypes.c_void_p)
+            self._img.bp_size = self._img_buffer.nbytes
         try:
-            self._handle.get_image(self._img, timeout=1)
+            self._handle.get_image(self._img, timeout=int(timeout * 1000))
         except xiapi.Xi_error as err:
             # err.status may not exist so use getattr (see
             # https://github.com/python-microscope/vendor-issues/issues/2)
             if getattr(err, "status", None) == _XI_TIMEOUT:
-                return None
+                return
             elif (
                 getattr(err, "status", None) == _XI_ACQUISITION_STOPED
                 and not self._acquiring
             ):
                 # We can end up here during disable if self._acquiring
                 # was True but is now False.
-                return None
+                return
             else:
                 raise
+        self._img_ready = True
+
+    def _fetch_data(
+        self,
+    ) -> typing.Optional[typing.Tuple[np.ndarray, microscope.FrameMetadata]]:
+        if not self._img_ready:
+            return None
+        self._img_ready = False
 
-        data: np.ndarray = self._img.get_image_data_numpy()
-        _logger.info(
-            "Fetched imaged with dims %s and size %s.", data.shape, data.size
+        if self._img_buffer is not None:
+            data, self._img_buffer = self._img_buffer, None
+        else:
+            # The image data is only valid until the next get_image.
+            view = self._img.get_image_data_numpy()
+            data = self._frame_pool.get(view.shape, view.dtype)
+            np.copyto(data, view)
+        metadata = microscope.FrameMetadata(
+            hardware_timestamp=self._img.tsSec + self._img.tsUSec * 1e-6,
+            frame_number=self._img.nframe,
         )
-        return data
+        return data, metadata
 
     def abort(self):
         _logger.info("Disabling acquisition.")
@@ -330,18 +422,49 @@ class XimeaCamera(microscope.abc.Camera):
         _logger.info("Preparing for acquisition.")
         if self._acquiring:
             self.abort()
+        # Drop any image left from the previous acquisition.
+        self._img_ready = False
+        self._prepare_image_buffer()
         # actually start camera
         self._handle.start_acquisition()
         self._acquiring = True
         _logger.info("Acquisition enabled.")
         return True
 
+    def _prepare_image_buffer(self) -> None:
+        """Set how images are copied from the XiAPI buffers queue.
+
+        Images in one of the formats of :data:`_DATA_FORMAT_DTYPES`
+        and without padding are copied by XiAPI into arrays from the
+        frame pool.  Other images are read from XiAPI own buffers and
+        copied in :meth:`_fetch_data`.
+        """
+        if self._img_buffer is not None:
+            self._frame_pool.release(self._img_buffer)
+            self._img_buffer = None
+        self._img_shape = None
+        self._img_dtype = _DATA_FORMAT_DTYPES.get(
+            self._handle.get_imgdataformat()
+        )
+        if self._img_dtype is not None:
+            shape = (self._roi.height, self._roi.width)
+            nbytes = shape[0] * shape[1] * np.dtype(self._img_dtype).itemsize
+            if self._handle.get_imgpayloadsize() <= nbytes:
+                self._img_shape = shape
+        if self._img_shape is not None:
+            self._handle.set_buffer_policy("XI_BP_SAFE")
+        else:
+            self._img.bp = None
+            self._img.bp_size = 0
+            self._handle.set_buffer_policy("XI_BP_UNSAFE")
+
     def set_exposure_time(self, value: float) -> None:
         # exposure times are set in us.
         try:
             self._handle.set_exposure_direct(int(value * 1000000))
         except Exception as err:
             _logger.debug("set_exposure_time exception: %s", err)
+        self._invalidate_settings_cache()
 
     def get_exposure_time(self) -> float:
         # exposure times are in us, so multiple by 1E-6 to get seconds.
@@ -20,28 +20,87 @@
 """TODO: complete this docstring
 """
 
+import concurrent.futures
 import inspect
 import itertools
 import queue
 import socket
 import threading
+import typing
 
 import Pyro4
 
+import microscope
+import microscope._serializer
+import microscope._shared_memory
+import microscope.abc
+
 
 # Pyro configuration. Use pickle because it can serialize numpy ndarrays.
 Pyro4.config.SERIALIZERS_ACCEPTED.add("pickle")
 Pyro4.config.SERIALIZER = "pickle"
+# Devices may send data with the pickle5 serializer.
+microscope._serializer.register()
+if microscope._serializer.is_available():
+    Pyro4.config.SERIALIZERS_ACCEPTED.add(microscope._serializer.NAME)
 
 LISTENERS = {}
 
+# Executor for the asynchronous calls of all clients.  Created on the
+# first asynchronous call.
+_EXECUTOR: typing.Optional[concurrent.futures.ThreadPoolExecutor] = None
+_EXECUTOR_LOCK = threading.Lock()
+
+# Maximum number of asynchronous calls, and so of connections, to the
+# same device at the same time.  Other calls wait for one to finish.
+_MAX_ASYNC_PROXIES = 4
+
+
+def _get_executor() -> concurrent.futures.ThreadPoolExecutor:
+    global _EXECUTOR
+    with _EXECUTOR_LOCK:
+        if _EXECUTOR is None:
+            _EXECUTOR = concurrent.futures.ThreadPoolExecutor(
+                thread_name_prefix="microscope-client"
+            )
+        return _EXECUTOR
+
 
 class Client:
-    """Base Client object that makes methods on proxy available locally."""
+    """Base Client object that makes methods on proxy available locally.
+
+    Methods of the remote device can also be called asynchronously,
+    with :meth:`call_async`, which returns a
+    :class:`concurrent.futures.Future`.  This makes it possible to
+    reconfigure multiple devices in parallel instead of waiting for
+    each one in turn::
+
+        futures = [
+            camera.update_settings_async({"exposure": 0.1, "gain": 2}),
+            laser.update_settings_async({"power": 0.5}),
+        ]
+        concurrent.futures.wait(futures)
+
+    Asynchronous calls are made with their own connections to the
+    device, up to a few at the same time, so a slow call, e.g., to
+    move a stage, does not delay other calls to the same device, such
+    as a query of its position.  This requires the device server to
+    handle each connection on its own thread, which is its default
+    (see :class:`microscope.device_server.DeviceServerOptions`).
+    These connections are closed with :meth:`close_async_connections`,
+    or when the client is deleted.
+
+    """
 
     def __init__(self, url):
         self._url = url
         self._proxy = None
+        # Idle proxies for the asynchronous calls.  Each call takes
+        # one so that a slow call does not block the others, and
+        # there are at most _MAX_ASYNC_PROXIES.
+        self._async_proxies: typing.List[Pyro4.Proxy] = []
+        self._async_proxies_lock = threading.Lock()
+        self._async_calls = threading.BoundedSemaphore(_MAX_ASYNC_PROXIES)
         self._connect()
 
     def _connect(self):
@@ -66,13 +125,110 @@ class Client:
         for attr in itertools.chain(methods, properties):
             setattr(self, attr, getattr(self._proxy, attr))
 
+    def call_async(
+        self, name: str, *args, **kwargs
+    ) -> concurrent.futures.Future:
+        """Call a method of the remote device without waiting for it.
+
+        Returns:
+            A future with the value returned by the method.
+        """
+        return _get_executor().submit(
+            self._call_in_thread, name, *args, **kwargs
+        )
+
+    def _call_in_thread(self, name: str, *args, **kwargs):
+        with self._async_calls:
+            with self._async_proxies_lock:
+                if self._async_proxies:
+                    proxy = self._async_proxies.pop()
+                else:
+                    proxy = Pyro4.Proxy(self._url)
+            try:
+                return getattr(proxy, name)(*args, **kwargs)
+            finally:
+                with self._async_proxies_lock:
+                    self._async_proxies.append(proxy)
+
+    def close_async_connections(self) -> None:
+        """Close the connections used for the asynchronous calls.
+
+        This is not named `close` so that it does not hide a method
+        of the same name of the remote device.
+        """
+        with self._async_proxies_lock:
+            proxies, self._async_proxies = self._async_proxies, []
+        for proxy in proxies:
+            proxy._pyroRelease()
+
+    def __del__(self):
+        # The object may not be fully constructed.
+        if hasattr(self, "_async_proxies_lock"):
+            self.close_async_connections()
+
+    def get_setting_async(self, name: str) -> concurrent.futures.Future:
+        return self.call_async("get_setting", name)
+
+    def set_setting_async(
+        self, name: str, value
+    ) -> concurrent.futures.Future:
+        return self.call_async("set_setting", name, value)
+
+    def update_settings_async(
+        self, settings, init: bool = False
+    ) -> concurrent.futures.Future:
+        """Update multiple settings at once without waiting for it.
+
+        See :meth:`microscope.abc.Device.update_settings`.
+        """
+        return self.call_async("update_settings", settings, init)
+
 
 class DataClient(Client):
-    """A client that can receive and buffer data."""
+    """A client that can receive and buffer data.
 
-    def __init__(self, url):
+    Args:
+        url: the device Pyro URI.
+        shared_memory: receive the data via shared memory instead of
+            over Pyro.  This is only possible if the device is on the
+            same computer.  The data is copied out of the shared
+            memory when received, and dropped if the device already
+            overwrote it, i.e., if the client is too slow to keep up
+            (see :mod:`microscope._shared_memory`).
+        metadata: buffer the data together with its
+            :class:`microscope.FrameMetadata` instead of only its
+            timestamp.
+        drop_policy: if not `None`, subscribe to all data from the
+            device with this drop policy instead of being the current
+            client (see :meth:`microscope.abc.DataDevice.set_client`).
+        unpack: unpack data that the device sends in a packed pixel
+            encoding (see :func:`microscope.abc.unpack_pixels`).
+
+    If the device leaves the transform of the data to the client
+    (cameras with the "transform on client" setting), the buffered
+    data is a transformed view of the received data.  Similarly,
+    data sent in a packed pixel encoding is unpacked, unless
+    `unpack` is `False`, e.g., to unpack it later on the GPU.
+
+    """
+
+    def __init__(
+        self,
+        url,
+        shared_memory: bool = False,
+        metadata: bool = False,
+        drop_policy: typing.Optional[microscope.DropPolicy] = None,
+        unpack: bool = True,
+    ):
         super().__init__(url)
         self._buffer = queue.Queue()
+        self._shared_memory = shared_memory
+        self._metadata = metadata
+        self._drop_policy = drop_policy
+        self._unpack = unpack
+        self._shared_memory_reader = (
+            microscope._shared_memory.SharedMemoryReader()
+        )
         # Register self with a listener.
         if self._url.split("@")[1].split(":")[0] in ["127.0.0.1", "localhost"]:
             iface = "127.0.0.1"
@@ -89,7 +245,14 @@ class DataClient(Client):
 
     def enable(self):
         """Set the client on the remote and enable it."""
-        self.set_client(self._client_uri)
+        # Always ask for metadata since it may have a transform that
+        # we need to apply.
+        self.set_client(
+            self._client_uri,
+            shared_memory=self._shared_memory,
+            metadata=True,
+            drop_policy=self._drop_policy,
+        )
         self._proxy.enable()
 
     @Pyro4.expose
@@ -97,7 +260,54 @@ class DataClient(Client):
     # noinspection PyPep8Naming
     # Legacy naming convention.
     def receiveData(self, data, timestamp, *args):
-        del args
+        metadata = args[0] if args else None
+        if isinstance(data, microscope._shared_memory.SharedFrame):
+            data = self._resolve_shared_frame(data)
+            if data is None:
+                return
+        self._buffer_data(data, timestamp, metadata)
+
+    @Pyro4.expose
+    @Pyro4.oneway
+    # noinspection PyPep8Naming
+    # Legacy naming convention.
+    def receiveDataBatch(self, data, timestamps, *args):
+        """Receive multiple data, stacked on the first axis."""
+        metadata = args[0] if args else [None] * len(timestamps)
+        if isinstance(data, microscope._shared_memory.SharedFrame):
+            data = self._resolve_shared_frame(data)
+            if data is None:
+                return
+        for single_data, timestamp, single_metadata in zip(
+            data, timestamps, metadata
+        ):
+            self._buffer_data(single_data, timestamp, single_metadata)
+
+    def _resolve_shared_frame(self, frame):
+        """Copy data out of shared memory, `None` if it was overwritten."""
+        # The buffered data may only be read much later, by which
+        # time the device may have reused the slot, so keep a copy.
+        data = self._shared_memory_reader.resolve(frame, copy=True)
+        if data is None:
+            _logger.warning(
+                "dropped data overwritten in shared memory before it was read"
+            )
+        return data
+
+    def _buffer_data(self, data, timestamp, metadata) -> None:
+        if metadata is not None:
+            packed = metadata.pixel_encoding is not None
+            if packed and self._unpack:
+                data = microscope.abc.unpack_pixels(
+                    data, metadata.pixel_encoding
+                )
+                packed = False
+            # The transform of packed data is left to whoever unpacks
+            # it, it's in the metadata.
+            if metadata.transform is not None and not packed:
+                data = microscope.abc.transform_view(data, metadata.transform)
+            if self._metadata:
+                timestamp = metadata
         self._buffer.put((data, timestamp))
 
     def trigger_and_wait(self):
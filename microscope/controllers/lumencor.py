@@ -27,6 +27,11 @@ We only need access to other such devices.
 
    The engine is expected to be on the standard mode communications
    (not legacy).  This can be changed via the device web interface.
+
+Commands from multiple channels, e.g., changing the power of all
+channels at the same time, are sent without waiting for the reply to
+the previous command (see :class:`microscope._utils.SerialEngine`).
+The engine replies to commands in the order it receives them.
 """
 
 import typing
@@ -38,6 +43,29 @@ import microscope._utils
 import microscope.abc
 
 
+# Maximum number of commands sent before reading their replies.
+_MAX_IN_FLIGHT = 4
+
+
+def _is_answer_to(line: bytes, TX_tokens: typing.Sequence[bytes]) -> bool:
+    """Whether a line is the answer to the command with TX_tokens.
+
+    Answers echo the command name so that a late answer to a command
+    that timed out is not taken as the answer to the next command.
+    Errors may not echo it and are taken in order.
+    """
+    RX_tokens = line.split(maxsplit=2)
+    if not RX_tokens:
+        return False
+    if RX_tokens[0] == b"E":
+        return True
+    return (
+        RX_tokens[0] == b"A"
+        and len(RX_tokens) >= 2
+        and RX_tokens[1] == TX_tokens[1]
+    )
+
+
 class _SpectraIIIConnection:
     """Connection to a Spectra III Light Engine.
 
@@ -47,7 +75,7 @@ class _SpectraIIIConnection:
 
     """
 
-    def __init__(self, serial: microscope._utils.SharedSerial) -> None:
+    def __init__(self, serial: serial.Serial) -> None:
         self._serial = serial
         # If the Spectra has just been powered up the first command
         # will fail with UNKNOWNCMD.  So just send an empty command
@@ -64,6 +92,13 @@ class _SpectraIIIConnection:
             raise microscope.InitialiseError(
                 "Not a Lumencor Spectra III Light Engine"
             )
+        self._engine = microscope._utils.SerialEngine(
+            self._serial, max_in_flight=_MAX_IN_FLIGHT
+        )
+
+    def close(self) -> None:
+        self._engine.close()
+        self._serial.close()
 
     def command_and_answer(self, *TX_tokens: bytes) -> bytes:
         # Command contains two or more tokens.  The first token for a
@@ -77,9 +112,9 @@ class _SpectraIIIConnection:
         ), "invalid command (not SET/GET)"
 
         TX_command = b" ".join(TX_tokens) + b"\n"
-        with self._serial.lock:
-            self._serial.write(TX_command)
-            answer = self._serial.readline()
+        answer = self._engine.command(
+            TX_command, matcher=lambda line: _is_answer_to(line, TX_tokens)
+        )
         RX_tokens = answer.split(maxsplit=2)
         # A received answer has at least two tokens.  The first token
         # is A or E (for success or failure).  The second token is the
@@ -185,8 +220,8 @@ class SpectraIIILightEngine(microscope.abc.Controller):
             rtscts=False,
             dsrdtr=False,
         )
-        shared_serial = microscope._utils.SharedSerial(serial_conn)
-        connection = _SpectraIIIConnection(shared_serial)
+        connection = _SpectraIIIConnection(serial_conn)
+        self._connection = connection
 
         for index, name in connection.get_channel_map():
             assert (
@@ -198,6 +233,10 @@ class SpectraIIILightEngine(microscope.abc.Controller):
     def devices(self) -> typing.Mapping[str, microscope.abc.Device]:
         return self._lights
 
+    def _do_shutdown(self) -> None:
+        super()._do_shutdown()
+        self._connection.close()
+
 
 class _SpectraIIILightChannel(
     microscope._utils.OnlyTriggersBulbOnSoftwareMixin,
@@ -37,12 +37,17 @@ protocol.
 
     Consider using `__slots__` on the `_ZaberReply` for performance.
 
+Commands are sent with message IDs so that multiple commands, e.g.,
+moves of multiple axes or to multiple devices in the chain, are sent
+without waiting for the reply of each.
+
 """
 
+import concurrent.futures
 import enum
+import itertools
 import logging
 import threading
-import time
 import typing
 
 import serial
@@ -55,25 +60,43 @@ import microscope.abc
 _logger = logging.getLogger(__name__)
 
 _AT_CODE = ord(b"@")
-_SPACE_CODE = ord(b" ")
+
+# Maximum number of commands sent before reading their replies.
+# Zaber devices buffer the commands they receive.
+_MAX_IN_FLIGHT = 4
 
 
 class _ZaberReply:
-    """Wraps a Zaber reply to easily index its multiple fields. """
+    """Wraps a Zaber reply to easily index its multiple fields.
+
+    The reply may have a message ID, after the axis number, if the
+    command had one.
+    """
 
     def __init__(self, data: bytes) -> None:
         self._data = data
-        if (
-            data[0] != _AT_CODE
-            or data[-2:] != b"\r\n"
-            or any([data[i] != _SPACE_CODE for i in (3, 5, 8, 13, 16)])
-        ):
+        if len(data) < 3 or data[0] != _AT_CODE or data[-2:] != b"\r\n":
+            raise ValueError("Not a valid reply from a Zaber device")
+        fields = data[1:-2].split(b" ", 3)
+        if len(fields) == 4 and fields[2].isdigit():
+            self._message_id = fields[2]
+            fields = fields[:2] + fields[3].split(b" ", 3)
+        else:
+            self._message_id = b""
+            fields = fields[:2] + b" ".join(fields[2:]).split(b" ", 3)
+        if len(fields) < 5:
             raise ValueError("Not a valid reply from a Zaber device")
+        self._fields = fields + [b""] * (6 - len(fields))
 
     @property
     def address(self) -> bytes:
-        """The start of reply with device address and space."""
-        return self._data[1:3]
+        """The device address that sends the reply."""
+        return self._fields[0]
+
+    @property
+    def message_id(self) -> bytes:
+        """The message ID of the command, empty if it had none."""
+        return self._message_id
 
     @property
     def flag(self) -> bytes:
@@ -82,7 +105,7 @@ class _ZaberReply:
         Can be `b"OK"` (accepted) or `b"RJ"` (rejected).  If rejected,
         the response property will be one word with the reason why.
         """
-        return self._data[6:8]
+        return self._fields[2]
 
     @property
     def status(self) -> bytes:
@@ -92,7 +115,7 @@ class _ZaberReply:
         is `b"BUSY"` if any axis is busy and `b"IDLE"` if all axes are
         idle.
         """
-        return self._data[9:13]
+        return self._fields[3]
 
     @property
     def warning(self) -> bytes:
@@ -101,22 +124,22 @@ class _ZaberReply:
         This will be `b'--'` under normal conditions.  Anything else
         is a warning.
         """
-        return self._data[14:16]
+        return self._fields[4]
 
     @property
     def response(self) -> bytes:
         # Assumes no checksum
-        return self._data[17:-2]
+        return self._fields[5]
 
 
 class _ZaberConnection:
-    """Wraps a serial connection with a reentrant lock.
+    """Wraps a serial connection to send commands with message IDs.
 
     This class is just the wrap to :class:`serial.Serial`.  The class
     exposing the Zaber commands interface is
-    :class:`_ZaberDeviceConnection`.
-
-    .. todo: replace with microscope._utils.SharedSerial
+    :class:`_ZaberDeviceConnection`.  The serial I/O is done by a
+    :class:`microscope._utils.SerialEngine` and the replies are
+    matched to the commands by their message ID.
     """
 
     def __init__(self, port: str, baudrate: int, timeout: float) -> None:
@@ -131,29 +154,38 @@ class _ZaberConnection:
             rtscts=False,
             dsrdtr=False,
         )
-        self._lock = threading.RLock()
-        with self._lock:
-            # The command / does nothing other than getting a response
-            # from all devices in the chain.  This seems to be the
-            # most innocent command we can use.
-            self._serial.write(b"/\n")
-            lines = self._serial.readlines()
+        # The command / does nothing other than getting a response
+        # from all devices in the chain.  This seems to be the most
+        # innocent command we can use.
+        self._serial.write(b"/\n")
+        lines = self._serial.readlines()
         if not all([l.startswith(b"@") for l in lines]):
             raise RuntimeError(
                 "'%s' does not respond like a Zaber device" % port
             )
+        self._engine = microscope._utils.SerialEngine(
+            self._serial, max_in_flight=_MAX_IN_FLIGHT
+        )
+        # Message IDs are between 0 and 99.
+        self._message_ids = itertools.cycle(range(100))
+        self._message_ids_lock = threading.Lock()
+
+    def submit(
+        self, address: bytes, axis: int, command: bytes
+    ) -> concurrent.futures.Future:
+        """Send a command and return a future for the reply line."""
+        with self._message_ids_lock:
+            message_id = b"%d" % next(self._message_ids)
+        prefix = b"%s %1d %s" % (address, axis, message_id)
+        reply_start = b"@" + prefix + b" "
+        return self._engine.submit(
+            b"/%s %s\n" % (prefix, command),
+            matcher=lambda line: line.startswith(reply_start),
+        )
 
-    @property
-    def lock(self) -> threading.RLock:
-        return self._lock
-
-    def write(self, data: bytes) -> int:
-        with self.lock:
-            return self._serial.write(data)
-
-    def readline(self, size: int = -1) -> bytes:
-        with self.lock:
-            return self._serial.readline(size)
+    def close(self) -> None:
+        self._engine.close()
+        self._serial.close()
 
 
 class _ZaberDeviceConnection:
@@ -195,16 +227,27 @@ class _ZaberDeviceConnection:
             axis: the axis number to send the command.  If zero, the
                 command is executed by all axis in the device.
         """
+        return self.commands([(command, axis)])[0]
+
+    def commands(
+        self, commands: typing.Sequence[typing.Tuple[bytes, int]]
+    ) -> typing.List[_ZaberReply]:
+        """Send multiple commands, without waiting, and return replies.
+
+        Args:
+            commands: sequence of commands and the axis number to
+                send them, as the arguments to :meth:`command`.
+        """
         # We do not need to check whether axis number is valid because
         # the device will reject the command with BADAXIS if so.
-        with self._conn.lock:
-            self._conn.write(
-                b"/%s %1d %s\n" % (self._address_bytes, axis, command)
-            )
-            data = self._conn.readline()
-        reply = _ZaberReply(data)
-        self._validate_reply(reply)
-        return reply
+        futures = [
+            self._conn.submit(self._address_bytes, axis, command)
+            for command, axis in commands
+        ]
+        replies = [_ZaberReply(future.result()) for future in futures]
+        for reply in replies:
+            self._validate_reply(reply)
+        return replies
 
     def is_busy(self) -> bool:
         return self.command(b"").status == b"BUSY"
@@ -214,12 +257,9 @@ class _ZaberDeviceConnection:
 
         A device is busy if *any* of its axis is busy.
         """
-        sleep_interval = 0.1
-        for _ in range(int(timeout / sleep_interval)):
-            if not self.is_busy():
-                break
-            time.sleep(sleep_interval)
-        else:
+        if not microscope._utils.poll_until(
+            lambda: not self.is_busy(), timeout, max_interval=0.1
+        ):
             raise microscope.DeviceError(
                 "device still busy after %f seconds" % timeout
             )
@@ -302,10 +342,12 @@ class _ZaberStageAxis(microscope.abc.StageAxis):
         self._dev_conn = dev_conn
         self._axis = axis
 
+    @microscope.abc.ordered_move
     def move_by(self, delta: float) -> None:
         self._dev_conn.move_by_relative_position(self._axis, int(delta))
         self._dev_conn.wait_until_idle()
 
+    @microscope.abc.ordered_move
     def move_to(self, pos: float) -> None:
         self._dev_conn.move_to_absolute_position(self._axis, int(pos))
         self._dev_conn.wait_until_idle()
@@ -350,20 +392,26 @@ class _ZaberStage(microscope.abc.Stage):
     def axes(self) -> typing.Mapping[str, microscope.abc.StageAxis]:
         return self._axes
 
+    @microscope.abc.ordered_move
     def move_by(self, delta: typing.Mapping[str, float]) -> None:
         """Move specified axes by the specified distance. """
-        for axis_name, axis_delta in delta.items():
-            self._dev_conn.move_by_relative_position(
-                int(axis_name), int(axis_delta),
-            )
+        self._dev_conn.commands(
+            [
+                (b"move rel %d" % int(axis_delta), int(axis_name))
+                for axis_name, axis_delta in delta.items()
+            ]
+        )
         self._dev_conn.wait_until_idle()
 
+    @microscope.abc.ordered_move
     def move_to(self, position: typing.Mapping[str, float]) -> None:
         """Move specified axes by the specified distance. """
-        for axis_name, axis_position in position.items():
-            self._dev_conn.move_to_absolute_position(
-                int(axis_name), int(axis_position),
-            )
+        self._dev_conn.commands(
+            [
+                (b"move abs %d" % int(axis_position), int(axis_name))
+                for axis_name, axis_position in position.items()
+            ]
+        )
         self._dev_conn.wait_until_idle()
 
 
@@ -595,3 +643,7 @@ class ZaberDaisyChain(microscope.abc.Controller):
     @property
     def devices(self) -> typing.Dict[str, microscope.abc.Device]:
         return self._devices
+
+    def _do_shutdown(self) -> None:
+        super()._do_shutdown()
+        self._conn.close()
@@ -35,22 +35,32 @@ where ``CONFIG-FILEPATH`` is the path for a python file that defines a
 """
 
 import argparse
+import functools
+import http.server
+import importlib
 import importlib.machinery
 import importlib.util
+import inspect
 import logging
 import multiprocessing
+import queue
 import signal
 import sys
+import threading
 import time
 import typing
 from collections.abc import Iterable
 from dataclasses import dataclass
 from logging import StreamHandler
 from logging.handlers import RotatingFileHandler
+from multiprocessing.connection import wait as wait_for_objects
 from threading import Thread
 
 import Pyro4
+import Pyro4.constants
 
+import microscope._metrics
+import microscope._serializer
 import microscope.abc
 from microscope.abc import FloatingDeviceMixin
 
@@ -66,8 +76,13 @@ if sys.platform == "darwin" and sys.version_info < (3, 8):
 
 
 # Pyro configuration. Use pickle because it can serialize numpy ndarrays.
+# Also accept the pickle5 serializer, which clients may use, and which
+# the device server may use too (see DeviceServerOptions).
 Pyro4.config.SERIALIZERS_ACCEPTED.add("pickle")
 Pyro4.config.SERIALIZER = "pickle"
+microscope._serializer.register()
+if microscope._serializer.is_available():
+    Pyro4.config.SERIALIZERS_ACCEPTED.add(microscope._serializer.NAME)
 
 # We effectively expose all attributes of the classes since our
 # devices don't hold any private data.  The private methods are to
@@ -78,11 +93,13 @@ Pyro4.config.REQUIRE_EXPOSE = False
 
 
 def device(
-    cls: typing.Callable,
+    cls: typing.Union[typing.Callable, str],
     host: str,
     port: int,
     conf: typing.Mapping[str, typing.Any] = None,
     uid: typing.Optional[str] = None,
+    depends_on: typing.Sequence[typing.Mapping[str, typing.Any]] = (),
+    obj_id: typing.Optional[str] = None,
 ):
     """Define devices and where to serve them.
 
@@ -92,14 +109,31 @@ def device(
         cls: :class:`Device` class of device to serve or function that
             returns a map of `Device` instances to wanted Pyro ID.
             The device class will be constructed, or the function will
-            be called, with the arguments in ``conf``.
+            be called, with the arguments in ``conf``.  It can also be
+            the full name of the class or function, e.g.,
+            ``"microscope.cameras.pvcam.PVCamera"``, so that its module
+            is only imported by the process that serves it.
         host: hostname or ip address serving the devices.
         port: port number used to serve the devices.
         conf: keyword arguments for ``cls``.  The device or function
             are effectively constructed or called with `cls(**conf)`.
         uid: used to identify "floating" devices (see documentation
             for :class:`FloatingDeviceMixin`).  This must be specified
-            if ``cls`` is a floating device.
+            if ``cls`` is a floating device.  If ``cls`` is a name,
+            the device is taken to be floating only if ``uid`` is
+            given.
+        depends_on: definitions of other devices that must be served
+            before this one is constructed, e.g., because it connects
+            to them.  Devices that do not depend on each other are
+            constructed at the same time.
+        obj_id: Pyro ID of the device.  Defaults to the name of
+            ``cls``.  Only for device classes, functions already
+            return the Pyro ID of each device.
+
+    Devices are served each on their own process, unless multiple
+    definitions have the same host and port.  In that case, they are
+    served by the same process, with a single Pyro daemon.  They then
+    need different Pyro IDs.
 
     Example
 
@@ -115,20 +149,148 @@ def device(
             device(construct_devices, '127.0.0.1', 8000),
             # passing a Device class
             device(Camera, '127.0.0.1', 8001,
-                   conf={'kwarg1': some, 'kwarg2': arguments})
+                   conf={'kwarg1': some, 'kwarg2': arguments}),
+            # passing the name of a Device class, its module and
+            # the vendor library are not loaded by the main process
+            device('microscope.cameras.pvcam.PVCamera', '127.0.0.1', 8002,
+                   uid='A19F4532'),
         ]
 
     """
     if conf is None:
         conf = {}
-    if not callable(cls):
-        raise TypeError("cls must be a callable")
+    if isinstance(cls, str):
+        # Its module is only imported when the device is constructed
+        # so we can't check whether it's a floating device.
+        if "." not in cls:
+            raise ValueError("cls name '%s' has no module name" % cls)
+    elif not callable(cls):
+        raise TypeError("cls must be a callable or the name of one")
     elif isinstance(cls, type):
         if issubclass(cls, FloatingDeviceMixin) and uid is None:
             raise TypeError("uid must be specified for floating devices")
         elif not issubclass(cls, FloatingDeviceMixin) and uid is not None:
             raise TypeError("uid must not be given for non floating devices")
-    return dict(cls=cls, host=host, port=int(port), uid=uid, conf=conf)
+    elif obj_id is not None:
+        raise TypeError("obj_id must not be given for functions")
+    return dict(
+        cls=cls,
+        host=host,
+        port=int(port),
+        uid=uid,
+        conf=conf,
+        depends_on=[(d["host"], d["port"]) for d in depends_on],
+        obj_id=obj_id,
+    )
+
+
+def _resolve_cls(
+    cls: typing.Union[typing.Callable, str]
+) -> typing.Callable:
+    """Import the class or function of a device definition.
+
+    Does nothing if the definition already has the class or function
+    instead of its name.
+    """
+    if not isinstance(cls, str):
+        return cls
+    module_name, _, name = cls.rpartition(".")
+    module = importlib.import_module(module_name)
+    try:
+        return getattr(module, name)
+    except AttributeError:
+        raise ImportError(
+            "module '%s' has no '%s'" % (module_name, name)
+        ) from None
+
+
+def _definition_name(definition) -> str:
+    """Name of the class or function of a device definition."""
+    cls = definition["cls"]
+    if isinstance(cls, str):
+        return cls.rpartition(".")[2]
+    return cls.__name__
+
+
+def _is_floating_definition(definition) -> bool:
+    """Whether a device definition is for a floating device."""
+    cls = definition["cls"]
+    if isinstance(cls, str):
+        return definition.get("uid") is not None
+    return isinstance(cls, type) and issubclass(cls, FloatingDeviceMixin)
+
+
+def _construct_device_group(
+    definitions: typing.Sequence[typing.Mapping[str, typing.Any]]
+) -> typing.Dict[str, microscope.abc.Device]:
+    """Construct the devices of multiple definitions for one process.
+
+    If a device fails to be constructed, the devices already
+    constructed are shut down.
+    """
+    devices: typing.Dict[str, microscope.abc.Device] = {}
+    try:
+        for definition in definitions:
+            cls = _resolve_cls(definition["cls"])
+            if isinstance(cls, type):
+                obj_id = definition.get("obj_id") or cls.__name__
+                new_devices = {obj_id: cls(**definition["conf"])}
+            else:
+                new_devices = cls(**definition["conf"])
+            duplicated = devices.keys() & new_devices.keys()
+            devices.update(new_devices)
+            if duplicated:
+                raise ValueError(
+                    "multiple devices with Pyro ID %s"
+                    % ", ".join(sorted(duplicated))
+                )
+    except Exception:
+        for device in devices.values():
+            try:
+                device.shutdown()
+            except Exception as ex:
+                _logger.error(
+                    "Failure to shutdown device %s", device, exc_info=ex
+                )
+        raise
+    return devices
+
+
+def _group_definitions(devices) -> typing.List[typing.Dict[str, typing.Any]]:
+    """Merge device definitions with the same host and port.
+
+    Definitions with the same address are replaced with a single
+    definition constructed by :func:`_construct_device_group`.
+    """
+    by_address: typing.Dict[typing.Tuple[str, int], typing.List] = {}
+    for dev in devices:
+        by_address.setdefault((dev["host"], dev["port"]), []).append(dev)
+    grouped = []
+    for address, devs in by_address.items():
+        if len(devs) == 1:
+            grouped.append(devs[0])
+            continue
+        if any(dev.get("uid") is not None for dev in devs):
+            raise ValueError(
+                "floating devices can't share the address %s:%d" % address
+            )
+        depends_on = []
+        for dev in devs:
+            for dependency in dev.get("depends_on", []):
+                if dependency != address and dependency not in depends_on:
+                    depends_on.append(dependency)
+        grouped.append(
+            dict(
+                cls=_construct_device_group,
+                host=address[0],
+                port=address[1],
+                uid=None,
+                conf={"definitions": devs},
+                depends_on=depends_on,
+                obj_id=None,
+            )
+        )
+    return grouped
 
 
 def _create_log_formatter(name: str):
@@ -187,6 +349,19 @@ class Filter(logging.Filter):
             return False
 
 
+# Methods that, by default, never wait behind other calls to a
+# device when the calls are limited with `max_concurrent_calls`.
+_PRIORITY_METHODS = (
+    "describe_setting",
+    "describe_settings",
+    "get_all_settings",
+    "get_id",
+    "get_is_enabled",
+    "get_metrics",
+    "get_setting",
+)
+
+
 @dataclass(frozen=True)
 class DeviceServerOptions:
     """Class to define configuration for a device server.
@@ -194,10 +369,45 @@ class DeviceServerOptions:
     The different fields map to the different ``device-server``
     command line options.
 
+    The `serializer` is the Pyro serializer used by the device server
+    for the calls it makes, namely to send data to clients.  Use
+    "pickle5" (see :mod:`microscope._serializer`) to send data
+    without copies into the pickle stream and, optionally, compressed
+    with `compression`.
+
+    The `server_type` is the Pyro server type of each device server.
+    With the "thread" server type, each client connection is handled
+    by its own thread from a pool of at most `threadpool_size`
+    threads, so that a slow call, such as a stage move, does not
+    delay calls from other connections, such as a query of the
+    position.  Connections over that limit are refused.  The
+    "multiplex" server type handles all calls, from all connections,
+    one at a time in a single thread.
+
+    If `max_concurrent_calls` is not `None`, each device runs at
+    most that many method calls at the same time, and the others
+    wait for their turn.  This stops slow calls, such as moves or
+    `enable`, from several clients from starving a device.  The
+    methods in `priority_methods`, fast queries such as
+    `get_is_enabled`, never wait behind other calls.  Attributes and
+    properties, such as a stage `position`, are not method calls and
+    never wait either.
+
+    If `check_config` is true, the configuration is checked (see
+    :func:`check_devices`) and no device is served.
+
     """
 
     config_fpath: str
     logging_level: int
+    metrics_port: typing.Optional[int] = None
+    serializer: str = "pickle"
+    compression: typing.Optional[str] = None
+    server_type: str = "thread"
+    threadpool_size: typing.Optional[int] = None
+    max_concurrent_calls: typing.Optional[int] = None
+    priority_methods: typing.Tuple[str, ...] = _PRIORITY_METHODS
+    check_config: bool = False
 
 
 def _check_autoproxy_feature() -> None:
@@ -223,22 +433,169 @@ def _check_autoproxy_feature() -> None:
     return None
 
 
-def _register_device(pyro_daemon, device, obj_id=None) -> None:
+class _CallGate:
+    """Limit the number of method calls to a device at the same time.
+
+    A thread that is already in a call, e.g., a device method that
+    calls another of its methods, is not limited again.
+    """
+
+    def __init__(self, limit: int) -> None:
+        if limit < 1:
+            raise ValueError("maximum concurrent calls must be positive")
+        self._semaphore = threading.BoundedSemaphore(limit)
+        self._local = threading.local()
+
+    def wrap(self, method: typing.Callable) -> typing.Callable:
+        @functools.wraps(method)
+        def gated(*args, **kwargs):
+            depth = getattr(self._local, "depth", 0)
+            if depth == 0:
+                self._semaphore.acquire()
+            self._local.depth = depth + 1
+            try:
+                return method(*args, **kwargs)
+            finally:
+                self._local.depth = depth
+                if depth == 0:
+                    self._semaphore.release()
+
+        return gated
+
+
+def _limit_concurrent_calls(
+    device, limit: int, priority_methods: typing.Iterable[str] = ()
+) -> None:
+    """Wrap the public methods of a device with a :class:`_CallGate`.
+
+    The wrappers are set on the device instance, which is where the
+    Pyro daemon gets the methods from.  Methods in
+    `priority_methods` are not wrapped.
+    """
+    gate = _CallGate(limit)
+    for name, member in inspect.getmembers(type(device)):
+        if (
+            name.startswith("_")
+            or name in priority_methods
+            or not inspect.isroutine(member)
+        ):
+            continue
+        setattr(device, name, gate.wrap(getattr(device, name)))
+
+
+def _register_device(
+    pyro_daemon, device, obj_id=None, options=None
+) -> None:
+    if options is not None and options.max_concurrent_calls is not None:
+        _limit_concurrent_calls(
+            device, options.max_concurrent_calls, options.priority_methods
+        )
     pyro_daemon.register(device, obj_id)
 
     if isinstance(device, microscope.abc.Controller):
         _check_autoproxy_feature()
         for sub_device in device.devices.values():
-            _register_device(pyro_daemon, sub_device, obj_id=None)
+            _register_device(pyro_daemon, sub_device, options=options)
 
     if isinstance(device, microscope.abc.Stage):
         _check_autoproxy_feature()
         for axis in device.axes.values():
-            _register_device(pyro_daemon, axis, obj_id=None)
+            _register_device(pyro_daemon, axis, options=options)
 
     return None
 
 
+def _devices_by_key(
+    devices: typing.Mapping[str, microscope.abc.Device]
+) -> typing.Iterator[typing.Tuple[str, microscope.abc.Device]]:
+    """Devices, including those of controllers, by a key unique in the server.
+
+    The key of a device controlled by a controller is the Pyro ID of the
+    controller and the name of the device, separated by a dot.
+    """
+    for obj_id, device in devices.items():
+        yield obj_id, device
+        if isinstance(device, microscope.abc.Controller):
+            for name, sub_device in device.devices.items():
+                yield "%s.%s" % (obj_id, name), sub_device
+
+
+# Settings that are not restored on a warm restart.  Restoring these
+# would start writing to a file that the previous process had open.
+_NOT_RESTORED_SETTINGS = ("recording", "recording path")
+
+
+def _restore_settings(
+    device: microscope.abc.Device, values: typing.Mapping[str, typing.Any]
+) -> None:
+    # Each setting is restored on its own so that one that fails,
+    # e.g., because its allowed values changed, does not stop the
+    # others.  Readonly settings are skipped by update_settings.
+    # Values that failed to be read are None and are not restored.
+    for name, value in values.items():
+        if value is None or name in _NOT_RESTORED_SETTINGS:
+            continue
+        try:
+            device.update_settings({name: value})
+        except Exception as ex:
+            _logger.warning(
+                "Failed to restore setting '%s' of %s",
+                name,
+                device,
+                exc_info=ex,
+            )
+
+
+class _SettingsReporter:
+    """Settings listener that reports changes to the parent process.
+
+    Changes are put in the queue with the address of the device
+    server and the key of the device (see :func:`_devices_by_key`).
+    """
+
+    def __init__(self, settings_queue, address, key: str) -> None:
+        self._queue = settings_queue
+        self._address = address
+        self._key = key
+
+    def settings_changed(self, changes) -> None:
+        self._queue.put((self._address, self._key, changes))
+
+
+def _configure_server(options: DeviceServerOptions) -> None:
+    if options.server_type not in ("thread", "multiplex"):
+        raise ValueError("unknown server type '%s'" % options.server_type)
+    Pyro4.config.SERVERTYPE = options.server_type
+    if options.threadpool_size is not None:
+        if options.threadpool_size < 1:
+            raise ValueError("threadpool size must be positive")
+        Pyro4.config.THREADPOOL_SIZE = options.threadpool_size
+        Pyro4.config.THREADPOOL_SIZE_MIN = min(
+            Pyro4.config.THREADPOOL_SIZE_MIN, options.threadpool_size
+        )
+    if options.server_type == "multiplex":
+        _logger.info("All calls to the devices are handled one at a time")
+    if options.max_concurrent_calls is not None:
+        if options.max_concurrent_calls < 1:
+            raise ValueError("maximum concurrent calls must be positive")
+        _logger.info(
+            "At most %d calls to each device at the same time",
+            options.max_concurrent_calls,
+        )
+
+
+def _configure_serializer(options: DeviceServerOptions) -> None:
+    if options.serializer == microscope._serializer.NAME:
+        if not microscope._serializer.is_available():
+            raise microscope.UnsupportedFeatureError(
+                "the pickle5 serializer requires Python 3.8 or later"
+            )
+        microscope._serializer.configure(compression=options.compression)
+    elif options.compression is not None:
+        raise ValueError("compression requires the pickle5 serializer")
+    Pyro4.config.SERIALIZER = options.serializer
+
+
 class DeviceServer(multiprocessing.Process):
     """Initialise a device and serve at host/port according to its id.
 
@@ -250,6 +607,15 @@ class DeviceServer(multiprocessing.Process):
             number.
         exit_event: a shared event to signal that the process should
             quit.
+        settings_queue: if not `None`, the values of the settings of
+            the devices, and later their changes, are put in this
+            queue.  :func:`serve_devices` uses it to restore them if
+            the device server needs to be restarted.
+        settings: map of device keys to the values of the settings
+            to set after constructing the devices, for a warm
+            restart.
+
+    The `ready` event is set once the devices are being served.
 
     """
 
@@ -260,6 +626,10 @@ class DeviceServer(multiprocessing.Process):
         id_to_host: typing.Mapping[str, str],
         id_to_port: typing.Mapping[str, int],
         exit_event: typing.Optional[multiprocessing.Event] = None,
+        settings_queue: typing.Optional[multiprocessing.Queue] = None,
+        settings: typing.Optional[
+            typing.Mapping[str, typing.Mapping[str, typing.Any]]
+        ] = None,
     ):
         # The device to serve.
         self._device_def = device_def
@@ -270,14 +640,32 @@ class DeviceServer(multiprocessing.Process):
         self._id_to_port = id_to_port
         # A shared event to allow clean shutdown.
         self.exit_event = exit_event
+        self._settings_queue = settings_queue
+        self._settings = {} if settings is None else settings
         super().__init__()
         self.daemon = True
+        self.ready = multiprocessing.Event()
+
+    @property
+    def address(self) -> typing.Tuple[str, int]:
+        """Host and port of the device definition."""
+        return (self._device_def["host"], self._device_def["port"])
+
+    @property
+    def dependencies(self) -> typing.List[typing.Tuple[str, int]]:
+        """Addresses of the device servers this one depends on."""
+        return list(self._device_def.get("depends_on", []))
 
-    def clone(self):
+    def clone(self, settings=None):
         """Create new instance with same settings.
 
         This is useful to restart a device server.
 
+        Args:
+            settings: values of the device settings to restore, as
+                in the constructor.  If `None`, the devices start
+                with their default settings values.
+
         """
         return DeviceServer(
             self._device_def,
@@ -285,11 +673,22 @@ class DeviceServer(multiprocessing.Process):
             self._id_to_host,
             self._id_to_port,
             exit_event=self.exit_event,
+            settings_queue=self._settings_queue,
+            settings=settings,
         )
 
     def run(self):
-        cls = self._device_def["cls"]
-        cls_name = cls.__name__
+        # If the definition only has the name of the class, this is
+        # the only process that imports its module.
+        cls = _resolve_cls(self._device_def["cls"])
+        if cls is _construct_device_group:
+            # Name the logs after the devices in the group.
+            cls_name = "+".join(
+                d.get("obj_id") or _definition_name(d)
+                for d in self._device_def["conf"]["definitions"]
+            )
+        else:
+            cls_name = cls.__name__
 
         # If the multiprocessing start method is fork, the child
         # process gets a copy of the root logger.  The copy is
@@ -316,16 +715,27 @@ class DeviceServer(multiprocessing.Process):
 
         root_logger.addFilter(Filter())
 
+        _configure_server(self._options)
+        _configure_serializer(self._options)
+
         # The cls argument can either be a Device subclass, or it can
         # be a function that returns a map of names to devices.
         cls_is_type = isinstance(cls, type)
 
-        if not cls_is_type:
+        if not cls_is_type and cls is not _construct_device_group:
             self._devices = cls(**self._device_def["conf"])
         else:
+            # A group shuts down its devices if one of them fails to
+            # be constructed so it can be retried like a single device.
             while not self.exit_event.is_set():
                 try:
-                    device = cls(**self._device_def["conf"])
+                    if cls_is_type:
+                        obj_id = self._device_def.get("obj_id") or cls_name
+                        self._devices = {
+                            obj_id: cls(**self._device_def["conf"])
+                        }
+                    else:
+                        self._devices = cls(**self._device_def["conf"])
                 except Exception as e:
                     _logger.info(
                         "Failed to start device. Retrying in 5s.", exc_info=e
@@ -333,7 +743,6 @@ class DeviceServer(multiprocessing.Process):
                     time.sleep(5)
                 else:
                     break
-            self._devices = {cls_name: device}
 
         if cls_is_type and issubclass(cls, FloatingDeviceMixin):
             uid = str(list(self._devices.values())[0].get_id())
@@ -355,9 +764,20 @@ class DeviceServer(multiprocessing.Process):
         log_handler.setFormatter(_create_log_formatter(cls_name))
         root_logger.addHandler(log_handler)
 
+        for key, device in _devices_by_key(self._devices):
+            if key in self._settings:
+                _logger.info("Restoring settings of %s", key)
+                _restore_settings(device, self._settings[key])
+            if self._settings_queue is not None:
+                device.add_settings_listener(
+                    _SettingsReporter(self._settings_queue, self.address, key)
+                )
+
         _logger.info("Device initialized; starting daemon.")
         for obj_id, device in self._devices.items():
-            _register_device(pyro_daemon, device, obj_id=obj_id)
+            _register_device(
+                pyro_daemon, device, obj_id=obj_id, options=self._options
+            )
 
         # Run the Pyro daemon in a separate thread so that we can do
         # clean shutdown under Windows.
@@ -370,6 +790,7 @@ class DeviceServer(multiprocessing.Process):
                 _logger.info(
                     "Device UID on port %s is %s", port, device.get_id()
                 )
+        self.ready.set()
 
         # Wait for termination event. We should just be able to call
         # wait() on the exit_event, but this causes issues with locks
@@ -380,6 +801,12 @@ class DeviceServer(multiprocessing.Process):
                 time.sleep(5)
             except (KeyboardInterrupt, IOError):
                 pass
+            if self._settings_queue is not None:
+                # Report the settings changed by other means than
+                # set_setting, e.g., set_exposure_time, which only
+                # invalidate the cache.
+                for key, device in _devices_by_key(self._devices):
+                    device._refresh_settings_cache()
         pyro_daemon.shutdown()
         pyro_thread.join()
         for device in self._devices.values():
@@ -391,6 +818,127 @@ class DeviceServer(multiprocessing.Process):
                 _logger.error("Failure to shutdown device %s", device, ex)
 
 
+# Timeout, in seconds, for the Pyro calls to collect metrics.  A
+# device server that takes longer than this is reported as down.
+_METRICS_TIMEOUT = 2.0
+
+
+def _collect_metrics(devices) -> str:
+    """Collect the metrics of all devices in Prometheus text format.
+
+    Each device is labelled with its Pyro object ID and address.
+    There is also a ``device_server_up`` metric for each address so
+    that it's possible to alert on device servers that do not answer.
+    """
+    metrics_by_device = {}
+    for host, port in sorted(set((d["host"], d["port"]) for d in devices)):
+        address = "%s:%d" % (host, port)
+        up = 1
+        try:
+            with Pyro4.Proxy(
+                "PYRO:%s@%s" % (Pyro4.constants.DAEMON_NAME, address)
+            ) as daemon:
+                daemon._pyroTimeout = _METRICS_TIMEOUT
+                obj_ids = daemon.registered()
+            for obj_id in obj_ids:
+                if obj_id == Pyro4.constants.DAEMON_NAME:
+                    continue
+                with Pyro4.Proxy("PYRO:%s@%s" % (obj_id, address)) as proxy:
+                    proxy._pyroTimeout = _METRICS_TIMEOUT
+                    try:
+                        metrics = proxy.get_metrics()
+                    except AttributeError:
+                        # Not a Device, e.g., a StageAxis.
+                        continue
+                metrics_by_device["%s@%s" % (obj_id, address)] = metrics
+        except Exception as ex:
+            _logger.debug("failed to collect metrics from %s: %s", address, ex)
+            up = 0
+        metrics_by_device[address] = {
+            "device_server_up": microscope._metrics.MetricSnapshot(
+                "gauge", "Whether the device server answered.", (), {(): up}
+            )
+        }
+    return microscope._metrics.format_prometheus(metrics_by_device)
+
+
+class _MetricsRequestHandler(http.server.BaseHTTPRequestHandler):
+    def do_GET(self):
+        if self.path.split("?")[0] != "/metrics":
+            self.send_error(404)
+            return
+        body = _collect_metrics(self.server.devices).encode("utf-8")
+        self.send_response(200)
+        self.send_header("Content-Type", "text/plain; version=0.0.4")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def log_message(self, format, *args):
+        _logger.debug("metrics request: " + format, *args)
+
+
+def _start_metrics_server(devices, port: int) -> http.server.HTTPServer:
+    """Serve the metrics of all devices on ``/metrics``."""
+    server = http.server.ThreadingHTTPServer(
+        ("", port), _MetricsRequestHandler
+    )
+    server.devices = devices
+    server_thread = Thread(target=server.serve_forever)
+    server_thread.daemon = True
+    server_thread.start()
+    _logger.info("Serving metrics on port %d", port)
+    return server
+
+
+def _check_dependencies(devices) -> None:
+    """Raise `ValueError` if device definitions depend on each other."""
+    depends_on = {
+        (d["host"], d["port"]): d.get("depends_on", []) for d in devices
+    }
+    visiting = set()
+    done = set()
+
+    def visit(address) -> None:
+        if address in done or address not in depends_on:
+            return
+        if address in visiting:
+            raise ValueError(
+                "circular dependency on device server at %s:%d" % address
+            )
+        visiting.add(address)
+        for dependency in depends_on[address]:
+            visit(dependency)
+        visiting.remove(address)
+        done.add(address)
+
+    for address in depends_on:
+        visit(address)
+
+
+def _drain_settings(settings_queue, saved_settings) -> None:
+    """Update the saved settings with the changes reported so far."""
+    while True:
+        try:
+            address, key, changes = settings_queue.get_nowait()
+        except queue.Empty:
+            return
+        saved_settings.setdefault(address, {}).setdefault(key, {}).update(
+            changes
+        )
+
+
+# Maximum time, in seconds, between checks of the exit event, and
+# between checks for device servers that are ready to start.
+_KEEP_ALIVE_INTERVAL = 1.0
+_STARTUP_INTERVAL = 0.1
+
+# Minimum time, in seconds, between restarts of a device server, so
+# that one which fails on start is not restarted in a loop.  The
+# first restart is immediate.
+_MIN_RESTART_INTERVAL = 5.0
+
+
 def serve_devices(devices, options: DeviceServerOptions, exit_event=None):
     root_logger = logging.getLogger()
 
@@ -404,9 +952,19 @@ def serve_devices(devices, options: DeviceServerOptions, exit_event=None):
     if exit_event is None:
         exit_event = multiprocessing.Event()
 
+    devices = _group_definitions(devices)
+    _check_dependencies(devices)
+
     servers = (
         []
     )  # DeviceServers instances that we need to wait for when exiting
+    # DeviceServers waiting for their dependencies to be started.
+    pending = []
+
+    # The latest values of the settings of each device server, to
+    # restore them if it needs to be restarted.
+    settings_queue = multiprocessing.Queue()
+    saved_settings = {}
 
     # Child processes inherit signal handling from the parent so we
     # need to make sure that only the parent process sets the exit
@@ -450,7 +1008,7 @@ def serve_devices(devices, options: DeviceServerOptions, exit_event=None):
         # needed.
         uid_to_host = {}
         uid_to_port = {}
-        if isinstance(cls, type) and issubclass(cls, FloatingDeviceMixin):
+        if _is_floating_definition(devs[0]):
             # In addition to the maps of uid to host/port, floating
             # devices SDKs need the number of devices to index them.
             count = 0
@@ -463,35 +1021,97 @@ def serve_devices(devices, options: DeviceServerOptions, exit_event=None):
                 count += 1
 
         for dev in devs:
-            servers.append(
+            pending.append(
                 DeviceServer(
                     dev,
                     options,
                     uid_to_host,
                     uid_to_port,
                     exit_event=exit_event,
+                    settings_queue=settings_queue,
                 )
             )
-            servers[-1].start()
+
+    # The current DeviceServer of each address, for the dependencies.
+    by_address = {s.address: s for s in pending}
+    for s in pending:
+        for address in s.dependencies:
+            if address not in by_address:
+                _logger.warning(
+                    "DeviceServer at %s:%d depends on %s:%d which is not"
+                    " in the configuration.  Not waiting for it.",
+                    *(s.address + address),
+                )
+    start_time = time.monotonic()
+    n_servers = len(pending)
+    not_ready = set(by_address.keys())
+    # When each DeviceServer was last restarted, and when the dead
+    # ones are to be restarted.
+    restarted_at = {}
+    restart_at = {}
+
+    def dependencies_ready(server) -> bool:
+        return all(
+            by_address[address].ready.is_set()
+            for address in server.dependencies
+            if address in by_address
+        )
+
+    def report_ready() -> None:
+        for address in list(not_ready):
+            if by_address[address].ready.is_set():
+                not_ready.remove(address)
+                _logger.info(
+                    "DeviceServer at %s:%d ready after %.1f seconds"
+                    " (%d of %d).",
+                    *address,
+                    time.monotonic() - start_time,
+                    n_servers - len(not_ready),
+                    n_servers,
+                )
 
     # Main thread must be idle to process signals correctly, so use another
     # thread to check DeviceServers, restarting them where necessary. Define
     # the thread target here so that it can access variables in __main__ scope.
     def keep_alive():
-        """Keep DeviceServers alive."""
+        """Start DeviceServers, once their dependencies are ready.
+
+        Also keeps them alive, restarting them with the same
+        settings values if they die.
+        """
         while not exit_event.is_set():
-            for s in servers:
+            _drain_settings(settings_queue, saved_settings)
+            # Start all device servers whose dependencies are
+            # ready, so that they initialise at the same time.
+            for s in list(pending):
+                if dependencies_ready(s):
+                    pending.remove(s)
+                    servers.append(s)
+                    s.start()
+            for s in list(servers):
                 if s.is_alive():
                     continue
                 else:
-                    _logger.info(
-                        "DeviceServer Failure. Process %s is dead with"
-                        " exitcode %s. Restarting...",
-                        s.pid,
-                        s.exitcode,
-                    )
+                    if s.address not in restart_at:
+                        _logger.info(
+                            "DeviceServer Failure. Process %s is dead with"
+                            " exitcode %s. Restarting...",
+                            s.pid,
+                            s.exitcode,
+                        )
+                        restart_at[s.address] = (
+                            restarted_at.get(s.address, -float("inf"))
+                            + _MIN_RESTART_INTERVAL
+                        )
+                    if time.monotonic() < restart_at[s.address]:
+                        continue
+                    del restart_at[s.address]
                     servers.remove(s)
-                    servers.append(s.clone())
+                    # Restart with the last known settings values.
+                    _drain_settings(settings_queue, saved_settings)
+                    servers.append(s.clone(saved_settings.get(s.address)))
+                    by_address[s.address] = servers[-1]
+                    not_ready.add(s.address)
 
                     try:
                         s.join(30)
@@ -500,6 +1120,7 @@ def serve_devices(devices, options: DeviceServerOptions, exit_event=None):
                     else:
                         old_pid = s.pid
                         del s
+                        restarted_at[servers[-1].address] = time.monotonic()
                         servers[-1].start()
                         _logger.info(
                             "... DeviceServer with PID %s restarted"
@@ -507,20 +1128,35 @@ def serve_devices(devices, options: DeviceServerOptions, exit_event=None):
                             old_pid,
                             servers[-1].pid,
                         )
-            if not servers:
+            report_ready()
+            if not servers and not pending:
                 # Log and exit if no servers running. May want to change this
                 # if we add some interface to interactively restart servers.
                 _logger.info("No servers running. Exiting.")
                 exit_event.set()
             else:
+                # Wake up as soon as a DeviceServer dies, instead of
+                # sleeping, and more often while starting up.
+                if pending or not_ready or restart_at:
+                    timeout = _STARTUP_INTERVAL
+                else:
+                    timeout = _KEEP_ALIVE_INTERVAL
+                alive = [s.sentinel for s in servers if s.is_alive()]
                 try:
-                    time.sleep(5)
+                    if alive:
+                        wait_for_objects(alive, timeout=timeout)
+                    else:
+                        time.sleep(timeout)
                 except (KeyboardInterrupt, IOError):
                     pass
 
     keep_alive_thread = Thread(target=keep_alive)
     keep_alive_thread.start()
 
+    metrics_server = None
+    if options.metrics_port is not None:
+        metrics_server = _start_metrics_server(devices, options.metrics_port)
+
     _logger.info("Device Server started. Press Ctrl+C to exit.")
     while not exit_event.is_set():
         try:
@@ -529,6 +1165,9 @@ def serve_devices(devices, options: DeviceServerOptions, exit_event=None):
             _logger.debug("KeyboardInterrupt or IOError")
             exit_event.set()
 
+    if metrics_server is not None:
+        metrics_server.shutdown()
+
     _logger.debug("Shutting down servers ...")
     while servers:
         for s in servers:
@@ -553,6 +1192,69 @@ def _parse_cmd_line_args(args: typing.Sequence[str]) -> DeviceServerOptions:
         choices=["debug", "info", "warning", "error", "critical"],
         help="Set logging level",
     )
+    parser.add_argument(
+        "--metrics-port",
+        action="store",
+        type=int,
+        default=None,
+        help="Serve metrics of all devices, in Prometheus text format,"
+        " at /metrics on this port",
+    )
+    parser.add_argument(
+        "--serializer",
+        action="store",
+        type=str,
+        default="pickle",
+        choices=["pickle", microscope._serializer.NAME],
+        help="Pyro serializer to send data to clients",
+    )
+    parser.add_argument(
+        "--compression",
+        action="store",
+        type=str,
+        default=None,
+        choices=["lz4", "blosc"],
+        help="Compress data sent to clients (requires pickle5 serializer)",
+    )
+    parser.add_argument(
+        "--server-type",
+        action="store",
+        type=str,
+        default="thread",
+        choices=["thread", "multiplex"],
+        help="Pyro server type, whether to handle calls in a thread pool",
+    )
+    parser.add_argument(
+        "--threadpool-size",
+        action="store",
+        type=int,
+        default=None,
+        help="Maximum number of client connections handled at the same"
+        " time by each device server (thread server type only)",
+    )
+    parser.add_argument(
+        "--max-concurrent-calls",
+        action="store",
+        type=int,
+        default=None,
+        help="Maximum number of method calls to each device at the same"
+        " time, except for the priority methods",
+    )
+    parser.add_argument(
+        "--priority-method",
+        action="append",
+        type=str,
+        default=None,
+        help="Method that never waits behind other calls to a device."
+        "  Repeat for multiple methods.  Replaces the default methods: %s"
+        % ", ".join(_PRIORITY_METHODS),
+    )
+    parser.add_argument(
+        "--check-config",
+        action="store_true",
+        help="Check the device definitions, without loading the device"
+        " modules given by name, and exit",
+    )
     parser.add_argument(
         "config_fpath",
         action="store",
@@ -564,6 +1266,18 @@ def _parse_cmd_line_args(args: typing.Sequence[str]) -> DeviceServerOptions:
     return DeviceServerOptions(
         config_fpath=parsed.config_fpath,
         logging_level=getattr(logging, parsed.logging_level.upper()),
+        metrics_port=parsed.metrics_port,
+        serializer=parsed.serializer,
+        compression=parsed.compression,
+        server_type=parsed.server_type,
+        threadpool_size=parsed.threadpool_size,
+        max_concurrent_calls=parsed.max_concurrent_calls,
+        priority_methods=(
+            _PRIORITY_METHODS
+            if parsed.priority_method is None
+            else tuple(parsed.priority_method)
+        ),
+        check_config=parsed.check_config,
     )
 
 
@@ -586,6 +1300,48 @@ def validate_devices(configfile):
     return devices
 
 
+def check_devices(devices) -> None:
+    """Check device definitions without constructing the devices.
+
+    This checks the addresses, Pyro IDs, and dependencies of the
+    definitions.  For classes and functions given by name, it checks
+    that their module can be found without importing it, so neither
+    their module nor the vendor libraries are loaded.
+
+    Raises:
+        ValueError: if the definitions are not valid.
+        ImportError: if the module of a class or function given by
+            name can't be found.
+    """
+    for definition in devices:
+        cls = definition["cls"]
+        if isinstance(cls, str):
+            module_name = cls.rpartition(".")[0]
+            if importlib.util.find_spec(module_name) is None:
+                raise ImportError("no module named '%s'" % module_name)
+    grouped = _group_definitions(devices)
+    _check_dependencies(grouped)
+    for definition in grouped:
+        if definition["cls"] is not _construct_device_group:
+            continue
+        obj_ids = [
+            d.get("obj_id") or _definition_name(d)
+            for d in definition["conf"]["definitions"]
+            # Functions return their own Pyro IDs.
+            if isinstance(d["cls"], (str, type))
+        ]
+        duplicated = {i for i in obj_ids if obj_ids.count(i) > 1}
+        if duplicated:
+            raise ValueError(
+                "multiple devices with Pyro ID %s at %s:%d"
+                % (
+                    ", ".join(sorted(duplicated)),
+                    definition["host"],
+                    definition["port"],
+                )
+            )
+
+
 def main(argv: typing.Sequence[str]) -> int:
     options = _parse_cmd_line_args(argv[1:])
 
@@ -600,6 +1356,18 @@ def main(argv: typing.Sequence[str]) -> int:
 
     devices = validate_devices(options.config_fpath)
 
+    if options.check_config:
+        try:
+            check_devices(devices)
+        except (ImportError, ValueError) as e:
+            _logger.error("Invalid configuration: %s", e)
+            return 1
+        _logger.info(
+            "Configuration with %d device definitions is valid.",
+            len(devices),
+        )
+        return 0
+
     serve_devices(devices, options)
 
     return 0
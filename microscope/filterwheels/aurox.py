@@ -188,11 +188,14 @@ class Clarity(microscope.devices.FilterWheelBase):
 
     def set_slide_position(self, position, blocking=True):
         """Set the slide position"""
-        result = self._send_command(__SETSLIDE, position)
-        if result is None:
-            raise microscope.DeviceError("Slide position error.")
-        while blocking and self.moving():
-            pass
+        try:
+            result = self._send_command(__SETSLIDE, position)
+            if result is None:
+                raise microscope.DeviceError("Slide position error.")
+            while blocking and self.moving():
+                pass
+        finally:
+            self._invalidate_settings_cache()
         return result
 
     def get_slides(self):
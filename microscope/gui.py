@@ -41,6 +41,8 @@ import numpy
 import Pyro4
 from qtpy import QtCore, QtGui, QtWidgets
 
+import microscope._serializer
+import microscope._shared_memory
 import microscope.abc
 
 
@@ -51,6 +53,10 @@ _logger = logging.getLogger(__name__)
 # deformable mirrors patterns.
 Pyro4.config.SERIALIZERS_ACCEPTED.add("pickle")
 Pyro4.config.SERIALIZER = "pickle"
+# Devices may send data with the pickle5 serializer.
+microscope._serializer.register()
+if microscope._serializer.is_available():
+    Pyro4.config.SERIALIZERS_ACCEPTED.add(microscope._serializer.NAME)
 
 
 class DeviceSettingsWidget(QtWidgets.QWidget):
@@ -128,6 +134,14 @@ class ControllerWidget(QtWidgets.QWidget):
                 self._button2window[button] = None
 
 
+def _is_local_proxy(proxy: Pyro4.Proxy) -> bool:
+    """Whether the proxy's object is on this computer."""
+    if sys.version_info < (3, 8):
+        # No multiprocessing.shared_memory so pretend it's not local.
+        return False
+    return proxy._pyroUri.host in ("127.0.0.1", "localhost")
+
+
 class _DataQueue(queue.Queue):
     @Pyro4.expose
     def put(self, *args, **kwargs):
@@ -137,43 +151,63 @@ class _DataQueue(queue.Queue):
 class _Imager(QtCore.QObject):
     """Helper for CameraWidget handling the internals of the camera trigger."""
 
+    # There's no point in sending images faster than we can display.
+    _MAX_PREVIEW_RATE = 30.0
+
     imageAcquired = QtCore.Signal(numpy.ndarray)
 
     def __init__(self, camera: microscope.abc.Camera) -> None:
         super().__init__()
         self._camera = camera
         self._data_queue = _DataQueue()
+        self._shared_memory_reader = (
+            microscope._shared_memory.SharedMemoryReader()
+        )
         if isinstance(self._camera, Pyro4.Proxy):
             pyro_daemon = Pyro4.Daemon()
             queue_uri = pyro_daemon.register(self._data_queue)
-            self._camera.set_client(queue_uri)
+            self._client = queue_uri
+            # If the camera is on this computer, get the images via
+            # shared memory instead of over the socket.
+            self._camera.set_preview_client(
+                queue_uri,
+                shared_memory=_is_local_proxy(self._camera),
+                max_rate=self._MAX_PREVIEW_RATE,
+            )
             data_thread = threading.Thread(
                 target=pyro_daemon.requestLoop, daemon=True
             )
             data_thread.start()
         else:
-            self._device.set_client(self._data_queue)
+            self._client = self._data_queue
+            self._camera.set_preview_client(
+                self._data_queue, max_rate=self._MAX_PREVIEW_RATE
+            )
         fetch_thread = threading.Thread(target=self.fetchLoop, daemon=True)
         fetch_thread.start()
 
         # Depending on the Qt backend this might not get called (seems
         # to work on PySide2 but not with PyQt5).  The device itself
         # should be removing clients that no longer work anyway.
-        self.destroyed.connect(lambda: self._camera.set_client(None))
+        self.destroyed.connect(
+            lambda: self._camera.remove_client(self._client)
+        )
 
     def snap(self) -> None:
         self._camera.trigger()
 
     def fetchLoop(self) -> None:
         while True:
-            # We may be getting images faster than we can display so
-            # only get the last image in the queue and discard the
-            # rest (we could do with a class that only has one item
-            # and putting a new item will discard the previous instead
-            # of blocking/queue).
+            # The camera only sends us the newest image but we may
+            # still be slower to display so discard any older image.
             data = self._data_queue.get()
             while not self._data_queue.empty():
                 data = self._data_queue.get()
+            if isinstance(data, microscope._shared_memory.SharedFrame):
+                data = self._shared_memory_reader.resolve(data)
+                if data is None:
+                    # Overwritten already, wait for a newer image.
+                    continue
             self.imageAcquired.emit(data)
 
 
@@ -126,7 +126,15 @@ class AlpaoDeformableMirror(microscope.abc.DeformableMirror):
         return self._trigger_type
 
     def _do_apply_pattern(self, pattern: numpy.ndarray) -> None:
-        pattern = self._normalize_patterns(pattern)
+        self._do_apply_prepared_pattern(self._prepare_patterns(pattern)[0])
+
+    def _prepare_patterns(self, patterns: numpy.ndarray) -> numpy.ndarray:
+        return numpy.ascontiguousarray(
+            numpy.atleast_2d(self._normalize_patterns(patterns)),
+            dtype=numpy.float64,
+        )
+
+    def _do_apply_prepared_pattern(self, pattern: numpy.ndarray) -> None:
         data_pointer = pattern.ctypes.data_as(asdk.Scalar_p)
         status = asdk.Send(self._dm, data_pointer)
         self._raise_if_error(status)
@@ -164,8 +172,11 @@ class AlpaoDeformableMirror(microscope.abc.DeformableMirror):
             return
 
         self._validate_patterns(patterns)
-        patterns = self._normalize_patterns(patterns)
-        patterns = numpy.atleast_2d(patterns)
+        self._do_queue_prepared_patterns(self._prepare_patterns(patterns))
+
+    def _do_queue_prepared_patterns(self, patterns: numpy.ndarray) -> None:
+        if self._trigger_type == microscope.TriggerType.SOFTWARE:
+            raise NotImplementedError()
         n_patterns: int = patterns.shape[0]
 
         # The Alpao SDK seems to only support the trigger mode start.  It
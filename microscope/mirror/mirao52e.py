@@ -92,7 +92,15 @@ class Mirao52e(
         return patterns
 
     def _do_apply_pattern(self, pattern: numpy.ndarray) -> None:
-        pattern = self._normalize_patterns(pattern)
+        self._do_apply_prepared_pattern(self._prepare_patterns(pattern)[0])
+
+    def _prepare_patterns(self, patterns: numpy.ndarray) -> numpy.ndarray:
+        return numpy.ascontiguousarray(
+            numpy.atleast_2d(self._normalize_patterns(patterns)),
+            dtype=numpy.float64,
+        )
+
+    def _do_apply_prepared_pattern(self, pattern: numpy.ndarray) -> None:
         command = pattern.ctypes.data_as(mro.Command)
         if not mro.applyCommand(command, mro.FALSE, self._status):
             self._raise_status(mro.applyCommand)
@@ -25,8 +25,10 @@ hardware behaviour.  They implement the different ABC.
 
 """
 
+import collections
 import logging
 import random
+import threading
 import time
 import typing
 
@@ -100,15 +102,23 @@ class _ImageGenerator:
         d = self._datatypes[self._datatype_index]
         # return Image.fromarray(m(width, height, dark, light).astype(d), 'L')
         data = m(width, height, dark, light).astype(d)
-        if self.numbering and index is not None:
-            text = "%d" % index
-            size = tuple(d + 2 for d in self._font.getsize(text))
-            img = Image.new("L", size)
-            ctx = ImageDraw.Draw(img)
-            ctx.text((1, 1), text, fill=light)
-            data[0 : size[1], 0 : size[0]] = np.asarray(img)
+        if index is not None:
+            self.draw_number(data, index, light)
         return data
 
+    def draw_number(self, data, index, light=255):
+        """Draw the image number on the top left corner of data."""
+        if not self.numbering:
+            return
+        text = "%d" % index
+        size = tuple(d + 2 for d in self._font.getsize(text))
+        img = Image.new("L", size)
+        ctx = ImageDraw.Draw(img)
+        ctx.text((1, 1), text, fill=light)
+        data[0 : size[1], 0 : size[0]] = np.asarray(img)[
+            : data.shape[0], : data.shape[1]
+        ]
+
     def black(self, w, h, dark, light):
         """Ignores dark and light - returns zeros"""
         return np.zeros((h, w))
@@ -124,8 +134,8 @@ class _ImageGenerator:
 
     def gradient(self, w, h, dark, light):
         """A single gradient across the whole image from top left to bottom right."""
-        xx, yy = np.meshgrid(range(w), range(h))
-        return dark + light * (xx + yy) / (xx.max() + yy.max())
+        yy, xx = np.ogrid[0:h, 0:w]
+        return dark + light * (xx + yy) / max(w + h - 2, 1)
 
     def noise(self, w, h, dark, light):
         """Random noise."""
@@ -136,7 +146,7 @@ class _ImageGenerator:
         sigma = 0.01 * max(w, h)
         x0 = np.random.randint(w)
         y0 = np.random.randint(h)
-        xx, yy = np.meshgrid(range(w), range(h))
+        yy, xx = np.ogrid[0:h, 0:w]
         return dark + light * np.exp(
             -((xx - x0) ** 2 + (yy - y0) ** 2) / (2 * sigma ** 2)
         )
@@ -144,8 +154,8 @@ class _ImageGenerator:
     def sawtooth(self, w, h, dark, light):
         """A sawtooth gradient that rotates about 0,0."""
         th = next(self._theta)
-        xx, yy = np.meshgrid(range(w), range(h))
-        wrap = 0.1 * max(xx.max(), yy.max())
+        yy, xx = np.ogrid[0:h, 0:w]
+        wrap = 0.1 * max(w - 1, h - 1)
         return dark + light * ((np.sin(th) * xx + np.cos(th) * yy) % wrap) / (
             wrap
         )
@@ -154,6 +164,31 @@ class _ImageGenerator:
 class SimulatedCamera(
     microscope._utils.OnlyTriggersOnceOnSoftwareMixin, microscope.abc.Camera
 ):
+    """Simulated camera.
+
+    By default, images are generated for each software trigger which
+    is too slow for large images at high frame rates.  To load test
+    the rest of the pipeline, there is a performance mode configured
+    with the settings:
+
+    "frame rate"
+        if non zero, the camera runs free at this rate, from enable,
+        instead of waiting for triggers.  The frames are paced from
+        the time of enable, not the end of the previous frame.  A
+        frame that is not fetched before the next is due is lost, and
+        shows as a gap on the frame number.
+
+    "simulated drop percent"
+        percentage of the frames that are randomly lost.
+
+    "precomputed frames"
+        if non zero, this number of images is generated for the first
+        frame after a change of ROI, binning, or image settings, and
+        each frame is then a copy of one of them, into an array from
+        the frame pool, instead of a newly generated image.
+
+    """
+
     def __init__(self, **kwargs):
         super().__init__(**kwargs)
         # Binning and ROI
@@ -209,9 +244,62 @@ class SimulatedCamera(
         )
         self._acquiring = False
         self._exposure_time = 0.1
-        self._triggered = 0
+        # End time, as given by time.monotonic, of each exposure that
+        # has been triggered but not read yet.
+        self._exposures = collections.deque()
+        self._exposures_condition = threading.Condition()
         # Count number of images sent since last enable.
         self._sent = 0
+        # Number of the last frame acquired since enable, including
+        # the frames dropped.
+        self._frame_number = -1
+        # Start time and frame rate of the free running mode.  A zero
+        # frame rate means that frames are triggered.
+        self._clock_start = 0.0
+        self._frame_rate = 0.0
+        self._drop_percent = 0
+        self._add_performance_settings()
+        # Images returned in turns if "precomputed frames" is non
+        # zero, and the configuration they were generated with.
+        self._n_precomputed = 0
+        self._precomputed: typing.List[typing.Tuple[np.ndarray, int]] = []
+        self._precomputed_key: typing.Optional[tuple] = None
+        self.add_setting(
+            "precomputed frames",
+            "int",
+            lambda: self._n_precomputed,
+            self._set_precomputed_frames,
+            lambda: (0, 256),
+        )
+
+    def _add_performance_settings(self) -> None:
+        """Add the settings for free running and simulated drops."""
+        self.add_setting(
+            "frame rate",
+            "float",
+            lambda: self._frame_rate,
+            self._set_frame_rate,
+            lambda: (0.0, 10000.0),
+        )
+        self.add_setting(
+            "simulated drop percent",
+            "int",
+            lambda: self._drop_percent,
+            lambda value: setattr(self, "_drop_percent", value),
+            lambda: (0, 100),
+        )
+
+    def _set_frame_rate(self, value: float) -> None:
+        with self._exposures_condition:
+            self._frame_rate = value
+            self._exposures.clear()
+            self._reset_clock()
+            self._exposures_condition.notify_all()
+
+    def _set_precomputed_frames(self, value: int) -> None:
+        self._n_precomputed = value
+        self._precomputed = []
+        self._precomputed_key = None
 
     def _set_error_percent(self, value):
         self._error_percent = value
@@ -229,26 +317,115 @@ class SimulatedCamera(
         self._purge_buffers()
         _logger.info("Creating buffers.")
 
+    def _reset_clock(self) -> None:
+        self._clock_start = time.monotonic()
+        self._frame_number = -1
+
+    def _next_frame_end(self) -> typing.Optional[float]:
+        """End time of the next exposure, or None if not triggered."""
+        if self._frame_rate:
+            # Frame n is acquired from n/rate to (n+1)/rate.
+            return self._clock_start + (self._frame_number + 2) / (
+                self._frame_rate
+            )
+        elif self._exposures:
+            return self._exposures[0]
+        else:
+            return None
+
+    def _pop_finished_exposure(self) -> bool:
+        """Remove the oldest exposure if it has finished.
+
+        In free running mode, this is the last finished exposure and
+        the previous ones are lost.  The number of the frame is then
+        in `_frame_number`.
+        """
+        with self._exposures_condition:
+            now = time.monotonic()
+            end = self._next_frame_end()
+            if end is None or end > now:
+                return False
+            if self._frame_rate:
+                self._frame_number = (
+                    int((now - self._clock_start) * self._frame_rate) - 1
+                )
+            else:
+                self._exposures.popleft()
+                self._frame_number += 1
+            return True
+
+    def _drop_frame(self) -> bool:
+        """Whether to simulate the loss of the frame just acquired."""
+        return random.randint(0, 99) < self._drop_percent
+
+    def _wait_for_data(self, timeout: float) -> None:
+        end = time.monotonic() + timeout
+        with self._exposures_condition:
+            while True:
+                now = time.monotonic()
+                frame_end = self._next_frame_end()
+                if now >= end or (frame_end is not None and frame_end <= now):
+                    return
+                if frame_end is not None:
+                    wake_up = min(end, frame_end)
+                else:
+                    wake_up = end
+                # Also wakes up if triggered.
+                self._exposures_condition.wait(wake_up - now)
+
+    def _get_precomputed_image(self, width, height, index) -> np.ndarray:
+        """Copy of a precomputed image into an array from the pool."""
+        key = (
+            width,
+            height,
+            self._image_generator.method(),
+            self._image_generator.data_type(),
+        )
+        if self._precomputed_key != key:
+            _logger.info("Generating %d images.", self._n_precomputed)
+            self._precomputed = []
+            for i in range(self._n_precomputed):
+                light = int(255 - 128 * np.random.rand())
+                image = self._image_generator.get_image(
+                    width, height, int(32 * np.random.rand()), light
+                )
+                self._precomputed.append((image, light))
+            self._precomputed_key = key
+        source, light = self._precomputed[index % len(self._precomputed)]
+        image = self._frame_pool.get(source.shape, source.dtype)
+        np.copyto(image, source)
+        self._image_generator.draw_number(image, index, light)
+        return image
+
     def _fetch_data(self):
-        if self._acquiring and self._triggered > 0:
+        if self._acquiring and self._pop_finished_exposure():
+            if self._drop_frame():
+                _logger.debug("Dropping frame %d", self._frame_number)
+                return None
             if random.randint(0, 100) < self._error_percent:
                 _logger.info("Raising exception")
                 raise microscope.DeviceError(
                     "Exception raised in SimulatedCamera._fetch_data"
                 )
-            _logger.info("Sending image")
-            time.sleep(self._exposure_time)
-            self._triggered -= 1
-            # Create an image
-            dark = int(32 * np.random.rand())
-            light = int(255 - 128 * np.random.rand())
+            _logger.debug("Sending image")
             width = self._roi.width // self._binning.h
             height = self._roi.height // self._binning.v
-            image = self._image_generator.get_image(
-                width, height, dark, light, index=self._sent
+            if self._n_precomputed:
+                image = self._get_precomputed_image(
+                    width, height, self._frame_number
+                )
+            else:
+                # Create an image
+                dark = int(32 * np.random.rand())
+                light = int(255 - 128 * np.random.rand())
+                image = self._image_generator.get_image(
+                    width, height, dark, light, index=self._frame_number
+                )
+            metadata = microscope.FrameMetadata(
+                frame_number=self._frame_number
             )
             self._sent += 1
-            return image
+            return image, metadata
 
     def abort(self):
         _logger.info("Disabling acquisition; %d images sent.", self._sent)
@@ -263,13 +440,16 @@ class SimulatedCamera(
         if self._acquiring:
             self.abort()
         self._create_buffers()
-        self._acquiring = True
+        with self._exposures_condition:
+            self._reset_clock()
+            self._acquiring = True
         self._sent = 0
         _logger.info("Acquisition enabled.")
         return True
 
     def set_exposure_time(self, value):
         self._exposure_time = value
+        self._invalidate_settings_cache()
 
     def get_exposure_time(self):
         return self._exposure_time
@@ -289,7 +469,18 @@ class SimulatedCamera(
             "Trigger received; self._acquiring is %s.", self._acquiring
         )
         if self._acquiring:
-            self._triggered += 1
+            with self._exposures_condition:
+                if self._frame_rate:
+                    # Frames come from the clock in free running mode,
+                    # the exposure would never be read.
+                    _logger.debug("Trigger ignored while free running.")
+                    return
+                # Exposures happen one after the other.
+                start = time.monotonic()
+                if self._exposures:
+                    start = max(start, self._exposures[-1])
+                self._exposures.append(start + self._exposure_time)
+                self._exposures_condition.notify_all()
 
     def _get_binning(self):
         return self._binning
@@ -344,6 +535,11 @@ class SimulatedLightSource(
         super().__init__(**kwargs)
         self._power = 0.0
         self._emission = False
+        # Power levels queued on the simulated device, like the
+        # sequence memory of light controllers.
+        self._power_sequence: typing.List[float] = []
+        self._power_sequence_idx = 0
+        self._power_sequence_repeat = False
 
     def get_status(self):
         return [str(x) for x in (self._emission, self._power, self._set_point)]
@@ -372,6 +568,27 @@ class SimulatedLightSource(
         else:
             return 0.0
 
+    def _do_queue_sequence(
+        self, sequence: typing.Sequence, repeat: bool
+    ) -> None:
+        self._power_sequence = [float(x) for x in sequence]
+        self._power_sequence_idx = 0
+        self._power_sequence_repeat = repeat
+
+    def _do_clear_sequence(self) -> None:
+        self._power_sequence = []
+        self._power_sequence_idx = 0
+
+    def _do_trigger(self) -> None:
+        if self._power_sequence_idx == len(self._power_sequence):
+            if not (self._power_sequence_repeat and self._power_sequence):
+                self._power_sequence = []
+                super()._do_trigger()
+                return
+            self._power_sequence_idx = 0
+        self.power = self._power_sequence[self._power_sequence_idx]
+        self._power_sequence_idx += 1
+
 
 class SimulatedDeformableMirror(
     microscope._utils.OnlyTriggersOnceOnSoftwareMixin,
@@ -417,9 +634,11 @@ class SimulatedStageAxis(microscope.abc.StageAxis):
     def limits(self) -> microscope.AxisLimits:
         return self._limits
 
+    @microscope.abc.ordered_move
     def move_by(self, delta: float) -> None:
         self.move_to(self._position + delta)
 
+    @microscope.abc.ordered_move
     def move_to(self, pos: float) -> None:
         if pos < self._limits.lower:
             self._position = self._limits.lower
@@ -466,11 +685,3 @@ class SimulatedStage(microscope.abc.Stage):
     @property
     def axes(self) -> typing.Mapping[str, microscope.abc.StageAxis]:
         return self._axes
-
-    def move_by(self, delta: typing.Mapping[str, float]) -> None:
-        for name, rpos in delta.items():
-            self.axes[name].move_by(rpos)
-
-    def move_to(self, position: typing.Mapping[str, float]) -> None:
-        for name, pos in position.items():
-            self.axes[name].move_to(pos)
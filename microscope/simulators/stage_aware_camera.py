@@ -21,8 +21,8 @@
 """Simulation of a full setup based on a given image file.
 """
 
+import collections
 import logging
-import time
 import typing
 
 import numpy as np
@@ -49,20 +49,32 @@ class StageAwareCamera(SimulatedCamera):
     :func:`simulated_setup_from_image` function which will generate
     all the required simulated devices for a given image file.
 
+    The out of focus blur is computed on square tiles of the image,
+    for each channel and z position, which are then kept so that
+    images from a position already visited are only copied.  The blur
+    is rounded to `_BLUR_STEP` so that nearby z positions share the
+    same tiles.  Like :class:`SimulatedCamera`, this camera has the
+    "frame rate" and "simulated drop percent" settings.
+
     Args:
         image: the image from which regions will be cropped based on
             the stage and filter wheel positions.
         stage: stage to read coordinates from.  Must have an "x",
             "y", and "z" axis.
         filterwheel: filter wheel to read position.
+        max_cached_tiles: maximum number of blurred tiles to keep.
 
     """
 
+    _TILE_SIZE = 256
+    _BLUR_STEP = 0.1
+
     def __init__(
         self,
         image: np.ndarray,
         stage: microscope.abc.Stage,
         filterwheel: microscope.abc.FilterWheel,
+        max_cached_tiles: int = 1024,
         **kwargs,
     ) -> None:
         super().__init__(**kwargs)
@@ -70,6 +82,12 @@ class StageAwareCamera(SimulatedCamera):
         self._stage = stage
         self._filterwheel = filterwheel
         self._pixel_size = 1.0
+        # Blurred tiles, by channel, blur, and tile row and column, in
+        # order of last use.
+        self._tiles: typing.MutableMapping[
+            typing.Tuple[int, float, int, int], np.ndarray
+        ] = collections.OrderedDict()
+        self._max_cached_tiles = max_cached_tiles
 
         if not all([name in stage.axes.keys() for name in ["x", "y", "z"]]):
             raise microscope.InitialiseError(
@@ -94,13 +112,39 @@ class StageAwareCamera(SimulatedCamera):
             # technically should be: (nextafter(0.0, inf), nextafter(inf, 0.0))
             values=(0.0, float("inf")),
         )
-
-    def _fetch_data(self) -> typing.Optional[np.ndarray]:
-        if not self._acquiring or self._triggered == 0:
+        self._add_performance_settings()
+
+    def _get_tile(self, channel: int, blur: float, row: int, col: int):
+        """Return a tile of the image channel, blurred."""
+        key = (channel, blur, row, col)
+        try:
+            self._tiles.move_to_end(key)
+            return self._tiles[key]
+        except KeyError:
+            pass
+        size = self._TILE_SIZE
+        y0 = row * size
+        x0 = col * size
+        # Blur a larger region so that the tiles match the blur of
+        # the whole image.  This is the radius used by gaussian_filter.
+        margin = int(4.0 * blur + 0.5)
+        top = max(y0 - margin, 0)
+        left = max(x0 - margin, 0)
+        region = self._image[
+            top : y0 + size + margin, left : x0 + size + margin, channel
+        ]
+        if blur > 0.0:
+            region = scipy.ndimage.gaussian_filter(region, blur)
+        tile = region[y0 - top : y0 - top + size, x0 - left : x0 - left + size]
+        self._tiles[key] = tile
+        if len(self._tiles) > self._max_cached_tiles:
+            self._tiles.popitem(last=False)
+        return tile
+
+    def _fetch_data(self):
+        if not self._acquiring or not self._pop_finished_exposure():
             return None
 
-        time.sleep(self._exposure_time)
-        self._triggered -= 1
         _logger.info("Creating image")
 
         # Use stage position to compute bounding box.
@@ -112,18 +156,39 @@ class StageAwareCamera(SimulatedCamera):
         # Use filter wheel position to select the image channel.
         channel = self._filterwheel.position
 
-        subsection = self._image[y : y + height, x : x + width, channel]
+        if self._drop_frame():
+            return None
 
         # Gaussian filter on abs Z position to simulate being out of
         # focus (Z position zero is in focus).
         blur = abs((self._stage.position["z"]) / 10.0)
-        image = scipy.ndimage.gaussian_filter(subsection, blur)
-
-        self._sent += 1
+        blur = round(blur / self._BLUR_STEP) * self._BLUR_STEP
+
+        # The part of the bounding box inside the image.
+        y0, x0 = max(y, 0), max(x, 0)
+        y1 = min(y + height, self._image.shape[0])
+        x1 = min(x + width, self._image.shape[1])
+        image = self._frame_pool.get(
+            (max(y1 - y0, 0), max(x1 - x0, 0)), self._image.dtype
+        )
         # Not sure this flipping is correct but it's required to make
         # cockpit mosaic work.  This is probably related to not having
         # defined what the image origin should be (see issue #89).
-        return np.fliplr(np.flipud(image))
+        flipped = image[::-1, ::-1]
+
+        size = self._TILE_SIZE
+        for row in range(y0 // size, -(-y1 // size)):
+            top, bottom = max(y0, row * size), min(y1, (row + 1) * size)
+            for col in range(x0 // size, -(-x1 // size)):
+                left, right = max(x0, col * size), min(x1, (col + 1) * size)
+                tile = self._get_tile(channel, blur, row, col)
+                flipped[top - y0 : bottom - y0, left - x0 : right - x0] = tile[
+                    top - row * size : bottom - row * size,
+                    left - col * size : right - col * size,
+                ]
+
+        self._sent += 1
+        return image, microscope.FrameMetadata(frame_number=self._frame_number)
 
 
 def simulated_setup_from_image(
@@ -37,17 +37,24 @@ but should be readily extensible to support other Linkam stages.
 
 import ctypes
 import datetime
+import logging
 import os
 import os.path
 import threading
 import time
+import typing
 from ctypes import POINTER, byref
 from enum import Enum, IntEnum
 
+import Pyro4
+
 import microscope
 import microscope.abc
 
 
+_logger = logging.getLogger(__name__)
+
+
 _max_version_length = 20
 
 # Typedefs from C headers
@@ -1021,11 +1028,21 @@ class _LinkamBase(microscope.abc.FloatingDeviceMixin, microscope.abc.Device):
 
     @classmethod
     def _on_new_value(cls, h: _CommsHandle, status: _ControllerStatus):
-        """NewValue callback"""
-        stage = cls._connectionMap.get(h, None)
-        if not stage:
+        """NewValue callback
+
+        This runs on the SDK thread so it only keeps a copy of the
+        status and leaves the queries for the snapshot values to the
+        telemetry thread.  Exceptions must not reach the SDK.
+        """
+        try:
+            stage = cls._connectionMap.get(h, None)
+            if not stage:
+                return 0
+            stage._update_status(_ControllerStatus(value=status.value))
+            stage._telemetry_event.set()
+        except Exception as ex:
+            _logger.error("in NewValue callback", exc_info=ex)
             return 0
-        stage._update_status(status)
         return 1
 
     @classmethod
@@ -1067,6 +1084,8 @@ class _LinkamBase(microscope.abc.FloatingDeviceMixin, microscope.abc.Device):
         if not stage:
             return 0
         stage._connectionstatus.flags.connected = 0
+        # The values are no longer updated.
+        stage._values = {}
         return
 
     def __init__(self, **kwargs):
@@ -1079,15 +1098,32 @@ class _LinkamBase(microscope.abc.FloatingDeviceMixin, microscope.abc.Device):
         self._stageconfig = _StageConfig()
         # Stage status struct, updated by the NewValue callback.
         self._status = _ControllerStatus()
+        # Latest stage values, of the _snapshot_values, and telemetry,
+        # updated by the telemetry thread after each NewValue
+        # callback.  These are replaced and never modified so they
+        # can be read without a lock.
+        self._values: typing.Dict[_StageValueType, typing.Any] = {}
+        self._telemetry: typing.Dict[str, typing.Any] = {}
+        # Map of telemetry clients to their minimum interval between
+        # updates and the time of their last update.
+        self._telemetry_clients: typing.Dict[typing.Any, typing.List] = {}
+        self._telemetry_lock = threading.Lock()
+        self._telemetry_event = threading.Event()
+        self._telemetry_stop = False
         if __class__._lib is None:
             try:
                 self.init_sdk()
             except Exception as e:
                 raise microscope.LibraryLoadError(e) from e
         self._reconnect_thread = None
+        self._telemetry_thread = threading.Thread(
+            target=self._telemetry_loop, daemon=True
+        )
+        self._telemetry_thread.start()
 
     def _do_shutdown(self) -> None:
-        pass
+        self._telemetry_stop = True
+        self._telemetry_event.set()
 
     def __del__(self):
         """Close comms on object deletion"""
@@ -1132,6 +1168,10 @@ class _LinkamBase(microscope.abc.FloatingDeviceMixin, microscope.abc.Device):
     def get_value(self, svt, result=None):
         """Fetch a value from the device.
 
+        Values that are part of the status snapshot, such as the
+        temperatures and motor positions, are returned from the
+        snapshot updated on each status update, instead of queried.
+
         Args:
             svt: a StageValueType
             result: an existing Variant to use to return a result, or None.
@@ -1143,6 +1183,14 @@ class _LinkamBase(microscope.abc.FloatingDeviceMixin, microscope.abc.Device):
             svt = getattr(_StageValueType, svt)
         else:
             svt = _StageValueType(svt)
+        if result is None:
+            values = self._values
+            if svt in values:
+                return values[svt]
+        return self._query_value(svt, result)
+
+    def _query_value(self, svt: "_StageValueType", result=None):
+        """Fetch a value from the device, bypassing the status snapshot."""
         # Determine the appropriate Variant member for the value type.
         vtype = _StageValueTypeToVariant.get(svt, "vFloat32")
         variant = self._process_msg(Msg.GetValue, svt.value, result=result)
@@ -1172,6 +1220,8 @@ class _LinkamBase(microscope.abc.FloatingDeviceMixin, microscope.abc.Device):
         else:
             svt = _StageValueType(svt)
         vtype = _StageValueTypeToVariant.get(svt, "vFloat32")
+        # Read the new value from the device until the next update.
+        self._values = {k: v for k, v in self._values.items() if k != svt}
         return self._process_msg(
             Msg.SetValue, _StageValueType(svt).value, _Variant(**{vtype: val})
         ).vBoolean
@@ -1246,6 +1296,112 @@ class _LinkamBase(microscope.abc.FloatingDeviceMixin, microscope.abc.Device):
         """Update status structures."""
         self._status = status
 
+    def _snapshot_values(self) -> typing.List["_StageValueType"]:
+        """Stage values to keep in the snapshot.
+
+        Mixins should extend this with the values they read often.
+        """
+        return []
+
+    def _make_telemetry(self) -> typing.Dict[str, typing.Any]:
+        """Telemetry to send to the telemetry clients.
+
+        Mixins should extend this with their own values, read from the
+        snapshot and from the status structures.
+        """
+        return {
+            "time": datetime.datetime.now(),
+            "connected": bool(self._connectionstatus.flags.connected),
+        }
+
+    def _update_snapshot(self) -> None:
+        """Read the snapshot values and make the latest telemetry.
+
+        This runs on the telemetry thread after each status update, so
+        the link to the controller is queried at most once per update
+        for each value, independently of how often clients read them.
+        """
+        values = {}
+        for svt in self._snapshot_values():
+            try:
+                values[svt] = self._query_value(svt)
+            except microscope.DeviceError:
+                pass
+        self._values = values
+        self._telemetry = self._make_telemetry()
+
+    def get_telemetry(self) -> typing.Dict[str, typing.Any]:
+        """Return the latest telemetry, without querying the stage.
+
+        The telemetry is a dict with the time it was made, the
+        connection state, and, depending on the stage, the motor
+        positions, temperatures, and state of the refills.
+        """
+        return self._telemetry
+
+    def add_telemetry_client(self, client, interval: float = 1.0) -> None:
+        """Send the telemetry to a client as it is updated.
+
+        The client `telemetry_updated` method is called, from a
+        separate thread, with the same dict as :meth:`get_telemetry`.
+        Updates are decimated to at most one every `interval` seconds
+        so that a client can follow a long experiment without asking
+        for, and receiving, every status update.
+
+        Args:
+            client: an object with a `telemetry_updated` method, or
+                its Pyro URI.
+            interval: minimum time, in seconds, between updates.
+        """
+        if interval < 0:
+            raise ValueError("interval must not be negative")
+        if isinstance(client, (str, Pyro4.core.URI)):
+            client = Pyro4.Proxy(client)
+        with self._telemetry_lock:
+            self._telemetry_clients[client] = [interval, -float("inf")]
+
+    def remove_telemetry_client(self, client) -> None:
+        """Stop sending the telemetry to a client."""
+        if isinstance(client, (str, Pyro4.core.URI)):
+            client = Pyro4.Proxy(client)
+        with self._telemetry_lock:
+            if self._telemetry_clients.pop(client, None) is None:
+                raise ValueError("%s is not a telemetry client" % client)
+
+    def _telemetry_loop(self) -> None:
+        while not self._telemetry_stop:
+            self._telemetry_event.wait()
+            self._telemetry_event.clear()
+            if self._telemetry_stop:
+                break
+            try:
+                self._update_snapshot()
+            except Exception as ex:
+                _logger.error("failed to update snapshot", exc_info=ex)
+                continue
+            telemetry = self._telemetry
+            now = time.monotonic()
+            due = []
+            with self._telemetry_lock:
+                for client, times in self._telemetry_clients.items():
+                    if now - times[1] >= times[0]:
+                        times[1] = now
+                        due.append(client)
+            for client in due:
+                try:
+                    client.telemetry_updated(telemetry)
+                except (
+                    Pyro4.errors.ConnectionClosedError,
+                    Pyro4.errors.CommunicationError,
+                ):
+                    _logger.info("Removing disconnected telemetry client")
+                    with self._telemetry_lock:
+                        self._telemetry_clients.pop(client, None)
+                except Exception as ex:
+                    _logger.error(
+                        "failed to send telemetry to %s", client, exc_info=ex
+                    )
+
     def init_usb(self, uid):
         """Populate commsinfo struct with default USBCommsInfo"""
         # The uid is used to set serialNumber on the info object. The docs
@@ -1335,6 +1491,20 @@ class _LinkamMDSMixin:
             _StageValueType.MotorDrivenStageStatus, result=self._mdsstatus
         )
 
+    def _snapshot_values(self):
+        """Include the positions of the available motors."""
+        return super()._snapshot_values() + [
+            getattr(_StageValueType, "MotorPos" + axis)
+            for axis in "ZYX"
+            if getattr(self._stageconfig.flags, "motor" + axis)
+        ]
+
+    def _make_telemetry(self):
+        """Include the position and whether the stage is moving."""
+        telemetry = super()._make_telemetry()
+        telemetry.update(position=self.get_position(), moving=self.is_moving())
+        return telemetry
+
     def move_to(self, x=None, y=None, z=None):
         """Move to co-ordinates given by x and y"""
         # The default position set points are zero. If the motors are started without
@@ -1458,6 +1628,18 @@ class LinkamCMS(_LinkamMDSMixin, _LinkamBase):
             elif self._refills[key].refilling and not is_refilling:
                 tracker.end_refill()
 
+    def _snapshot_values(self):
+        """Include the temperatures."""
+        return super()._snapshot_values() + list(self._heater_map.values())
+
+    def _make_telemetry(self):
+        """Include the temperatures and the state of the refills."""
+        telemetry = super()._make_telemetry()
+        telemetry.update(
+            temperatures=self.temperatures(), refills=self.refill_stats()
+        )
+        return telemetry
+
     def temperatures(self):
         """Return a dict of temperature sensor readings."""
         return dict(
@@ -0,0 +1,630 @@
+#!/usr/bin/env python3
+
+## Copyright (C) 2020 David Miguel Susano Pinto <carandraug@gmail.com>
+##
+## This file is part of Microscope.
+##
+## Microscope is free software: you can redistribute it and/or modify
+## it under the terms of the GNU General Public License as published by
+## the Free Software Foundation, either version 3 of the License, or
+## (at your option) any later version.
+##
+## Microscope is distributed in the hope that it will be useful,
+## but WITHOUT ANY WARRANTY; without even the implied warranty of
+## MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+## GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License
+## along with Microscope.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Benchmark of data acquisition throughput and latency.
+
+A camera is served on its own device server process, exactly like
+the ``device-server`` program does, and its data is received with a
+:class:`microscope.clients.DataClient`.  For each combination of
+ROI, data type, transport, dispatch batch size, serializer, and
+buffer length, the camera is software triggered a number of times
+and the following is measured:
+
+* frames per second and MB per second received by the client;
+* latency percentiles, from the data timestamp on the device to its
+  arrival on the client;
+* frames lost before reaching the client, and frames dropped as
+  reported by the device;
+* CPU usage of the client and of the device server processes.
+
+By default, a :class:`microscope.simulators.SimulatedCamera` is
+benchmarked.  To benchmark a real camera, give the device server
+configuration file and the index of the camera in its ``DEVICES``.
+For example::
+
+    python -m microscope.testsuite.benchmark \\
+        --roi 512x512 2048x2048 --transport pyro shared-memory \\
+        --batch-size 1 8
+
+    python -m microscope.testsuite.benchmark \\
+        --config my-microscope.py --device-index 2 --frames 5000
+
+Latency is computed with the clock of the two computers so it is only
+meaningful if the device and the client are on the same computer.
+The CPU usage of the device server requires Linux or :mod:`psutil`.
+
+"""
+
+import argparse
+import itertools
+import json
+import logging
+import multiprocessing
+import os
+import sys
+import threading
+import time
+import typing
+
+import numpy
+import Pyro4
+import Pyro4.errors
+
+import microscope
+import microscope._serializer
+import microscope.clients
+import microscope.device_server
+import microscope.simulators
+
+
+_logger = logging.getLogger(__name__)
+
+
+TRANSPORTS = ("pyro", "shared-memory")
+
+_LATENCY_PERCENTILES = (50, 90, 99)
+
+
+class BenchmarkParameters(typing.NamedTuple):
+    roi: typing.Optional[microscope.ROI]
+    dtype: typing.Optional[str]
+    transport: str
+    batch_size: int
+    serializer: str
+    buffer_length: typing.Optional[int]
+
+
+class BenchmarkResult(typing.NamedTuple):
+    parameters: BenchmarkParameters
+    n_triggered: int
+    n_received: int
+    n_dropped: int
+    n_errors: int
+    duration: float
+    fps: float
+    mb_per_s: float
+    latency: typing.Dict[str, float]
+    client_cpu: float
+    server_cpu: typing.Optional[float]
+
+    @property
+    def n_lost(self) -> int:
+        """Number of frames triggered that never reached the client."""
+        return self.n_triggered - self.n_received
+
+    def as_dict(self) -> typing.Dict[str, typing.Any]:
+        parameters = self.parameters._asdict()
+        if self.parameters.roi is not None:
+            parameters["roi"] = list(self.parameters.roi)
+        result = self._asdict()
+        result["parameters"] = parameters
+        result["n_lost"] = self.n_lost
+        return result
+
+
+def _process_cpu_time(pid: int) -> typing.Optional[float]:
+    """Return the user and system CPU time, in seconds, of a process.
+
+    Returns `None` if it's not possible to get it on this system.
+    """
+    try:
+        import psutil
+    except ImportError:
+        pass
+    else:
+        cpu_times = psutil.Process(pid).cpu_times()
+        return cpu_times.user + cpu_times.system
+    try:
+        with open("/proc/%d/stat" % pid) as fh:
+            stat = fh.read()
+    except OSError:
+        return None
+    # The process name, second field, is between parentheses and may
+    # have spaces.  utime and stime are the 14th and 15th fields.
+    fields = stat[stat.rindex(")") + 2 :].split()
+    return (int(fields[11]) + int(fields[12])) / os.sysconf("SC_CLK_TCK")
+
+
+class _TimingDataClient(microscope.clients.DataClient):
+    """DataClient that records the arrival of data instead of buffering.
+
+    Only the arrival time, size, and metadata of data are kept.  Data
+    that is a view of shared memory is released immediately.
+    """
+
+    def __init__(self, *args, **kwargs) -> None:
+        super().__init__(*args, **kwargs)
+        self._arrivals_lock = threading.Lock()
+        self._arrivals_condition = threading.Condition(self._arrivals_lock)
+        self._arrivals: typing.List[typing.Tuple[float, int, typing.Any]] = []
+        self._n_errors = 0
+
+    def _buffer_data(self, data, timestamp, metadata) -> None:
+        now = time.time()
+        with self._arrivals_condition:
+            if isinstance(data, Exception):
+                self._n_errors += 1
+            else:
+                if metadata is None:
+                    metadata = microscope.FrameMetadata(timestamp)
+                self._arrivals.append((now, data.nbytes, metadata))
+            self._arrivals_condition.notify_all()
+
+    def reset_arrivals(self) -> None:
+        with self._arrivals_lock:
+            self._arrivals = []
+            self._n_errors = 0
+
+    def wait_for_arrivals(self, n: int, timeout: float) -> None:
+        """Wait for `n` arrivals or for `timeout` seconds without any."""
+        with self._arrivals_condition:
+            while len(self._arrivals) + self._n_errors < n:
+                n_before = len(self._arrivals) + self._n_errors
+                self._arrivals_condition.wait(timeout)
+                if len(self._arrivals) + self._n_errors == n_before:
+                    break
+
+    def get_arrivals(self):
+        with self._arrivals_lock:
+            return list(self._arrivals), self._n_errors
+
+
+def _serve_device(
+    device_def, serializer: str, exit_event
+) -> microscope.device_server.DeviceServer:
+    options = microscope.device_server.DeviceServerOptions(
+        config_fpath="", logging_level=logging.WARNING, serializer=serializer
+    )
+    id_to_host = {}
+    id_to_port = {}
+    if device_def["uid"] is not None:
+        id_to_host[device_def["uid"]] = device_def["host"]
+        id_to_port[device_def["uid"]] = device_def["port"]
+        device_def["conf"].setdefault("index", 0)
+    server = microscope.device_server.DeviceServer(
+        device_def, options, id_to_host, id_to_port, exit_event=exit_event
+    )
+    server.start()
+    return server
+
+
+def _wait_for_device(uri: str, server, timeout: float) -> None:
+    end = time.monotonic() + timeout
+    while True:
+        try:
+            with Pyro4.Proxy(uri) as proxy:
+                proxy._pyroBind()
+        except Pyro4.errors.CommunicationError:
+            if not server.is_alive():
+                raise RuntimeError("device server exited during startup")
+            if time.monotonic() > end:
+                raise
+            time.sleep(0.5)
+        else:
+            return
+
+
+def _configure_device(
+    proxy, parameters: BenchmarkParameters, simulated: bool
+) -> None:
+    proxy.disable()
+    if parameters.roi is not None:
+        if not proxy.set_roi(parameters.roi):
+            raise RuntimeError("failed to set ROI to %s" % (parameters.roi,))
+    if parameters.dtype is not None:
+        if "image data type" not in proxy.get_all_settings():
+            raise RuntimeError("device has no 'image data type' setting")
+        values = dict(
+            (name, index)
+            for index, name in proxy.describe_setting("image data type")[
+                "values"
+            ]
+        )
+        if parameters.dtype not in values:
+            raise RuntimeError(
+                "device does not support data type '%s' (only %s)"
+                % (parameters.dtype, ", ".join(values))
+            )
+        proxy.set_setting("image data type", values[parameters.dtype])
+    proxy.set_setting("dispatch batch size", parameters.batch_size)
+    if simulated:
+        # Keep the cost of generating images low so that we measure
+        # the transfer of data and not the simulator.
+        proxy.set_setting("display image number", False)
+        black = [
+            index
+            for index, name in proxy.describe_setting("image pattern")[
+                "values"
+            ]
+            if name == "black"
+        ]
+        proxy.set_setting("image pattern", black[0])
+
+
+def _run_one(
+    client: _TimingDataClient,
+    parameters: BenchmarkParameters,
+    server_pid: typing.Optional[int],
+    n_frames: int,
+    n_warmup: int,
+    timeout: float,
+) -> BenchmarkResult:
+    client.enable()
+    try:
+        # Warm up, to create shared memory rings, fill the frame
+        # pool, and the like.
+        for _ in range(n_warmup):
+            client.trigger()
+        client.wait_for_arrivals(n_warmup, timeout)
+        client.reset_arrivals()
+
+        server_cpu_start = (
+            None if server_pid is None else _process_cpu_time(server_pid)
+        )
+        client_cpu_start = time.process_time()
+        start = time.time()
+        for _ in range(n_frames):
+            client.trigger()
+        client.wait_for_arrivals(n_frames, timeout)
+        arrivals, n_errors = client.get_arrivals()
+        end = arrivals[-1][0] if arrivals else time.time()
+        client_cpu = time.process_time() - client_cpu_start
+        server_cpu_end = (
+            None if server_pid is None else _process_cpu_time(server_pid)
+        )
+    finally:
+        client.disable()
+
+    duration = max(end - start, 1e-9)
+    if server_cpu_start is None or server_cpu_end is None:
+        server_cpu = None
+    else:
+        server_cpu = 100.0 * (server_cpu_end - server_cpu_start) / duration
+
+    latencies = numpy.array(
+        [arrival - metadata.timestamp for arrival, _, metadata in arrivals]
+    )
+    # Latency percentiles in milliseconds.
+    latency = {}
+    if latencies.size:
+        for percentile in _LATENCY_PERCENTILES:
+            latency["p%d" % percentile] = 1000.0 * float(
+                numpy.percentile(latencies, percentile)
+            )
+        latency["max"] = 1000.0 * float(latencies.max())
+
+    return BenchmarkResult(
+        parameters=parameters,
+        n_triggered=n_frames,
+        n_received=len(arrivals),
+        n_dropped=sum(m.dropped_frames or 0 for _, _, m in arrivals),
+        n_errors=n_errors,
+        duration=duration,
+        fps=len(arrivals) / duration,
+        mb_per_s=sum(nbytes for _, nbytes, _ in arrivals) / duration / 1e6,
+        latency=latency,
+        client_cpu=100.0 * client_cpu / duration,
+        server_cpu=server_cpu,
+    )
+
+
+def run_benchmark(
+    device_def,
+    rois: typing.Sequence[typing.Optional[microscope.ROI]] = (None,),
+    dtypes: typing.Sequence[typing.Optional[str]] = (None,),
+    transports: typing.Sequence[str] = ("pyro",),
+    batch_sizes: typing.Sequence[int] = (1,),
+    serializers: typing.Sequence[str] = ("pickle",),
+    buffer_lengths: typing.Sequence[typing.Optional[int]] = (None,),
+    n_frames: int = 1000,
+    n_warmup: int = 10,
+    exposure_time: typing.Optional[float] = None,
+    obj_id: typing.Optional[str] = None,
+    timeout: float = 10.0,
+) -> typing.List[BenchmarkResult]:
+    """Benchmark a camera for all combinations of parameters.
+
+    Args:
+        device_def: definition of the camera, as returned by
+            :func:`microscope.device_server.device`.  It is served on
+            a new device server process.
+        rois: ROIs to benchmark.  `None` to keep the current ROI.
+        dtypes: names of the data types to benchmark, via the "image
+            data type" setting.  `None` to keep the current type.
+        transports: "pyro" to send the data over Pyro and
+            "shared-memory" to send it via shared memory.
+        batch_sizes: values for the "dispatch batch size" setting.
+        serializers: Pyro serializers for the device server to send
+            the data.  The device server is restarted for each
+            serializer.
+        buffer_lengths: values for the `buffer_length` argument of
+            the camera.  `None` to use the value from `device_def`.
+            The device server is restarted for each buffer length.
+        n_frames: number of frames to trigger in each benchmark.
+        n_warmup: number of frames to trigger before each benchmark.
+        exposure_time: exposure time to use.  `None` to keep the
+            current exposure time.
+        obj_id: Pyro object identifier of the camera, only required if
+            `device_def` is a function that constructs multiple
+            devices.
+        timeout: number of seconds without receiving data after which
+            the remaining frames are considered lost.
+
+    """
+    for transport in transports:
+        if transport not in TRANSPORTS:
+            raise ValueError("unknown transport '%s'" % transport)
+    if obj_id is None:
+        obj_id = device_def["cls"].__name__
+    uri = "PYRO:%s@%s:%d" % (obj_id, device_def["host"], device_def["port"])
+    simulated = device_def["cls"] is microscope.simulators.SimulatedCamera
+
+    results = []
+    for serializer, buffer_length in itertools.product(
+        serializers, buffer_lengths
+    ):
+        this_def = dict(device_def, conf=dict(device_def["conf"]))
+        if buffer_length is not None:
+            this_def["conf"]["buffer_length"] = buffer_length
+        exit_event = multiprocessing.Event()
+        server = _serve_device(this_def, serializer, exit_event)
+        try:
+            _wait_for_device(uri, server, timeout=max(timeout, 30.0))
+            clients = {
+                transport: _TimingDataClient(
+                    uri, shared_memory=(transport == "shared-memory")
+                )
+                for transport in transports
+            }
+            proxy = clients[transports[0]]._proxy
+            proxy.set_trigger(
+                microscope.TriggerType.SOFTWARE, microscope.TriggerMode.ONCE
+            )
+            if exposure_time is not None:
+                proxy.set_exposure_time(exposure_time)
+            for roi, dtype, transport, batch_size in itertools.product(
+                rois, dtypes, transports, batch_sizes
+            ):
+                parameters = BenchmarkParameters(
+                    roi,
+                    dtype,
+                    transport,
+                    batch_size,
+                    serializer,
+                    buffer_length,
+                )
+                _logger.info("benchmarking with %s", parameters)
+                _configure_device(proxy, parameters, simulated)
+                results.append(
+                    _run_one(
+                        clients[transport],
+                        parameters,
+                        server.pid,
+                        n_frames,
+                        n_warmup,
+                        timeout,
+                    )
+                )
+        finally:
+            exit_event.set()
+            server.join()
+    return results
+
+
+def _format_results(results: typing.Sequence[BenchmarkResult]) -> str:
+    header = (
+        "roi",
+        "dtype",
+        "transport",
+        "batch",
+        "serializer",
+        "buffer",
+        "fps",
+        "MB/s",
+        *("p%d (ms)" % p for p in _LATENCY_PERCENTILES),
+        "max (ms)",
+        "lost",
+        "dropped",
+        "errors",
+        "client cpu%",
+        "server cpu%",
+    )
+
+    def fmt_optional(value, fmt="%s"):
+        return "-" if value is None else fmt % value
+
+    latency_keys = ["p%d" % p for p in _LATENCY_PERCENTILES] + ["max"]
+    rows = [header]
+    for result in results:
+        parameters = result.parameters
+        roi = parameters.roi
+        rows.append(
+            (
+                "-" if roi is None else "%dx%d" % (roi.width, roi.height),
+                fmt_optional(parameters.dtype),
+                parameters.transport,
+                "%d" % parameters.batch_size,
+                parameters.serializer,
+                fmt_optional(parameters.buffer_length, "%d"),
+                "%.1f" % result.fps,
+                "%.1f" % result.mb_per_s,
+                *(
+                    fmt_optional(result.latency.get(key), "%.2f")
+                    for key in latency_keys
+                ),
+                "%d" % result.n_lost,
+                "%d" % result.n_dropped,
+                "%d" % result.n_errors,
+                "%.0f" % result.client_cpu,
+                fmt_optional(result.server_cpu, "%.0f"),
+            )
+        )
+    widths = [max(len(row[i]) for row in rows) for i in range(len(header))]
+    return "\n".join(
+        "  ".join(cell.rjust(width) for cell, width in zip(row, widths))
+        for row in rows
+    )
+
+
+def _parse_roi(roi: str) -> microscope.ROI:
+    # Either WIDTHxHEIGHT or LEFT,TOP,WIDTHxHEIGHT
+    left, top = 0, 0
+    if "," in roi:
+        left, top, roi = roi.split(",")
+    width, height = roi.split("x")
+    return microscope.ROI(int(left), int(top), int(width), int(height))
+
+
+def _parse_cmd_line_args(args: typing.Sequence[str]) -> argparse.Namespace:
+    parser = argparse.ArgumentParser(
+        prog="python -m microscope.testsuite.benchmark"
+    )
+    parser.add_argument(
+        "--config",
+        action="store",
+        type=str,
+        metavar="CONFIG-FILEPATH",
+        help="Device server configuration file with camera to benchmark"
+        " (default is to benchmark a SimulatedCamera)",
+    )
+    parser.add_argument(
+        "--device-index",
+        action="store",
+        type=int,
+        default=0,
+        help="Index of the camera in the configuration DEVICES",
+    )
+    parser.add_argument(
+        "--name",
+        action="store",
+        type=str,
+        help="Pyro ID of the camera if the device definition constructs"
+        " multiple devices",
+    )
+    parser.add_argument(
+        "--port",
+        action="store",
+        type=int,
+        default=8000,
+        help="Port to serve the SimulatedCamera",
+    )
+    parser.add_argument("--frames", action="store", type=int, default=1000)
+    parser.add_argument("--warmup", action="store", type=int, default=10)
+    parser.add_argument(
+        "--exposure",
+        action="store",
+        type=float,
+        default=None,
+        help="Exposure time in seconds (default is 0.001 for the"
+        " SimulatedCamera and unchanged for other cameras)",
+    )
+    parser.add_argument(
+        "--roi",
+        action="store",
+        type=_parse_roi,
+        nargs="+",
+        default=[None],
+        metavar="[LEFT,TOP,]WIDTHxHEIGHT",
+    )
+    parser.add_argument(
+        "--dtype",
+        action="store",
+        type=str,
+        nargs="+",
+        default=[None],
+        help="Values for the 'image data type' setting",
+    )
+    parser.add_argument(
+        "--transport",
+        action="store",
+        type=str,
+        nargs="+",
+        default=["pyro"],
+        choices=TRANSPORTS,
+    )
+    parser.add_argument(
+        "--batch-size", action="store", type=int, nargs="+", default=[1]
+    )
+    parser.add_argument(
+        "--serializer",
+        action="store",
+        type=str,
+        nargs="+",
+        default=["pickle"],
+        choices=["pickle", microscope._serializer.NAME],
+    )
+    parser.add_argument(
+        "--buffer-length", action="store", type=int, nargs="+", default=[None]
+    )
+    parser.add_argument(
+        "--timeout",
+        action="store",
+        type=float,
+        default=10.0,
+        help="Seconds without data after which frames are lost",
+    )
+    parser.add_argument(
+        "--output",
+        action="store",
+        type=str,
+        metavar="JSON-FILEPATH",
+        help="Also write the results to this file",
+    )
+    return parser.parse_args(args)
+
+
+def main(argv: typing.Sequence[str]) -> int:
+    args = _parse_cmd_line_args(argv[1:])
+    logging.basicConfig(level=logging.INFO)
+
+    exposure_time = args.exposure
+    if args.config is None:
+        device_def = microscope.device_server.device(
+            microscope.simulators.SimulatedCamera, "127.0.0.1", args.port
+        )
+        if exposure_time is None:
+            exposure_time = 0.001
+    else:
+        devices = list(microscope.device_server.validate_devices(args.config))
+        device_def = devices[args.device_index]
+
+    results = run_benchmark(
+        device_def,
+        rois=args.roi,
+        dtypes=args.dtype,
+        transports=args.transport,
+        batch_sizes=args.batch_size,
+        serializers=args.serializer,
+        buffer_lengths=args.buffer_length,
+        n_frames=args.frames,
+        n_warmup=args.warmup,
+        exposure_time=exposure_time,
+        obj_id=args.name,
+        timeout=args.timeout,
+    )
+
+    print(_format_results(results))
+    if args.output is not None:
+        with open(args.output, "w") as fh:
+            json.dump([r.as_dict() for r in results], fh, indent=2)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -38,6 +38,7 @@ class PyroService:
 
     def __init__(self):
         self._value = 42  # not exposed
+        self._release = threading.Event()  # not exposed
 
     @property
     def attr(self):  # exposed as 'proxy.attr' remote attribute
@@ -47,6 +48,11 @@ class PyroService:
     def attr(self, value):  # exposed as 'proxy.attr' writable
         self._value = value
 
+    def wait_for_release(self):
+        """Block until released, like a slow stage move."""
+        self._release.wait(timeout=10)
+        return self._value
+
 
 @Pyro4.expose
 class ExposedDeformableMirror(dummies.TestDeformableMirror):
@@ -99,6 +105,46 @@ class TestClient(unittest.TestCase):
         self.assertTrue(client.attr, 10)
         self.assertTrue(obj.attr, 10)
 
+    def test_call_async(self):
+        """Test methods can be called asynchronously via the Client"""
+        obj = ExposedDeformableMirror(10)
+        client = (self._serve_objs([obj]))[0]
+        future = client.call_async("get_is_enabled")
+        self.assertEqual(future.result(timeout=10), obj.get_is_enabled())
+
+    def test_slow_async_call_does_not_delay_others(self):
+        """Test an asynchronous call does not delay other calls"""
+        obj = PyroService()
+        client = (self._serve_objs([obj]))[0]
+        slow = client.call_async("wait_for_release")
+        # The slow call holds its own connection so this one, on the
+        # proxy of the client, does not wait for it.
+        self.assertEqual(client.attr, 42)
+        self.assertFalse(slow.done())
+        obj._release.set()
+        self.assertEqual(slow.result(timeout=10), 42)
+
+    def test_async_connections_reused(self):
+        """Test asynchronous calls reuse a bounded number of proxies"""
+        obj = ExposedDeformableMirror(10)
+        client = (self._serve_objs([obj]))[0]
+        futures = [client.call_async("get_is_enabled") for _ in range(20)]
+        for future in futures:
+            future.result(timeout=10)
+        self.assertLessEqual(
+            len(client._async_proxies), microscope.clients._MAX_ASYNC_PROXIES
+        )
+        client.close_async_connections()
+        self.assertEqual(client._async_proxies, [])
+
+    def test_call_async_exception(self):
+        """Test exceptions from asynchronous calls are in the future"""
+        obj = ExposedDeformableMirror(10)
+        client = (self._serve_objs([obj]))[0]
+        future = client.get_setting_async("not a setting")
+        with self.assertRaises(KeyError):
+            future.result(timeout=10)
+
 
 if __name__ == "__main__":
     unittest.main()
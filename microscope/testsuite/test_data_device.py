@@ -0,0 +1,1005 @@
+#!/usr/bin/env python3
+
+## Copyright (C) 2020 David Miguel Susano Pinto <carandraug@gmail.com>
+##
+## This file is part of Microscope.
+##
+## Microscope is free software: you can redistribute it and/or modify
+## it under the terms of the GNU General Public License as published by
+## the Free Software Foundation, either version 3 of the License, or
+## (at your option) any later version.
+##
+## Microscope is distributed in the hope that it will be useful,
+## but WITHOUT ANY WARRANTY; without even the implied warranty of
+## MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+## GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License
+## along with Microscope.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Tests for the data path of `DataDevice`, from fetch to client.
+"""
+
+import importlib.util
+import json
+import os.path
+import queue
+import tempfile
+import threading
+import time
+import unittest
+import unittest.mock
+
+import numpy
+import Pyro4
+
+import microscope
+import microscope.abc
+from microscope.simulators import (
+    SimulatedCamera,
+    SimulatedDeformableMirror,
+    SimulatedFilterWheel,
+    SimulatedStage,
+)
+
+
+class TestFramePool(unittest.TestCase):
+    def setUp(self):
+        self.pool = microscope.abc.FramePool(max_free=2)
+
+    def test_get_shape_and_dtype(self):
+        array = self.pool.get((4, 8), "uint16")
+        self.assertEqual(array.shape, (4, 8))
+        self.assertEqual(array.dtype, numpy.uint16)
+        self.assertTrue(array.flags["C_CONTIGUOUS"])
+
+    def test_aligned(self):
+        for shape in [(1,), (3, 5), (512, 512)]:
+            array = self.pool.get(shape, "uint8")
+            self.assertEqual(array.ctypes.data % 64, 0)
+
+    def test_reuse_released(self):
+        array = self.pool.get((4, 8), "uint16")
+        self.pool.release(array)
+        self.assertIs(self.pool.get((4, 8), "uint16"), array)
+
+    def test_no_reuse_for_other_shape_or_dtype(self):
+        array = self.pool.get((4, 8), "uint16")
+        self.pool.release(array)
+        self.assertIsNot(self.pool.get((8, 4), "uint16"), array)
+        self.assertIsNot(self.pool.get((4, 8), "uint8"), array)
+
+    def test_no_reuse_if_discarded(self):
+        array = self.pool.get((4, 8), "uint16")
+        self.pool.discard(array)
+        self.pool.release(array)
+        self.assertIsNot(self.pool.get((4, 8), "uint16"), array)
+
+    def test_no_reuse_after_clear(self):
+        array = self.pool.get((4, 8), "uint16")
+        self.pool.clear()
+        self.pool.release(array)
+        self.assertIsNot(self.pool.get((4, 8), "uint16"), array)
+
+    def test_ignore_foreign_arrays(self):
+        array = numpy.empty((4, 8), dtype="uint16")
+        self.pool.release(array)
+        self.assertIsNot(self.pool.get((4, 8), "uint16"), array)
+
+    def test_max_free(self):
+        arrays = [self.pool.get((2,), "uint8") for i in range(3)]
+        for array in arrays:
+            self.pool.release(array)
+        reused = [self.pool.get((2,), "uint8") for i in range(3)]
+        self.assertEqual(sum(any(r is a for a in arrays) for r in reused), 2)
+
+    def test_lent_array_release(self):
+        released = []
+        array = numpy.zeros((4, 8), dtype="uint16")
+        self.pool.lend(array, lambda: released.append(True))
+        self.assertTrue(self.pool.is_lent(array))
+        self.pool.release(array)
+        self.pool.release(array)
+        self.assertEqual(released, [True])
+        self.assertFalse(self.pool.is_lent(array))
+        self.assertIsNot(self.pool.get((4, 8), "uint16"), array)
+
+    def test_lent_array_discard(self):
+        released = []
+        array = numpy.zeros((4, 8), dtype="uint16")
+        self.pool.lend(array, lambda: released.append(True))
+        self.pool.clear()
+        self.pool.discard(array)
+        self.assertEqual(released, [True])
+
+    def test_copy_lent(self):
+        released = []
+        array = numpy.arange(32, dtype="uint16").reshape(4, 8)
+        self.pool.lend(array, lambda: released.append(True))
+        copy = self.pool.copy_lent(array)
+        self.assertIsNot(copy, array)
+        numpy.testing.assert_array_equal(copy, array)
+        self.assertEqual(released, [True])
+        self.assertIs(self.pool.copy_lent(copy), copy)
+
+
+class TestBufferArena(unittest.TestCase):
+    def setUp(self):
+        self.arena = microscope.abc.BufferArena()
+
+    def test_get(self):
+        buffers = self.arena.get(3, 100)
+        self.assertEqual([b.nbytes for b in buffers], [100] * 3)
+        self.assertEqual(len({b.ctypes.data for b in buffers}), 3)
+        for buffer in buffers:
+            self.assertEqual(buffer.ctypes.data % 64, 0)
+
+    def test_smaller_buffers_reuse_memory(self):
+        buffers = self.arena.get(3, 100)
+        smaller = self.arena.get(2, 40)
+        self.assertEqual(
+            [b.ctypes.data for b in smaller],
+            [b.ctypes.data for b in buffers[:2]],
+        )
+        self.assertEqual(self.arena.capacity, 100)
+
+    def test_larger_buffers_reallocate(self):
+        self.arena.get(2, 100)
+        self.assertEqual([b.nbytes for b in self.arena.get(2, 200)], [200] * 2)
+        self.assertEqual(self.arena.capacity, 200)
+
+
+class FakeAcquiringCamera:
+    def __init__(self):
+        self._acquiring = True
+        self.live = False
+        self.calls = []
+        self.invalidated = 0
+
+    def abort(self):
+        self.calls.append("abort")
+
+    def _invalidate_settings_cache(self):
+        self.invalidated += 1
+
+    def _do_enable(self):
+        self.calls.append("enable")
+
+    @microscope.abc.keep_acquiring
+    def set_roi(self):
+        self.calls.append("set_roi")
+
+    @microscope.abc.keep_acquiring(live=lambda self: self.live)
+    def set_exposure_time(self):
+        self.calls.append("set_exposure_time")
+
+
+class TestKeepAcquiring(unittest.TestCase):
+    def setUp(self):
+        self.camera = FakeAcquiringCamera()
+
+    def test_restart(self):
+        self.camera.set_roi()
+        self.assertEqual(self.camera.calls, ["abort", "set_roi", "enable"])
+
+    def test_live_change(self):
+        self.camera.live = True
+        self.camera.set_exposure_time()
+        self.assertEqual(self.camera.calls, ["set_exposure_time"])
+
+    def test_restart_if_live_change_not_possible(self):
+        self.camera.set_exposure_time()
+        self.assertEqual(
+            self.camera.calls, ["abort", "set_exposure_time", "enable"]
+        )
+
+    def test_invalidates_settings_cache(self):
+        self.camera.set_roi()
+        self.camera.live = True
+        self.camera.set_exposure_time()
+        self.assertEqual(self.camera.invalidated, 2)
+
+
+class TestLiveSettings(unittest.TestCase):
+    def setUp(self):
+        self.camera = SimulatedCamera()
+        self.camera.add_setting(
+            "exposure time",
+            "float",
+            self.camera.get_exposure_time,
+            self.camera.set_exposure_time,
+            (0.0, 1.0),
+            live=True,
+        )
+        self.camera.enable()
+        self.aborts = 0
+        original_abort = self.camera.abort
+
+        def counting_abort():
+            self.aborts += 1
+            original_abort()
+
+        self.camera.abort = counting_abort
+
+    def tearDown(self):
+        self.camera.shutdown()
+
+    def test_set_live_setting(self):
+        self.camera.set_setting("exposure time", 0.5)
+        self.assertEqual(self.aborts, 0)
+        self.assertEqual(self.camera.get_exposure_time(), 0.5)
+        self.assertTrue(self.camera._acquiring)
+
+    def test_set_setting_pauses(self):
+        self.camera.set_setting("gain", 4)
+        self.assertEqual(self.aborts, 1)
+        self.assertTrue(self.camera._acquiring)
+
+    def test_update_settings(self):
+        self.camera.update_settings({"exposure time": 0.2})
+        self.assertEqual(self.aborts, 0)
+        self.camera.update_settings({"exposure time": 0.3, "gain": 2})
+        self.assertEqual(self.aborts, 1)
+
+    def test_setters_invalidate_settings_cache(self):
+        self.camera.get_all_settings()
+        self.camera.set_exposure_time(0.25)
+        self.camera.set_roi(microscope.ROI(0, 0, 128, 64))
+        settings = self.camera.get_all_settings()
+        self.assertEqual(settings["exposure time"], 0.25)
+        self.assertEqual(tuple(settings["roi"]), (0, 0, 128, 64))
+
+
+class RecordingClient:
+    """Client which records the calls, and copies of the data."""
+
+    def __init__(self, n_data):
+        self.calls = []
+        self._n_data = n_data
+        self._n_received = 0
+        self.done = threading.Event()
+
+    def _count(self, n):
+        self._n_received += n
+        if self._n_received >= self._n_data:
+            self.done.set()
+
+    def receiveData(self, data, timestamp, *args):
+        self.calls.append(("receiveData", data.copy(), timestamp))
+        self._count(1)
+
+
+class BatchClient(RecordingClient):
+    """Client which also supports batches."""
+
+    def receiveDataBatch(self, data, timestamps, *args):
+        self.calls.append(("receiveDataBatch", data.copy(), timestamps))
+        self._count(len(timestamps))
+
+
+class TestBatchDispatch(unittest.TestCase):
+    def setUp(self):
+        self.camera = SimulatedCamera()
+        self.camera.set_setting("dispatch batch size", 4)
+        self.camera.set_setting("dispatch batch timeout", 1.0)
+
+    def tearDown(self):
+        self.camera.shutdown()
+
+    def put_and_wait(self, client, frames):
+        self.camera.set_client(client)
+        self.camera.enable()
+        for i, frame in enumerate(frames):
+            self.camera._put(frame, float(i))
+        self.assertTrue(client.done.wait(timeout=5.0))
+
+    def test_batch(self):
+        client = BatchClient(4)
+        frames = [numpy.full((4, 6), i, dtype="uint16") for i in range(4)]
+        self.put_and_wait(client, frames)
+        self.assertEqual(len(client.calls), 1)
+        method, data, timestamps = client.calls[0]
+        self.assertEqual(method, "receiveDataBatch")
+        numpy.testing.assert_array_equal(data, numpy.stack(frames))
+        self.assertEqual(list(timestamps), [0.0, 1.0, 2.0, 3.0])
+
+    def test_split_on_shape_change(self):
+        client = BatchClient(4)
+        frames = [numpy.zeros((4, 6), dtype="uint16")] * 2
+        frames += [numpy.zeros((2, 3), dtype="uint16")] * 2
+        self.put_and_wait(client, frames)
+        self.assertEqual(
+            [data.shape for method, data, ts in client.calls],
+            [(2, 4, 6), (2, 2, 3)],
+        )
+
+    def test_client_without_batch_support(self):
+        client = RecordingClient(4)
+        frames = [numpy.full((4, 6), i, dtype="uint16") for i in range(4)]
+        self.put_and_wait(client, frames)
+        self.assertEqual(
+            [method for method, data, ts in client.calls], ["receiveData"] * 4
+        )
+        for frame, call in zip(frames, client.calls):
+            numpy.testing.assert_array_equal(call[1], frame)
+
+    def test_proxy_batch_support_from_its_methods(self):
+        # Checking the methods of a proxy must not connect to it.
+        proxy = Pyro4.Proxy("PYRO:client@127.0.0.1:1")
+        self.assertFalse(
+            microscope.abc._client_has_method(proxy, "receiveDataBatch")
+        )
+        proxy._pyroMethods = {"receiveData", "receiveDataBatch"}
+        self.assertTrue(
+            microscope.abc._client_has_method(proxy, "receiveDataBatch")
+        )
+        self.assertFalse(microscope.abc._client_has_method(proxy, "put"))
+
+    def test_first_data_to_unbound_proxy(self):
+        received = queue.Queue()
+
+        class UnboundQueueProxy(Pyro4.Proxy):
+            # Like the GUI queue, the remote object only has put, and
+            # the proxy does not know it until it gets the metadata.
+            def _pyroGetMetadata(self, *args, **kwargs):
+                self._pyroMethods = {"put"}
+
+            def put(self, data):
+                received.put(data)
+
+        proxy = UnboundQueueProxy("PYRO:queue@127.0.0.1:1")
+        self.assertFalse(proxy._pyroMethods)
+        self.camera.set_client(proxy)
+        self.camera._put(numpy.zeros((4, 6), dtype="uint16"), 0.0)
+        self.assertEqual(received.get(timeout=5.0).shape, (4, 6))
+
+    def test_batch_size_must_be_positive(self):
+        with self.assertRaises(ValueError):
+            self.camera.set_setting("dispatch batch size", 0)
+
+
+class ArgsClient:
+    """Client which keeps the arguments of the last receiveData call."""
+
+    def receiveData(self, *args):
+        self.args = args
+
+
+class TestFrameMetadata(unittest.TestCase):
+    def setUp(self):
+        self.camera = SimulatedCamera()
+        self.data = numpy.zeros((4, 4), dtype="uint16")
+
+    def tearDown(self):
+        self.camera.shutdown()
+
+    def put_and_get_metadata(self, metadata):
+        self.camera._put(self.data, 1.5, metadata)
+        return self.camera._dispatch_buffer.get()[3]
+
+    def test_timestamp(self):
+        metadata = self.put_and_get_metadata(None)
+        self.assertEqual(metadata.timestamp, 1.5)
+        self.assertIsNone(metadata.frame_number)
+        self.assertIsNone(metadata.dropped_frames)
+
+    def test_dropped_frames(self):
+        dropped = []
+        for frame_number in [1, 2, 5, 6]:
+            metadata = self.put_and_get_metadata(
+                microscope.FrameMetadata(frame_number=frame_number)
+            )
+            dropped.append(metadata.dropped_frames)
+        self.assertEqual(dropped, [None, 0, 2, 0])
+
+    def test_keep_hardware_timestamp(self):
+        metadata = self.put_and_get_metadata(
+            microscope.FrameMetadata(hardware_timestamp=20.0)
+        )
+        self.assertEqual(metadata.hardware_timestamp, 20.0)
+        self.assertEqual(metadata.timestamp, 1.5)
+
+    def test_local_client_gets_copy_of_lent_data(self):
+        released = []
+        self.camera._frame_pool.lend(self.data, lambda: released.append(1))
+        client = ArgsClient()
+        self.camera.set_client(client)
+        self.camera._dispatch_item(client, self.data, 1.5, None)
+        self.assertIsNot(client.args[0], self.data)
+        numpy.testing.assert_array_equal(client.args[0], self.data)
+        self.assertEqual(released, [1])
+
+    def test_roi(self):
+        roi = microscope.ROI(2, 4, 8, 16)
+        metadata = self.put_and_get_metadata(
+            microscope.FrameMetadata(frame_number=1, roi=roi)
+        )
+        self.assertEqual(metadata.roi, roi)
+
+    def test_metadata_only_if_requested(self):
+        metadata = microscope.FrameMetadata(timestamp=1.5, frame_number=3)
+        client = ArgsClient()
+        self.camera.set_client(client)
+        self.camera._send_data(client, self.data, 1.5, metadata)
+        self.assertEqual(client.args, (self.data, 1.5))
+
+        client = ArgsClient()
+        self.camera.set_client(client, metadata=True)
+        self.camera._send_data(client, self.data, 1.5, metadata)
+        self.assertEqual(client.args, (self.data, 1.5, metadata))
+
+
+class TestSimulatedCameraWaitForData(unittest.TestCase):
+    def setUp(self):
+        self.camera = SimulatedCamera()
+        self.camera.set_exposure_time(0.05)
+        # Only prepare the camera for acquisition.  Enabling it
+        # would start the fetch thread which would take the images.
+        self.camera._do_enable()
+
+    def tearDown(self):
+        self.camera.shutdown()
+
+    def test_timeout_without_trigger(self):
+        start = time.monotonic()
+        self.camera._wait_for_data(0.1)
+        self.assertGreaterEqual(time.monotonic() - start, 0.09)
+        self.assertIsNone(self.camera._fetch_data())
+
+    def test_returns_at_end_of_exposure(self):
+        start = time.monotonic()
+        self.camera._do_trigger()
+        self.camera._wait_for_data(5.0)
+        self.assertGreaterEqual(time.monotonic() - start, 0.04)
+        self.assertLess(time.monotonic() - start, 1.0)
+        self.assertIsNotNone(self.camera._fetch_data())
+        self.assertIsNone(self.camera._fetch_data())
+
+    def test_exposures_are_sequential(self):
+        start = time.monotonic()
+        self.camera._do_trigger()
+        self.camera._do_trigger()
+        self.camera._wait_for_data(5.0)
+        self.assertIsNotNone(self.camera._fetch_data())
+        self.assertIsNone(self.camera._fetch_data())
+        self.camera._wait_for_data(5.0)
+        self.assertGreaterEqual(time.monotonic() - start, 0.09)
+        self.assertIsNotNone(self.camera._fetch_data())
+
+
+class TestSimulatedCameraPerformanceMode(unittest.TestCase):
+    def setUp(self):
+        self.camera = SimulatedCamera()
+        self.camera.set_setting("display image number", False)
+
+    def tearDown(self):
+        self.camera.shutdown()
+
+    def fetch(self):
+        self.camera._wait_for_data(5.0)
+        return self.camera._fetch_data()
+
+    def test_free_running(self):
+        self.camera.set_setting("frame rate", 50.0)
+        self.camera._do_enable()
+        start = time.monotonic()
+        numbers = [self.fetch()[1].frame_number for i in range(3)]
+        self.assertEqual(numbers, [0, 1, 2])
+        self.assertGreaterEqual(time.monotonic() - start, 0.055)
+        self.assertLess(time.monotonic() - start, 1.0)
+
+    def test_late_frames_are_lost(self):
+        self.camera.set_setting("frame rate", 20.0)
+        self.camera._do_enable()
+        time.sleep(0.11)
+        self.assertGreaterEqual(self.fetch()[1].frame_number, 1)
+        self.assertIsNone(self.camera._fetch_data())
+
+    def test_triggers_ignored_while_free_running(self):
+        self.camera.set_setting("frame rate", 50.0)
+        self.camera._do_enable()
+        for i in range(100):
+            self.camera._do_trigger()
+        self.assertEqual(len(self.camera._exposures), 0)
+
+    def test_simulated_drops(self):
+        self.camera.set_exposure_time(0.0)
+        self.camera._do_enable()
+        self.camera.set_setting("simulated drop percent", 100)
+        self.camera._do_trigger()
+        self.assertIsNone(self.fetch())
+        self.camera.set_setting("simulated drop percent", 0)
+        self.camera._do_trigger()
+        self.assertEqual(self.fetch()[1].frame_number, 1)
+
+    def test_precomputed_frames(self):
+        self.camera.set_exposure_time(0.0)
+        self.camera.set_setting("precomputed frames", 2)
+        self.camera._do_enable()
+        images = []
+        for i in range(3):
+            self.camera._do_trigger()
+            images.append(self.fetch()[0])
+        numpy.testing.assert_array_equal(images[0], images[2])
+        self.assertIsNot(images[0], images[2])
+        self.assertEqual(images[0].shape, (512, 512))
+
+
+@unittest.skipUnless(importlib.util.find_spec("scipy"), "requires scipy")
+class TestStageAwareCamera(unittest.TestCase):
+    def setUp(self):
+        from microscope.simulators.stage_aware_camera import StageAwareCamera
+
+        self.image = numpy.random.randint(
+            0, 255, size=(1000, 1000, 2), dtype=numpy.uint8
+        )
+        self.stage = SimulatedStage(
+            {
+                "x": microscope.AxisLimits(0, 1000),
+                "y": microscope.AxisLimits(0, 1000),
+                "z": microscope.AxisLimits(-50, 50),
+            }
+        )
+        self.filterwheel = SimulatedFilterWheel(positions=2)
+        self.camera = StageAwareCamera(
+            self.image, self.stage, self.filterwheel
+        )
+        self.camera.set_exposure_time(0.0)
+        self.camera._do_enable()
+
+    def tearDown(self):
+        self.camera.shutdown()
+
+    def fetch(self):
+        self.camera._do_trigger()
+        self.camera._wait_for_data(5.0)
+        return self.camera._fetch_data()[0]
+
+    def test_tiles_match_blur_of_whole_image(self):
+        import scipy.ndimage
+
+        self.stage.move_to({"x": 500.0, "y": 400.0, "z": 20.0})
+        self.filterwheel.position = 1
+        expected = scipy.ndimage.gaussian_filter(self.image[:, :, 1], 2.0)
+        expected = expected[144:656, 244:756][::-1, ::-1]
+        numpy.testing.assert_array_equal(self.fetch(), expected)
+        # The second image is made from the cached tiles.
+        n_tiles = len(self.camera._tiles)
+        numpy.testing.assert_array_equal(self.fetch(), expected)
+        self.assertEqual(len(self.camera._tiles), n_tiles)
+
+
+def _reference_transform(data, transform):
+    """Transform data the obvious, and slow, way."""
+    lr, ud, rot = transform
+    data = numpy.rot90(data, rot)
+    if ud:
+        data = numpy.flipud(data)
+    if lr:
+        data = numpy.fliplr(data)
+    return data
+
+
+class TestTransform(unittest.TestCase):
+    def setUp(self):
+        self.camera = SimulatedCamera()
+        self.data = numpy.arange(12, dtype="uint16").reshape(3, 4)
+
+    def tearDown(self):
+        self.camera.shutdown()
+
+    def test_transform_view(self):
+        for transform in microscope.abc.Camera.ALLOWED_TRANSFORMS:
+            numpy.testing.assert_array_equal(
+                microscope.abc.transform_view(self.data, transform),
+                _reference_transform(self.data, transform),
+            )
+
+    def test_process_data(self):
+        for transform in microscope.abc.Camera.ALLOWED_TRANSFORMS:
+            self.camera.set_transform(transform)
+            processed = self.camera._process_data(self.data)
+            self.assertTrue(processed.flags["C_CONTIGUOUS"])
+            numpy.testing.assert_array_equal(
+                processed, _reference_transform(self.data, transform)
+            )
+
+    def test_transform_on_client(self):
+        self.camera.set_transform((True, False, True))
+        self.camera.set_setting("transform on client", True)
+        self.assertIs(self.camera._process_data(self.data), self.data)
+        self.camera._put(self.data, 0.0)
+        metadata = self.camera._dispatch_buffer.get()[3]
+        self.assertEqual(metadata.transform, (True, False, True))
+
+
+def _pack_mono12(pixels: numpy.ndarray) -> numpy.ndarray:
+    """Reference Mono12Packed packing, one pair of pixels at a time."""
+    packed = []
+    for row in pixels.tolist():
+        packed_row = []
+        for i in range(0, len(row), 2):
+            first = row[i]
+            second = row[i + 1] if i + 1 < len(row) else 0
+            packed_row.extend(
+                [first >> 4, (first & 0x0F) | (second & 0x0F) << 4]
+            )
+            if i + 1 < len(row):
+                packed_row.append(second >> 4)
+        packed.append(packed_row)
+    return numpy.array(packed, dtype=numpy.uint8)
+
+
+class TestUnpackPixels(unittest.TestCase):
+    def setUp(self):
+        self.pixels = (
+            numpy.arange(4 * 6, dtype=numpy.uint16).reshape(4, 6) * 171
+        ) % 4096
+
+    def test_mono12packed(self):
+        packed = _pack_mono12(self.pixels)
+        self.assertEqual(packed.shape, (4, 9))
+        unpacked = microscope.abc.unpack_pixels(packed, "Mono12Packed")
+        self.assertEqual(unpacked.dtype, numpy.uint16)
+        numpy.testing.assert_array_equal(unpacked, self.pixels)
+
+    def test_mono12packed_odd_width(self):
+        pixels = self.pixels[:, :5]
+        packed = _pack_mono12(pixels)
+        self.assertEqual(packed.shape, (4, 8))
+        numpy.testing.assert_array_equal(
+            microscope.abc.unpack_mono12packed(packed, width=5), pixels
+        )
+
+    def test_unknown_encoding(self):
+        with self.assertRaises(ValueError):
+            microscope.abc.unpack_pixels(self.pixels, "Mono22Packed")
+
+
+class SlowClient(RecordingClient):
+    """Client that blocks on receiveData until released."""
+
+    def __init__(self, n_data):
+        super().__init__(n_data)
+        self.entered = threading.Event()
+        self.release = threading.Event()
+
+    def receiveData(self, data, timestamp, *args):
+        self.entered.set()
+        self.release.wait()
+        super().receiveData(data, timestamp, *args)
+
+
+class TestSubscribers(unittest.TestCase):
+    def setUp(self):
+        self.camera = SimulatedCamera()
+        self.frames = [numpy.full((2, 2), i, dtype="uint8") for i in range(5)]
+
+    def tearDown(self):
+        self.camera.shutdown()
+
+    def put_frames(self, blocked_client=None):
+        for i, frame in enumerate(self.frames):
+            self.camera._put(frame, float(i))
+            if i == 0 and blocked_client is not None:
+                # Wait for the client to be blocked on the first
+                # frame so that the others stay on the queue.
+                self.assertTrue(blocked_client.entered.wait(timeout=5.0))
+
+    def received_values(self, client):
+        return [int(data[0, 0]) for method, data, ts in client.calls]
+
+    def test_all_subscribers_get_all_data(self):
+        clients = [RecordingClient(5) for i in range(3)]
+        for client in clients:
+            self.camera.set_client(
+                client, drop_policy=microscope.DropPolicy.BLOCK
+            )
+        self.put_frames()
+        for client in clients:
+            self.assertTrue(client.done.wait(timeout=5.0))
+            self.assertEqual(self.received_values(client), [0, 1, 2, 3, 4])
+
+    def test_slow_subscriber_does_not_delay_others(self):
+        slow = SlowClient(2)
+        fast = RecordingClient(5)
+        self.camera.set_client(
+            slow, drop_policy=microscope.DropPolicy.LATEST_ONLY
+        )
+        self.camera.set_client(fast, drop_policy=microscope.DropPolicy.BLOCK)
+        self.put_frames(blocked_client=slow)
+        self.assertTrue(fast.done.wait(timeout=5.0))
+        slow.release.set()
+        self.assertTrue(slow.done.wait(timeout=5.0))
+        # The slow client gets the first frame, which it was already
+        # sending while blocked, and then only the latest.
+        self.assertEqual(self.received_values(slow), [0, 4])
+
+    def test_drop_oldest(self):
+        slow = SlowClient(3)
+        self.camera.set_client(
+            slow, drop_policy=microscope.DropPolicy.DROP_OLDEST, queue_size=2
+        )
+        self.put_frames(blocked_client=slow)
+        slow.release.set()
+        self.assertTrue(slow.done.wait(timeout=5.0))
+        self.assertEqual(self.received_values(slow), [0, 3, 4])
+
+    def test_preview_max_size(self):
+        client = RecordingClient(1)
+        self.camera.set_preview_client(client, max_size=4)
+        self.camera._put(numpy.zeros((10, 6), dtype="uint8"), 0.0)
+        self.assertTrue(client.done.wait(timeout=5.0))
+        self.assertEqual(client.calls[0][1].shape, (4, 2))
+
+    def test_preview_max_rate(self):
+        client = RecordingClient(1)
+        self.camera.set_preview_client(client, max_rate=0.1)
+        self.put_frames()
+        self.assertTrue(client.done.wait(timeout=5.0))
+        self.camera.remove_client(client)
+        self.assertEqual(self.received_values(client), [0])
+
+    def test_preview_max_rate_sends_latest(self):
+        client = RecordingClient(2)
+        self.camera.set_preview_client(client, max_rate=10.0)
+        self.put_frames()
+        self.assertTrue(client.done.wait(timeout=5.0))
+        self.camera.remove_client(client)
+        # The last frame of the burst is sent after the interval.
+        self.assertEqual(self.received_values(client), [0, 4])
+
+    def test_drain_with_batches(self):
+        self.camera.set_setting("dispatch batch size", 8)
+        self.camera.set_setting("dispatch batch timeout", 5.0)
+        client = RecordingClient(5)
+        self.camera.set_client(client, drop_policy=microscope.DropPolicy.BLOCK)
+        self.put_frames()
+        # The stop comes in the same batch as the frames.
+        self.camera._remove_subscriber(client, drain=True)
+        self.assertEqual(self.received_values(client), [0, 1, 2, 3, 4])
+
+    def test_remove_unknown_subscriber(self):
+        with self.assertRaises(ValueError):
+            self.camera.remove_client(RecordingClient(1))
+
+
+class MirrorLoop:
+    """Processing stage that applies the mean of each image to a mirror."""
+
+    def __init__(self, mirror, n_calls):
+        self._mirror = mirror
+        self._pattern = numpy.zeros(mirror.n_actuators)
+        self.metadata = []
+        self._n_calls = n_calls
+        self.done = threading.Event()
+
+    def __call__(self, data, timestamp, metadata):
+        self._pattern[:] = data.mean() / 255.0
+        self._mirror.apply_pattern(self._pattern)
+        self.metadata.append(metadata)
+        if len(self.metadata) == self._n_calls:
+            self.done.set()
+
+
+class TestProcessingStage(unittest.TestCase):
+    def setUp(self):
+        self.camera = SimulatedCamera()
+        self.mirror = SimulatedDeformableMirror(n_actuators=4)
+
+    def tearDown(self):
+        self.camera.shutdown()
+        self.mirror.shutdown()
+
+    def test_stage_drives_colocated_device(self):
+        stage = MirrorLoop(self.mirror, 1)
+        self.camera.add_processing_stage(stage)
+        self.camera._put(numpy.full((2, 2), 51, dtype="uint8"), 1.0)
+        self.assertTrue(stage.done.wait(timeout=5.0))
+        numpy.testing.assert_array_almost_equal(
+            self.mirror.get_current_pattern(), [0.2] * 4
+        )
+        self.assertEqual(stage.metadata[0].timestamp, 1.0)
+
+    def test_stage_gets_all_data_with_block(self):
+        stage = MirrorLoop(self.mirror, 3)
+        self.camera.add_processing_stage(
+            stage, drop_policy=microscope.DropPolicy.BLOCK, queue_size=4
+        )
+        for i in range(3):
+            self.camera._put(numpy.zeros((2, 2), dtype="uint8"), float(i))
+        self.assertTrue(stage.done.wait(timeout=5.0))
+        self.assertEqual(
+            [m.timestamp for m in stage.metadata], [0.0, 1.0, 2.0]
+        )
+
+    def test_remove_stage(self):
+        stage = MirrorLoop(self.mirror, 1)
+        self.camera.add_processing_stage(stage)
+        self.camera.remove_processing_stage(stage)
+        self.camera._put(numpy.zeros((2, 2), dtype="uint8"), 0.0)
+        self.assertFalse(stage.done.wait(timeout=0.2))
+        with self.assertRaises(ValueError):
+            self.camera.remove_processing_stage(stage)
+
+    def test_failing_stage_does_not_stop_others(self):
+        def failing_stage(data, timestamp, metadata):
+            raise RuntimeError("failed to process")
+
+        client = RecordingClient(1)
+        self.camera.add_processing_stage(failing_stage)
+        self.camera.set_client(client, drop_policy=microscope.DropPolicy.BLOCK)
+        self.camera._put(numpy.zeros((2, 2), dtype="uint8"), 0.0)
+        self.assertTrue(client.done.wait(timeout=5.0))
+
+
+class TestRecording(unittest.TestCase):
+    def setUp(self):
+        self.camera = SimulatedCamera()
+        self.tmp_dir = tempfile.TemporaryDirectory()
+        self.path = os.path.join(self.tmp_dir.name, "recording.raw")
+
+    def tearDown(self):
+        self.camera.shutdown()
+        self.tmp_dir.cleanup()
+
+    def test_record(self):
+        frames = [numpy.full((3, 4), i, dtype="uint16") for i in range(5)]
+        self.camera.set_setting("recording path", self.path)
+        self.camera.set_setting("recording", True)
+        self.assertTrue(self.camera.get_setting("recording"))
+        for i, frame in enumerate(frames):
+            self.camera._put(
+                frame, float(i), microscope.FrameMetadata(frame_number=i)
+            )
+        self.camera.set_setting("recording", False)
+
+        with open(self.path + ".json") as fh:
+            description = json.load(fh)
+        self.assertEqual(description["shape"], [5, 3, 4])
+        recorded = numpy.memmap(
+            self.path,
+            dtype=description["dtype"],
+            mode="r",
+            shape=tuple(description["shape"]),
+        )
+        numpy.testing.assert_array_equal(recorded, numpy.stack(frames))
+        del recorded
+        with open(self.path + ".tsv") as fh:
+            lines = fh.read().splitlines()
+        self.assertEqual(len(lines), 6)
+        self.assertTrue(lines[0].startswith("timestamp\t"))
+
+    def test_require_path(self):
+        with self.assertRaises(microscope.IncompatibleStateError):
+            self.camera.set_setting("recording", True)
+
+    def test_new_file_on_shape_change(self):
+        self.camera.set_setting("recording path", self.path)
+        self.camera.set_setting("recording", True)
+        self.camera._put(numpy.zeros((3, 4), dtype="uint16"), 0.0)
+        self.camera._put(numpy.zeros((3, 4), dtype="uint16"), 1.0)
+        self.camera._put(numpy.zeros((2, 2), dtype="uint8"), 2.0)
+        self.camera.set_setting("recording", False)
+
+        descriptions = []
+        second_path = os.path.join(self.tmp_dir.name, "recording-1.raw")
+        for path in (self.path, second_path):
+            with open(path + ".json") as fh:
+                descriptions.append(json.load(fh))
+        self.assertEqual(descriptions[0]["shape"], [2, 3, 4])
+        self.assertEqual(descriptions[1]["shape"], [1, 2, 2])
+        self.assertEqual(numpy.dtype(descriptions[1]["dtype"]), numpy.uint8)
+
+    def test_recording_is_live(self):
+        self.camera.enable()
+        self.camera.set_setting("recording path", self.path)
+        with unittest.mock.patch.object(self.camera, "abort") as abort:
+            self.camera.set_setting("recording", True)
+            self.camera.set_setting("dispatch batch size", 2)
+            self.camera.set_setting("recording", False)
+        abort.assert_not_called()
+
+    def test_never_overwrite(self):
+        open(self.path, "w").close()
+        self.camera.set_setting("recording path", self.path)
+        with self.assertRaises(FileExistsError):
+            self.camera.set_setting("recording", True)
+        self.assertFalse(self.camera.get_setting("recording"))
+
+
+def _buffer_item(nbytes, frame_number=None):
+    return (
+        None,
+        numpy.zeros((nbytes,), dtype=numpy.uint8),
+        0.0,
+        microscope.FrameMetadata(frame_number=frame_number),
+    )
+
+
+class TestDispatchBuffer(unittest.TestCase):
+    def setUp(self):
+        self.dropped = []
+
+    def make_buffer(self, **kwargs):
+        return microscope.abc._DispatchBuffer(
+            on_drop=self.dropped.append, **kwargs
+        )
+
+    def test_unbounded(self):
+        buffer = self.make_buffer()
+        for _ in range(100):
+            buffer.put(_buffer_item(1000))
+        self.assertEqual(buffer.qsize(), 100)
+        self.assertEqual(buffer.nbytes, 100 * 1000)
+
+    def test_drop_oldest_by_bytes(self):
+        buffer = self.make_buffer(
+            max_bytes=250, overflow_policy=microscope.DropPolicy.DROP_OLDEST
+        )
+        for i in range(3):
+            buffer.put(_buffer_item(100, frame_number=i))
+        self.assertEqual(buffer.qsize(), 2)
+        self.assertEqual([item[3].frame_number for item in self.dropped], [0])
+        metadata = [buffer.get_nowait()[3] for _ in range(2)]
+        self.assertEqual([m.frame_number for m in metadata], [1, 2])
+        self.assertEqual([m.dropped_frames for m in metadata], [1, None])
+
+    def test_drop_newest_by_length(self):
+        buffer = self.make_buffer(
+            max_length=2, overflow_policy=microscope.DropPolicy.DROP_NEWEST
+        )
+        for i in range(4):
+            buffer.put(_buffer_item(10, frame_number=i))
+        self.assertEqual(
+            [item[3].frame_number for item in self.dropped], [2, 3]
+        )
+        buffer.get_nowait()
+        buffer.get_nowait()
+        buffer.put(_buffer_item(10, frame_number=4))
+        self.assertEqual(buffer.get_nowait()[3].dropped_frames, 2)
+
+    def test_accept_large_item_if_empty(self):
+        buffer = self.make_buffer(
+            max_bytes=10, overflow_policy=microscope.DropPolicy.DROP_NEWEST
+        )
+        buffer.put(_buffer_item(100))
+        self.assertEqual(buffer.qsize(), 1)
+        self.assertEqual(self.dropped, [])
+
+    def test_block(self):
+        buffer = self.make_buffer(max_length=1)
+        buffer.put(_buffer_item(10, frame_number=0))
+        putter = threading.Thread(
+            target=buffer.put, args=(_buffer_item(10, frame_number=1),)
+        )
+        putter.start()
+        putter.join(0.1)
+        self.assertTrue(putter.is_alive())
+        self.assertEqual(buffer.get()[3].frame_number, 0)
+        putter.join(1.0)
+        self.assertFalse(putter.is_alive())
+        self.assertEqual(buffer.get()[3].frame_number, 1)
+        self.assertEqual(self.dropped, [])
+
+    def test_get_timeout(self):
+        buffer = self.make_buffer()
+        with self.assertRaises(queue.Empty):
+            buffer.get(timeout=0.01)
+
+    def test_data_device_reports_drops(self):
+        camera = SimulatedCamera(
+            buffer_max_bytes=150,
+            buffer_overflow_policy=microscope.DropPolicy.DROP_OLDEST,
+        )
+        camera.set_client(RecordingClient(3))
+        for _ in range(3):
+            camera._put(numpy.zeros((100,), dtype=numpy.uint8), 0.0)
+        samples = camera.get_metrics()["data_dropped_total"].samples
+        self.assertEqual(list(samples.values()), [2])
+        self.assertEqual(camera._dispatch_buffer.qsize(), 1)
+        camera.shutdown()
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -22,7 +22,9 @@ import multiprocessing
 import os
 import os.path
 import signal
+import sys
 import tempfile
+import threading
 import time
 import unittest
 import unittest.mock
@@ -51,6 +53,21 @@ class ExposePIDDevice(microscope.abc.Device):
         return os.getpid()
 
 
+class ExposePIDSettingDevice(ExposePIDDevice):
+    """Test device for testing the restore of settings on restart."""
+
+    def __init__(self, **kwargs) -> None:
+        super().__init__(**kwargs)
+        self._value = 0
+        self.add_setting(
+            "value",
+            "int",
+            lambda: self._value,
+            lambda value: setattr(self, "_value", value),
+            (0, 100),
+        )
+
+
 class DeviceServerExceptionQueue(microscope.device_server.DeviceServer):
     """`DeviceServer` that queues an exception during `run`.
 
@@ -236,6 +253,103 @@ class TestConfigLoader(unittest.TestCase):
         self._test_load_source("foobar")
 
 
+class TestCommandLine(unittest.TestCase):
+    def test_server_threading_options(self):
+        options = microscope.device_server._parse_cmd_line_args(
+            ["--server-type", "thread", "--threadpool-size", "8", "conf.py"]
+        )
+        self.assertEqual(options.server_type, "thread")
+        self.assertEqual(options.threadpool_size, 8)
+
+    def test_threading_defaults(self):
+        options = microscope.device_server._parse_cmd_line_args(["conf.py"])
+        self.assertEqual(options.server_type, "thread")
+        self.assertIsNone(options.threadpool_size)
+
+    def test_check_config(self):
+        options = microscope.device_server._parse_cmd_line_args(
+            ["--check-config", "conf.py"]
+        )
+        self.assertTrue(options.check_config)
+
+    def test_invalid_threadpool_size(self):
+        options = microscope.device_server.DeviceServerOptions(
+            config_fpath="", logging_level=logging.INFO, threadpool_size=0
+        )
+        with self.assertRaises(ValueError):
+            microscope.device_server._configure_server(options)
+
+
+class SlowDevice(ExposePIDDevice):
+    """Device with a method that blocks until released."""
+
+    def __init__(self, **kwargs) -> None:
+        super().__init__(**kwargs)
+        self.entered = threading.Event()
+        self.release = threading.Event()
+
+    def slow(self) -> None:
+        self.entered.set()
+        self.release.wait()
+
+    def nested(self) -> int:
+        return self.get_pid()
+
+
+class TestConcurrentCallsLimit(unittest.TestCase):
+    def setUp(self):
+        self.device = SlowDevice()
+        microscope.device_server._limit_concurrent_calls(
+            self.device, 1, ("get_is_enabled",)
+        )
+        self.slow_thread = threading.Thread(target=self.device.slow)
+        self.slow_thread.start()
+        self.assertTrue(self.device.entered.wait(timeout=5.0))
+
+    def tearDown(self):
+        self.device.release.set()
+        self.slow_thread.join()
+        self.device.shutdown()
+
+    def test_calls_wait_for_their_turn(self):
+        done = threading.Event()
+        thread = threading.Thread(
+            target=lambda: (self.device.get_pid(), done.set())
+        )
+        thread.start()
+        self.assertFalse(done.wait(timeout=0.2))
+        self.device.release.set()
+        self.assertTrue(done.wait(timeout=5.0))
+        thread.join()
+
+    def test_priority_methods_do_not_wait(self):
+        done = threading.Event()
+        thread = threading.Thread(
+            target=lambda: (self.device.get_is_enabled(), done.set())
+        )
+        thread.start()
+        self.assertTrue(done.wait(timeout=5.0))
+        thread.join()
+
+    def test_nested_calls_do_not_wait(self):
+        self.device.release.set()
+        self.slow_thread.join()
+        self.assertEqual(self.device.nested(), os.getpid())
+
+    def test_command_line(self):
+        options = microscope.device_server._parse_cmd_line_args(
+            [
+                "--max-concurrent-calls",
+                "2",
+                "--priority-method",
+                "get_position",
+                "conf.py",
+            ]
+        )
+        self.assertEqual(options.max_concurrent_calls, 2)
+        self.assertEqual(options.priority_methods, ("get_position",))
+
+
 class TestFloatingDeviceIndexInjection(BaseTestServeDevices):
     DEVICES = [
         microscope.device_server.device(
@@ -339,14 +453,240 @@ class TestKeepDeviceServerAlive(BaseTestServeDevices):
         with self.assertRaises(Pyro4.errors.ConnectionClosedError):
             device.get_pid()
 
-        # The device server checks every 5 seconds for a crashed
-        # device server so give it 6 seconds.
-        time.sleep(6)
+        # The device server is restarted as soon as the process
+        # dies, give it some time to construct the device.
+        time.sleep(2)
 
         device._pyroReconnect(tries=1)
         new_pid = device.get_pid()
         self.assertNotEqual(initial_pid, new_pid)
 
 
+class TestWarmRestart(BaseTestServeDevices):
+    DEVICES = [
+        microscope.device_server.device(
+            ExposePIDSettingDevice, "127.0.0.1", 8001, {}
+        ),
+    ]
+
+    @unittest.skipUnless(
+        hasattr(signal, "SIGKILL"),
+        "can't test if we can't kill subprocess (windows)",
+    )
+    def test_settings_restored(self):
+        device = Pyro4.Proxy("PYRO:ExposePIDSettingDevice@127.0.0.1:8001")
+        device.set_setting("value", 42)
+        # Give time for the change to reach the parent process.
+        time.sleep(1.5)
+        os.kill(device.get_pid(), signal.SIGKILL)
+        time.sleep(2)
+        device._pyroReconnect(tries=1)
+        self.assertEqual(device.get_setting("value"), 42)
+
+
+class TestRestoreSettings(unittest.TestCase):
+    def test_each_setting_restored(self):
+        device = unittest.mock.Mock()
+
+        def update_settings(settings):
+            if "bad" in settings:
+                raise ValueError("invalid value")
+
+        device.update_settings.side_effect = update_settings
+        with self.assertLogs("microscope.device_server", logging.WARNING):
+            microscope.device_server._restore_settings(
+                device,
+                {
+                    "bad": 1,
+                    "good": 2,
+                    "unread": None,
+                    "recording": True,
+                    "recording path": "data.raw",
+                },
+            )
+        device.update_settings.assert_has_calls(
+            [unittest.mock.call({"bad": 1}), unittest.mock.call({"good": 2})]
+        )
+        self.assertEqual(device.update_settings.call_count, 2)
+
+
+class TestDependencies(BaseTestServeDevices):
+    _first = microscope.device_server.device(
+        ExposePIDDevice, "127.0.0.1", 8001, {}
+    )
+    DEVICES = [
+        microscope.device_server.device(
+            ExposePIDSettingDevice, "127.0.0.1", 8002, {}, depends_on=[_first]
+        ),
+        _first,
+    ]
+
+    def test_dependency_started_first(self):
+        first = Pyro4.Proxy("PYRO:ExposePIDDevice@127.0.0.1:8001")
+        second = Pyro4.Proxy("PYRO:ExposePIDSettingDevice@127.0.0.1:8002")
+        # Both are served, on separate processes, even though the
+        # first definition waits for the second.
+        self.assertNotEqual(first.get_pid(), second.get_pid())
+
+
+class TestDeviceGroup(BaseTestServeDevices):
+    DEVICES = [
+        microscope.device_server.device(
+            ExposePIDDevice, "127.0.0.1", 8001, obj_id="first"
+        ),
+        microscope.device_server.device(
+            ExposePIDDevice, "127.0.0.1", 8001, obj_id="second"
+        ),
+        microscope.device_server.device(ExposePIDDevice, "127.0.0.1", 8002),
+    ]
+
+    def test_same_address_same_process(self):
+        first = Pyro4.Proxy("PYRO:first@127.0.0.1:8001")
+        second = Pyro4.Proxy("PYRO:second@127.0.0.1:8001")
+        other = Pyro4.Proxy("PYRO:ExposePIDDevice@127.0.0.1:8002")
+        self.assertEqual(first.get_pid(), second.get_pid())
+        self.assertNotEqual(first.get_pid(), other.get_pid())
+
+
+class TestDeviceByName(BaseTestServeDevices):
+    DEVICES = [
+        microscope.device_server.device(
+            __name__ + ".ExposePIDDevice", "127.0.0.1", 8001
+        ),
+    ]
+
+    def test_device_by_name(self):
+        device = Pyro4.Proxy("PYRO:ExposePIDDevice@127.0.0.1:8001")
+        self.assertNotEqual(device.get_pid(), os.getpid())
+
+
+class TestCheckDevices(unittest.TestCase):
+    def test_module_not_imported(self):
+        # No test imports the pvcam module, which needs PVCAM.
+        module_name = "microscope.cameras.pvcam"
+        definitions = [
+            microscope.device_server.device(
+                module_name + ".PVCamera", "127.0.0.1", 8001
+            ),
+        ]
+        microscope.device_server.check_devices(definitions)
+        self.assertNotIn(module_name, sys.modules)
+
+    def test_missing_module(self):
+        definitions = [
+            microscope.device_server.device(
+                "microscope.no_such_module.Device", "127.0.0.1", 8001
+            ),
+        ]
+        with self.assertRaises(ImportError):
+            microscope.device_server.check_devices(definitions)
+
+    def test_duplicated_pyro_id(self):
+        definitions = [
+            microscope.device_server.device(
+                __name__ + ".ExposePIDDevice", "127.0.0.1", 8001
+            ),
+            microscope.device_server.device(
+                ExposePIDDevice, "127.0.0.1", 8001
+            ),
+        ]
+        with self.assertRaisesRegex(ValueError, "ExposePIDDevice"):
+            microscope.device_server.check_devices(definitions)
+
+    def test_name_without_module(self):
+        with self.assertRaises(ValueError):
+            microscope.device_server.device("PVCamera", "127.0.0.1", 8001)
+
+    def test_floating_device_by_name_needs_uid(self):
+        definition = microscope.device_server.device(
+            "microscope.cameras.pvcam.PVCamera", "127.0.0.1", 8001, uid="1"
+        )
+        self.assertTrue(
+            microscope.device_server._is_floating_definition(definition)
+        )
+
+
+class TestGroupDefinitions(unittest.TestCase):
+    def test_duplicated_pyro_id(self):
+        definitions = [
+            microscope.device_server.device(
+                ExposePIDDevice, "127.0.0.1", 8001
+            ),
+            microscope.device_server.device(
+                ExposePIDDevice, "127.0.0.1", 8001
+            ),
+        ]
+        with self.assertRaisesRegex(ValueError, "ExposePIDDevice"):
+            microscope.device_server._construct_device_group(definitions)
+
+    def test_group_by_address(self):
+        first = microscope.device_server.device(
+            ExposePIDDevice, "127.0.0.1", 8001, obj_id="first"
+        )
+        second = microscope.device_server.device(
+            ExposePIDDevice, "127.0.0.1", 8001, obj_id="second"
+        )
+        other = microscope.device_server.device(
+            ExposePIDDevice, "127.0.0.1", 8002, depends_on=[first]
+        )
+        grouped = microscope.device_server._group_definitions(
+            [first, other, second]
+        )
+        self.assertEqual(len(grouped), 2)
+        self.assertEqual(grouped[0]["conf"]["definitions"], [first, second])
+        self.assertIs(grouped[1], other)
+        devices = microscope.device_server._construct_device_group(
+            **grouped[0]["conf"]
+        )
+        self.assertEqual(set(devices.keys()), {"first", "second"})
+
+    def test_shutdown_on_failure(self):
+        def fail_to_construct():
+            raise microscope.InitialiseError("no device")
+
+        definitions = [
+            microscope.device_server.device(
+                ExposePIDDevice, "127.0.0.1", 8001
+            ),
+            microscope.device_server.device(
+                fail_to_construct, "127.0.0.1", 8001
+            ),
+        ]
+        with unittest.mock.patch.object(
+            ExposePIDDevice,
+            "shutdown",
+            autospec=True,
+            side_effect=RuntimeError("failed shutdown"),
+        ) as shutdown, self.assertLogs(
+            "microscope.device_server", level="ERROR"
+        ) as logs:
+            with self.assertRaises(microscope.InitialiseError):
+                microscope.device_server._construct_device_group(definitions)
+        shutdown.assert_called_once()
+        self.assertIsNotNone(logs.records[0].exc_info)
+
+
+class TestCheckDependencies(unittest.TestCase):
+    def test_circular_dependency(self):
+        first = microscope.device_server.device(
+            ExposePIDDevice, "127.0.0.1", 8001
+        )
+        second = microscope.device_server.device(
+            ExposePIDDevice, "127.0.0.1", 8002, depends_on=[first]
+        )
+        first["depends_on"].append((second["host"], second["port"]))
+        with self.assertRaisesRegex(ValueError, "circular"):
+            microscope.device_server._check_dependencies([first, second])
+
+    def test_independent_devices(self):
+        first = microscope.device_server.device(
+            ExposePIDDevice, "127.0.0.1", 8001
+        )
+        second = microscope.device_server.device(
+            ExposePIDDevice, "127.0.0.1", 8002, depends_on=[first]
+        )
+        microscope.device_server._check_dependencies([first, second])
+
+
 if __name__ == "__main__":
     unittest.main()
@@ -266,6 +266,26 @@ class FilterWheelTests(DeviceTests):
         with self.assertRaisesRegex(Exception, "can't move to position"):
             self.device.position = self.device.n_positions
 
+    def test_set_position_without_waiting(self):
+        client = unittest.mock.Mock()
+        max_pos = self.device.n_positions - 1
+        self.device.set_position(max_pos, wait=False, client=client)
+        self.device.wait_for_move(timeout=5.0)
+        self.assertFalse(self.device.is_moving)
+        self.assertEqual(self.device.position, max_pos)
+        client.move_finished.assert_called_once_with(max_pos, None)
+
+    def test_set_position_waits_for_started_moves(self):
+        max_pos = self.device.n_positions - 1
+        self.device.set_position(max_pos, wait=False)
+        self.device.set_position(0)
+        self.assertFalse(self.device.is_moving)
+        self.assertEqual(self.device.position, 0)
+
+    def test_set_position_without_waiting_above_limit(self):
+        with self.assertRaisesRegex(Exception, "can't move to position"):
+            self.device.set_position(self.device.n_positions, wait=False)
+
 
 class DeformableMirrorTests(DeviceTests):
     """Collection of test cases for deformable mirrors.
@@ -308,6 +328,51 @@ class DeformableMirrorTests(DeviceTests):
             self.device.next_pattern()
             self.assertCurrentPattern(patterns[i])
 
+    def test_queue_sequence(self):
+        patterns = numpy.random.rand(3, self.planned_n_actuators)
+        self.device.queue_sequence(list(patterns))
+        for pattern in patterns:
+            self.device.trigger()
+            self.assertCurrentPattern(pattern)
+
+    def test_queue_sequence_repeat(self):
+        patterns = numpy.random.rand(2, self.planned_n_actuators)
+        self.device.queue_sequence(list(patterns), repeat=True)
+        for i in range(5):
+            self.device.trigger()
+            self.assertCurrentPattern(patterns[i % 2])
+
+    def test_cached_patterns(self):
+        patterns = numpy.random.rand(3, self.planned_n_actuators)
+        self.device.upload_patterns("basis", patterns)
+        self.assertEqual(self.device.get_pattern_names(), ["basis"])
+        self.device.apply_cached_pattern("basis", 2)
+        self.assertCurrentPattern(patterns[2])
+        self.device.queue_cached_patterns("basis")
+        for pattern in patterns:
+            self.device.trigger()
+            self.assertCurrentPattern(pattern)
+
+    def test_cached_patterns_are_copied(self):
+        patterns = numpy.random.rand(2, self.planned_n_actuators)
+        self.device.upload_patterns("basis", patterns)
+        expected = patterns[0].copy()
+        patterns[:] = 0.0
+        self.device.apply_cached_pattern("basis", 0)
+        self.assertCurrentPattern(expected)
+
+    def test_upload_invalid_patterns(self):
+        patterns = numpy.zeros((2, self.planned_n_actuators + 1))
+        with self.assertRaisesRegex(Exception, "length of second dimension"):
+            self.device.upload_patterns("basis", patterns)
+
+    def test_remove_cached_patterns(self):
+        patterns = numpy.random.rand(2, self.planned_n_actuators)
+        self.device.upload_patterns("basis", patterns)
+        self.device.remove_patterns("basis")
+        with self.assertRaises(ValueError):
+            self.device.apply_cached_pattern("basis")
+
     def test_validate_pattern_too_long(self):
         patterns = numpy.zeros((self.planned_n_actuators + 1))
         with self.assertRaisesRegex(Exception, "length of second dimension"):
@@ -326,6 +391,55 @@ class DeformableMirrorTests(DeviceTests):
             self.device.apply_pattern(patterns)
 
 
+class StageTests(DeviceTests):
+    """Tests for stages with axes "x" and "y"."""
+
+    def test_move_to_multiple_axes(self):
+        self.device.move_to({"x": 10.0, "y": 20.0})
+        self.assertEqual(self.device.position, {"x": 10.0, "y": 20.0})
+
+    def test_move_by_multiple_axes(self):
+        self.device.move_to({"x": 10.0, "y": 20.0})
+        self.device.move_by({"x": 5.0, "y": -5.0})
+        self.assertEqual(self.device.position, {"x": 15.0, "y": 15.0})
+
+    def test_start_move_and_notify(self):
+        client = unittest.mock.Mock()
+        self.device.start_move_to({"x": 30.0}, client)
+        self.device.wait_for_move(timeout=5.0)
+        self.assertEqual(self.device.position["x"], 30.0)
+        self.assertFalse(self.device.is_moving)
+        client.move_finished.assert_called_once_with(
+            self.device.position, None
+        )
+
+    def test_move_after_started_moves(self):
+        self.device.start_move_to({"x": 30.0})
+        self.device.move_to({"x": 10.0})
+        self.assertFalse(self.device.is_moving)
+        self.assertEqual(self.device.position["x"], 10.0)
+        self.device.start_move_to({"y": 30.0})
+        self.device.axes["y"].move_to(5.0)
+        self.assertFalse(self.device.is_moving)
+        self.assertEqual(self.device.position["y"], 5.0)
+
+    def test_start_move_with_unknown_axis(self):
+        with self.assertRaises(ValueError):
+            self.device.start_move_to({"foo": 1.0})
+
+    def test_queued_positions(self):
+        positions = [{"x": 1.0, "y": 2.0}, {"x": 3.0}, {"y": 4.0}]
+        self.device.queue_positions(positions)
+        expected = [{"x": 1.0, "y": 2.0}, {"x": 3.0, "y": 2.0}]
+        expected.append({"x": 3.0, "y": 4.0})
+        for remaining, position in zip([2, 1, 0], expected):
+            self.assertEqual(self.device.move_to_next_position(), remaining)
+            self.device.wait_for_move(timeout=5.0)
+            self.assertEqual(self.device.position, position)
+        with self.assertRaises(microscope.DeviceError):
+            self.device.move_to_next_position()
+
+
 class SLMTests(DeviceTests):
     pass
 
@@ -349,6 +463,38 @@ class TestDummyLightSource(unittest.TestCase, LightSourceTests):
         # fake.  We need to rethink how the mock lasers work.
         pass
 
+    def test_power_sequence(self):
+        self.device.enable()
+        self.device.queue_sequence([0.1, 0.5, 0.9])
+        for power in [0.1, 0.5, 0.9]:
+            self.device.trigger()
+            self.assertEqual(self.device.power, power)
+        # After the sequence, trigger has its usual effect.
+        with self.assertRaises(microscope.IncompatibleStateError):
+            self.device.trigger()
+
+    def test_power_sequence_on_device(self):
+        self.device.enable()
+        self.device.queue_sequence([0.1, 0.5], repeat=True)
+        # The simulated device keeps the sequence itself, the software
+        # fallback is not used.
+        self.assertIsNone(self.device._trigger_sequence)
+        for power in [0.1, 0.5, 0.1]:
+            self.device.trigger()
+            self.assertEqual(self.device.power, power)
+
+    def test_power_sequence_clipped(self):
+        self.device.enable()
+        self.device.queue_sequence([1.5])
+        self.device.trigger()
+        self.assertEqual(self.device.power, 1.0)
+
+    def test_clear_sequence(self):
+        self.device.queue_sequence([0.1, 0.5], repeat=True)
+        self.device.clear_sequence()
+        with self.assertRaises(microscope.IncompatibleStateError):
+            self.device.trigger()
+
 
 class TestCoherentSapphireLaser(
     unittest.TestCase, LightSourceTests, SerialDeviceTests
@@ -420,6 +566,24 @@ class TestDummyCamera(unittest.TestCase, CameraTests):
     def setUp(self):
         self.device = simulators.SimulatedCamera()
 
+    def test_sequence_not_supported(self):
+        with self.assertRaises(microscope.UnsupportedFeatureError):
+            self.device.queue_sequence([1, 2])
+
+    def test_sequence_step_before_trigger(self):
+        calls = []
+        with unittest.mock.patch.object(
+            simulators.SimulatedCamera,
+            "_apply_sequence_step",
+            lambda self, step: calls.append(step),
+        ), unittest.mock.patch.object(
+            self.device, "_do_trigger", lambda: calls.append("trigger")
+        ):
+            self.device.queue_sequence([1, 2])
+            for _ in range(3):
+                self.device.trigger()
+        self.assertEqual(calls, [1, "trigger", 2, "trigger", "trigger"])
+
 
 class TestImageGenerator(unittest.TestCase):
     def test_non_square_patterns_shape(self):
@@ -491,6 +655,16 @@ class TestDummyDeformableMirror(unittest.TestCase, DeformableMirrorTests):
         self.fake = self.device
 
 
+class TestSimulatedStage(unittest.TestCase, StageTests):
+    def setUp(self):
+        self.device = simulators.SimulatedStage(
+            {
+                "x": microscope.AxisLimits(-100, 100),
+                "y": microscope.AxisLimits(-100, 100),
+            }
+        )
+
+
 class TestDummySLM(unittest.TestCase, SLMTests):
     def setUp(self):
         self.device = dummies.DummySLM()
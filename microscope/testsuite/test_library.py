@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+
+## Copyright (C) 2020 David Miguel Susano Pinto <carandraug@gmail.com>
+##
+## This file is part of Microscope.
+##
+## Microscope is free software: you can redistribute it and/or modify
+## it under the terms of the GNU General Public License as published by
+## the Free Software Foundation, either version 3 of the License, or
+## (at your option) any later version.
+##
+## Microscope is distributed in the hope that it will be useful,
+## but WITHOUT ANY WARRANTY; without even the implied warranty of
+## MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+## GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License
+## along with Microscope.  If not, see <http://www.gnu.org/licenses/>.
+
+import unittest
+import unittest.mock
+
+import microscope
+import microscope._library
+
+
+class TestLazyLibrary(unittest.TestCase):
+    def test_load_on_first_use(self):
+        lib = unittest.mock.Mock()
+        loader = unittest.mock.Mock(return_value=lib)
+        on_load = unittest.mock.Mock()
+        lazy = microscope._library.LazyLibrary(loader, on_load=on_load)
+        self.assertFalse(lazy.is_loaded)
+        loader.assert_not_called()
+        lazy.some_function(1)
+        lazy.other_function()
+        self.assertTrue(lazy.is_loaded)
+        loader.assert_called_once_with()
+        on_load.assert_called_once_with(lib)
+        lib.some_function.assert_called_once_with(1)
+
+    def test_failure_to_load(self):
+        loader = unittest.mock.Mock(side_effect=OSError("no such library"))
+        lazy = microscope._library.LazyLibrary(loader)
+        with self.assertRaises(microscope.LibraryLoadError):
+            lazy.some_function()
+        # It tries again on the next use.
+        with self.assertRaises(microscope.LibraryLoadError):
+            lazy.some_function()
+        self.assertEqual(loader.call_count, 2)
+        self.assertFalse(lazy.is_loaded)
+
+
+if __name__ == "__main__":
+    unittest.main()
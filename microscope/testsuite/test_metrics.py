@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+
+## Copyright (C) 2020 David Miguel Susano Pinto <carandraug@gmail.com>
+##
+## This file is part of Microscope.
+##
+## Microscope is free software: you can redistribute it and/or modify
+## it under the terms of the GNU General Public License as published by
+## the Free Software Foundation, either version 3 of the License, or
+## (at your option) any later version.
+##
+## Microscope is distributed in the hope that it will be useful,
+## but WITHOUT ANY WARRANTY; without even the implied warranty of
+## MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+## GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License
+## along with Microscope.  If not, see <http://www.gnu.org/licenses/>.
+
+import queue
+import time
+import unittest
+
+import numpy
+
+import microscope
+import microscope._metrics
+from microscope.simulators import SimulatedCamera
+
+
+class TestMetrics(unittest.TestCase):
+    def setUp(self):
+        self.metrics = microscope._metrics.Metrics()
+
+    def test_counter(self):
+        counter = self.metrics.counter("things_total", "Things.")
+        counter.inc()
+        counter.inc(2)
+        self.assertEqual(
+            self.metrics.snapshot()["things_total"].samples, {(): 3}
+        )
+
+    def test_histogram_buckets(self):
+        histogram = self.metrics.histogram(
+            "time_seconds", "Time.", buckets=(0.1, 1.0)
+        )
+        for value in (0.05, 0.1, 0.5, 2.0, 3.0):
+            histogram.observe(value)
+        sample = self.metrics.snapshot()["time_seconds"].samples[()]
+        self.assertEqual(sample.counts, (2, 1, 2))
+        self.assertEqual(sample.count, 5)
+        self.assertAlmostEqual(sample.sum, 5.65)
+
+    def test_labels(self):
+        family = self.metrics.counter(
+            "sent_total", "Sent.", labelnames=("client",)
+        )
+        family.labels("a").inc()
+        family.labels("b").inc(4)
+        family.labels("a").inc()
+        self.assertEqual(
+            self.metrics.snapshot()["sent_total"].samples,
+            {("a",): 2, ("b",): 4},
+        )
+
+    def test_wrong_number_of_labels(self):
+        family = self.metrics.counter(
+            "sent_total", "Sent.", labelnames=("client",)
+        )
+        with self.assertRaises(ValueError):
+            family.labels("a", "b")
+
+    def test_duplicated_name(self):
+        self.metrics.gauge("depth", "Depth.")
+        with self.assertRaises(ValueError):
+            self.metrics.gauge("depth", "Depth again.")
+
+    def test_format_prometheus(self):
+        self.metrics.gauge("depth", "Depth.").set(3)
+        self.metrics.histogram(
+            "time_seconds", "Time.", buckets=(0.1, 1.0)
+        ).observe(0.5)
+        text = microscope._metrics.format_prometheus(
+            {"cam": self.metrics.snapshot()}
+        )
+        lines = text.splitlines()
+        self.assertIn("# TYPE microscope_depth gauge", lines)
+        self.assertIn('microscope_depth{device="cam"} 3.0', lines)
+        self.assertIn("# TYPE microscope_time_seconds histogram", lines)
+        # Buckets are cumulative.
+        self.assertIn(
+            'microscope_time_seconds_bucket{device="cam",le="0.1"} 0', lines
+        )
+        self.assertIn(
+            'microscope_time_seconds_bucket{device="cam",le="1.0"} 1', lines
+        )
+        self.assertIn(
+            'microscope_time_seconds_bucket{device="cam",le="+Inf"} 1', lines
+        )
+        self.assertIn('microscope_time_seconds_count{device="cam"} 1', lines)
+
+
+class TestDeviceMetrics(unittest.TestCase):
+    def setUp(self):
+        self.camera = SimulatedCamera()
+
+    def tearDown(self):
+        self.camera.shutdown()
+
+    def setting_calls(self, method):
+        samples = self.camera.get_metrics()["setting_call_seconds"].samples
+        return samples[(method,)].count if (method,) in samples else 0
+
+    def test_setting_calls(self):
+        self.camera.get_setting("gain")
+        self.camera.set_setting("gain", 2)
+        self.assertEqual(self.setting_calls("get_setting"), 1)
+        self.assertEqual(self.setting_calls("set_setting"), 1)
+
+    def test_nested_setting_calls_not_counted(self):
+        self.camera.update_settings({"gain": 3})
+        self.assertEqual(self.setting_calls("update_settings"), 1)
+        self.assertEqual(self.setting_calls("get_setting"), 0)
+        self.assertEqual(self.setting_calls("set_setting"), 0)
+
+    def test_put_updates_metrics(self):
+        self.camera._put(numpy.zeros((4, 4)), 0.0)
+        self.camera._put(
+            numpy.zeros((4, 4)), 0.0, microscope.FrameMetadata(frame_number=0)
+        )
+        self.camera._put(
+            numpy.zeros((4, 4)), 0.0, microscope.FrameMetadata(frame_number=3)
+        )
+        self.camera._put(Exception("failed to fetch"), 0.0)
+        metrics = self.camera.get_metrics()
+        self.assertEqual(metrics["data_fetched_total"].samples[()], 3)
+        self.assertEqual(metrics["fetch_errors_total"].samples[()], 1)
+        self.assertEqual(
+            metrics["device_dropped_frames_total"].samples[()], 2
+        )
+        self.assertEqual(metrics["dispatch_buffer_depth"].samples[()], 4)
+
+    def test_client_metrics_removed_with_client(self):
+        client = queue.Queue()
+        self.camera.set_client(
+            client, drop_policy=microscope.DropPolicy.BLOCK
+        )
+        self.camera._put(numpy.zeros((4, 4)), 0.0)
+        client.get(timeout=5.0)
+        # The subscriber thread counts the data after sending it.
+        deadline = time.monotonic() + 5.0
+        while ("Queue",) not in self.sent_samples():
+            self.assertLess(time.monotonic(), deadline)
+            time.sleep(0.01)
+        self.camera.remove_client(client)
+        self.assertNotIn(("Queue",), self.sent_samples())
+
+    def sent_samples(self):
+        return self.camera.get_metrics()["data_sent_total"].samples
+
+
+if __name__ == "__main__":
+    unittest.main()
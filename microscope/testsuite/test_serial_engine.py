@@ -0,0 +1,239 @@
+#!/usr/bin/env python3
+
+## Copyright (C) 2020 David Miguel Susano Pinto <carandraug@gmail.com>
+##
+## This file is part of Microscope.
+##
+## Microscope is free software: you can redistribute it and/or modify
+## it under the terms of the GNU General Public License as published by
+## the Free Software Foundation, either version 3 of the License, or
+## (at your option) any later version.
+##
+## Microscope is distributed in the hope that it will be useful,
+## but WITHOUT ANY WARRANTY; without even the implied warranty of
+## MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+## GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License
+## along with Microscope.  If not, see <http://www.gnu.org/licenses/>.
+
+import queue
+import threading
+import time
+import unittest
+
+import microscope
+import microscope._utils
+import microscope.controllers.lumencor
+import microscope.controllers.zaber
+
+
+class FakeSerial:
+    """Serial port that replies to commands once they are released.
+
+    Each command `b"GET x\\n"` gets the reply `b"A x\\r\\n"`.  Replies
+    are held until `release` is called, to check how many commands
+    are written before a reply is read.
+    """
+
+    def __init__(self, reverse: bool = False) -> None:
+        self.timeout = 0.05
+        self.written = []
+        self._held = []
+        self._replies: queue.Queue = queue.Queue()
+        self._reverse = reverse
+        self._lock = threading.Lock()
+
+    def write(self, data: bytes) -> int:
+        with self._lock:
+            self.written.append(data)
+            self._held.append(b"A " + data.split()[1] + b"\r\n")
+        return len(data)
+
+    def release(self) -> None:
+        with self._lock:
+            held, self._held = self._held, []
+        for reply in reversed(held) if self._reverse else held:
+            self._replies.put(reply)
+
+    def inject(self, line: bytes) -> None:
+        self._replies.put(line)
+
+    def readline(self) -> bytes:
+        try:
+            return self._replies.get(timeout=self.timeout)
+        except queue.Empty:
+            return b""
+
+
+def wait_for_writes(serial: FakeSerial, n: int) -> None:
+    deadline = time.monotonic() + 1.0
+    while len(serial.written) < n and time.monotonic() < deadline:
+        time.sleep(0.01)
+
+
+class TestSerialEngine(unittest.TestCase):
+    def make_engine(self, serial, **kwargs):
+        engine = microscope._utils.SerialEngine(serial, **kwargs)
+        self.addCleanup(engine.close)
+        return engine
+
+    def test_command(self):
+        serial = FakeSerial()
+        engine = self.make_engine(serial)
+        future = engine.submit(b"GET a\n")
+        wait_for_writes(serial, 1)
+        serial.release()
+        self.assertEqual(future.result(timeout=1.0), b"A a\r\n")
+
+    def test_pipeline(self):
+        serial = FakeSerial()
+        engine = self.make_engine(serial, max_in_flight=3)
+        futures = [engine.submit(b"GET %d\n" % i) for i in range(4)]
+        wait_for_writes(serial, 4)
+        # The fourth command waits for a reply.
+        self.assertEqual(len(serial.written), 3)
+        serial.release()
+        wait_for_writes(serial, 4)
+        serial.release()
+        self.assertEqual(
+            [f.result(timeout=1.0) for f in futures],
+            [b"A %d\r\n" % i for i in range(4)],
+        )
+
+    def test_no_pipeline_by_default(self):
+        serial = FakeSerial()
+        engine = self.make_engine(serial)
+        futures = [engine.submit(b"GET %d\n" % i) for i in range(2)]
+        wait_for_writes(serial, 2)
+        self.assertEqual(len(serial.written), 1)
+        serial.release()
+        wait_for_writes(serial, 2)
+        serial.release()
+        for future in futures:
+            future.result(timeout=1.0)
+
+    def test_match_out_of_order_replies(self):
+        serial = FakeSerial(reverse=True)
+        engine = self.make_engine(serial, max_in_flight=3)
+        futures = [
+            engine.submit(
+                b"GET %d\n" % i,
+                matcher=lambda line, i=i: line == b"A %d\r\n" % i,
+            )
+            for i in range(3)
+        ]
+        wait_for_writes(serial, 3)
+        serial.release()
+        self.assertEqual(
+            [f.result(timeout=1.0) for f in futures],
+            [b"A %d\r\n" % i for i in range(3)],
+        )
+
+    def test_unexpected_lines_are_discarded(self):
+        serial = FakeSerial()
+        engine = self.make_engine(serial)
+        future = engine.submit(b"GET a\n", matcher=lambda l: l[:1] == b"A")
+        wait_for_writes(serial, 1)
+        serial.inject(b"! alert\r\n")
+        serial.release()
+        self.assertEqual(future.result(timeout=1.0), b"A a\r\n")
+
+    def test_timeout(self):
+        serial = FakeSerial()
+        engine = self.make_engine(serial)
+        future = engine.submit(b"GET a\n", timeout=0.1)
+        with self.assertRaisesRegex(microscope.DeviceError, "no reply"):
+            future.result(timeout=1.0)
+        # The command that timed out no longer blocks others.  The
+        # late reply to the first command would be taken by the next
+        # command without a matcher.
+        second = engine.submit(b"GET b\n", matcher=lambda l: l[2:3] == b"b")
+        wait_for_writes(serial, 2)
+        serial.release()
+        self.assertEqual(second.result(timeout=1.0), b"A b\r\n")
+
+    def test_close_fails_pending(self):
+        serial = FakeSerial()
+        engine = microscope._utils.SerialEngine(serial)
+        future = engine.submit(b"GET a\n")
+        engine.close()
+        with self.assertRaises(microscope.DeviceError):
+            future.result(timeout=1.0)
+        with self.assertRaises(microscope.DeviceError):
+            engine.submit(b"GET b\n")
+
+    def test_requires_read_timeout(self):
+        serial = FakeSerial()
+        serial.timeout = None
+        with self.assertRaises(ValueError):
+            microscope._utils.SerialEngine(serial)
+
+
+
+class TestZaberReply(unittest.TestCase):
+    def parse(self, line):
+        return microscope.controllers.zaber._ZaberReply(line)
+
+    def test_with_message_id(self):
+        reply = self.parse(b"@01 1 12 OK IDLE -- 1000\r\n")
+        self.assertEqual(reply.address, b"01")
+        self.assertEqual(reply.message_id, b"12")
+        self.assertEqual(reply.flag, b"OK")
+        self.assertEqual(reply.status, b"IDLE")
+        self.assertEqual(reply.warning, b"--")
+        self.assertEqual(reply.response, b"1000")
+
+    def test_without_message_id(self):
+        reply = self.parse(b"@02 0 OK BUSY WR 0\r\n")
+        self.assertEqual(reply.address, b"02")
+        self.assertEqual(reply.message_id, b"")
+        self.assertEqual(reply.flag, b"OK")
+        self.assertEqual(reply.status, b"BUSY")
+        self.assertEqual(reply.warning, b"WR")
+        self.assertEqual(reply.response, b"0")
+
+    def test_rejected(self):
+        for line in (
+            b"@01 0 7 RJ IDLE -- BADCOMMAND\r\n",
+            b"@01 0 RJ IDLE -- BADCOMMAND\r\n",
+        ):
+            reply = self.parse(line)
+            self.assertEqual(reply.flag, b"RJ")
+            self.assertEqual(reply.response, b"BADCOMMAND")
+
+    def test_response_with_spaces(self):
+        reply = self.parse(b"@01 0 3 OK IDLE -- 2048 4096\r\n")
+        self.assertEqual(reply.message_id, b"3")
+        self.assertEqual(reply.response, b"2048 4096")
+        reply = self.parse(b"@01 0 OK IDLE -- 2048 4096\r\n")
+        self.assertEqual(reply.message_id, b"")
+        self.assertEqual(reply.response, b"2048 4096")
+
+    def test_without_response(self):
+        reply = self.parse(b"@01 0 5 OK IDLE --\r\n")
+        self.assertEqual(reply.message_id, b"5")
+        self.assertEqual(reply.warning, b"--")
+        self.assertEqual(reply.response, b"")
+
+    def test_invalid(self):
+        for line in (b"", b"#01 0 OK IDLE --\r\n", b"@01 0 OK\r\n"):
+            with self.assertRaises(ValueError):
+                self.parse(line)
+
+
+class TestLumencorAnswerMatcher(unittest.TestCase):
+    def is_answer(self, line, *tokens):
+        return microscope.controllers.lumencor._is_answer_to(line, tokens)
+
+    def test_answer_echoes_command(self):
+        self.assertTrue(self.is_answer(b"A CHACT 1\r\n", b"GET", b"CHACT"))
+        self.assertFalse(self.is_answer(b"A CH 1\r\n", b"GET", b"CHACT"))
+        self.assertFalse(self.is_answer(b"\r\n", b"GET", b"CHACT"))
+
+    def test_errors_in_order(self):
+        self.assertTrue(self.is_answer(b"E UNKNOWNCMD\r\n", b"GET", b"X"))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+
+## Copyright (C) 2020 David Miguel Susano Pinto <carandraug@gmail.com>
+##
+## This file is part of Microscope.
+##
+## Microscope is free software: you can redistribute it and/or modify
+## it under the terms of the GNU General Public License as published by
+## the Free Software Foundation, either version 3 of the License, or
+## (at your option) any later version.
+##
+## Microscope is distributed in the hope that it will be useful,
+## but WITHOUT ANY WARRANTY; without even the implied warranty of
+## MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+## GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License
+## along with Microscope.  If not, see <http://www.gnu.org/licenses/>.
+
+import importlib.util
+import os
+import pickle
+import unittest
+
+import numpy
+import Pyro4
+import Pyro4.util
+
+import microscope
+import microscope._recorder
+import microscope._serializer
+import microscope._shared_memory
+import microscope.clients
+import microscope.simulators
+
+
+class EvilReduce:
+    def __reduce__(self):
+        return (os.system, ("true",))
+
+
+@unittest.skipUnless(
+    microscope._serializer.is_available(), "requires pickle protocol 5"
+)
+class TestPickle5Serializer(unittest.TestCase):
+    def roundtrip(self, data):
+        return microscope._serializer.loads(microscope._serializer.dumps(data))
+
+    def test_array(self):
+        data = numpy.arange(512 * 512, dtype=numpy.uint16).reshape(512, 512)
+        received = self.roundtrip(data)
+        numpy.testing.assert_array_equal(received, data)
+        self.assertEqual(received.dtype, data.dtype)
+
+    def test_array_is_out_of_band(self):
+        data = numpy.zeros((1024, 1024), dtype=numpy.uint8)
+        message = microscope._serializer.dumps(data)
+        # The pickle stream is small, the data goes in a buffer.
+        header = microscope._serializer._HEADER.unpack_from(message)
+        self.assertEqual(header[1], 1)
+        self.assertLess(header[2], 1024)
+        self.assertFalse(self.roundtrip(data).flags.writeable)
+
+    def test_non_contiguous_array(self):
+        data = numpy.arange(100).reshape(10, 10)[::2, ::-1]
+        numpy.testing.assert_array_equal(self.roundtrip(data), data)
+
+    def test_call_arguments(self):
+        data = numpy.ones((4, 4))
+        metadata = microscope.FrameMetadata(timestamp=1.0, frame_number=2)
+        obj, method, vargs, kwargs = self.roundtrip(
+            ("obj", "receiveData", (data, 1.0, metadata), {})
+        )
+        self.assertEqual(method, "receiveData")
+        numpy.testing.assert_array_equal(vargs[0], data)
+        self.assertEqual(vargs[2], metadata)
+
+    def test_microscope_types(self):
+        data = [
+            microscope.ROI(1, 2, 3, 4),
+            microscope.TriggerType.SOFTWARE,
+            microscope.DeviceError("failed"),
+            {"a": 1.5, "b": (None, True)},
+        ]
+        received = self.roundtrip(data)
+        self.assertEqual(received[:2], data[:2])
+        self.assertIsInstance(received[2], microscope.DeviceError)
+        self.assertEqual(received[3], data[3])
+
+    def test_refuse_unsafe_globals(self):
+        # Pickle with the standard pickle and frame it the same way.
+        stream = pickle.dumps(EvilReduce(), protocol=5)
+        message = (
+            microscope._serializer._HEADER.pack(
+                microscope._serializer._MAGIC, 0, len(stream)
+            )
+            + stream
+        )
+        with self.assertRaisesRegex(pickle.UnpicklingError, "not allowed"):
+            microscope._serializer.loads(message)
+
+    def test_refuse_microscope_classes(self):
+        # Only data types are allowed, not classes that do something
+        # when constructed, such as devices and recorders.
+        for cls in (
+            microscope._recorder.RawRecorder,
+            microscope._shared_memory.SharedMemoryRing,
+            microscope.simulators.SimulatedCamera,
+            Pyro4.Daemon,
+        ):
+            message = microscope._serializer.dumps(cls)
+            with self.assertRaisesRegex(
+                pickle.UnpicklingError, "not allowed"
+            ):
+                microscope._serializer.loads(message)
+
+    def test_allow_class(self):
+        message = microscope._serializer.dumps(EvilReduce)
+        with self.assertRaises(pickle.UnpicklingError):
+            microscope._serializer.loads(message)
+        microscope._serializer.allow_class(EvilReduce)
+        try:
+            self.assertIs(microscope._serializer.loads(message), EvilReduce)
+        finally:
+            microscope._serializer._SAFE_CLASSES.discard(
+                (EvilReduce.__module__, EvilReduce.__qualname__)
+            )
+
+    @unittest.skipUnless(
+        importlib.util.find_spec("lz4"), "requires the lz4 package"
+    )
+    def test_lz4_compression(self):
+        data = numpy.zeros((512, 512), dtype=numpy.uint16)
+        microscope._serializer.configure(compression="lz4")
+        try:
+            message = microscope._serializer.dumps(data)
+            received = microscope._serializer.loads(message)
+        finally:
+            microscope._serializer.configure(compression=None)
+        self.assertLess(len(message), data.nbytes)
+        numpy.testing.assert_array_equal(received, data)
+
+    def test_unknown_compression(self):
+        with self.assertRaises(ValueError):
+            microscope._serializer.configure(compression="gzip")
+
+    def test_clients_accept_pickle5(self):
+        # A DataClient receives the data from a device server that
+        # may be configured to send it with pickle5.
+        self.assertIn(
+            microscope._serializer.NAME, Pyro4.config.SERIALIZERS_ACCEPTED
+        )
+        self.assertIsInstance(
+            Pyro4.util.get_serializer(microscope._serializer.NAME),
+            microscope._serializer.Pickle5Serializer,
+        )
+
+
+if __name__ == "__main__":
+    unittest.main()
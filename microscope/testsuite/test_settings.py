@@ -21,6 +21,7 @@
 """
 
 import enum
+import time
 import unittest
 
 import microscope.abc
@@ -77,5 +78,254 @@ class TestEnumSetting(unittest.TestCase):
         self.assertEqual(EnumSetting(2), thing.val)
 
 
+class DeviceWithDependentSettings(microscope.abc.Device):
+    """Device where the exposure range depends on the readout mode."""
+
+    def __init__(self):
+        super().__init__()
+        self.mode = 0
+        self.exposure = 0.1
+        self.set_order = []
+        self.add_setting(
+            "mode", "enum", lambda: self.mode, self._set_mode, ["fast", "slow"]
+        )
+        self.add_setting(
+            "exposure",
+            "float",
+            lambda: self.exposure,
+            self._set_exposure,
+            lambda: (0.0, 1.0) if self.mode == 0 else (0.0, 10.0),
+        )
+        self.add_setting("status", "str", lambda: "ok", None, 10)
+
+    def _set_mode(self, value):
+        self.set_order.append("mode")
+        self.mode = value
+
+    def _set_exposure(self, value):
+        self.set_order.append("exposure")
+        self.exposure = value
+
+    def _do_shutdown(self) -> None:
+        pass
+
+
+class TestUpdateSettings(unittest.TestCase):
+    def setUp(self):
+        self.device = DeviceWithDependentSettings()
+
+    def test_set_in_order(self):
+        results = self.device.update_settings({"mode": 1, "exposure": 5.0})
+        self.assertEqual(self.device.set_order, ["mode", "exposure"])
+        self.assertEqual(results, {"mode": 1, "exposure": 5.0})
+
+    def test_validate_with_current_values(self):
+        with self.assertRaisesRegex(ValueError, "exposure"):
+            self.device.update_settings({"exposure": 5.0, "mode": 1})
+        self.assertEqual(self.device.set_order, [])
+
+    def test_stop_on_first_invalid_value(self):
+        with self.assertRaises(ValueError):
+            self.device.update_settings({"exposure": 0.7, "mode": 3})
+        self.assertEqual(self.device.set_order, ["exposure"])
+        self.assertEqual(self.device.mode, 0)
+
+    def test_only_changed_settings(self):
+        self.device.update_settings({"mode": 0, "exposure": 0.2})
+        self.assertEqual(self.device.set_order, ["exposure"])
+
+    def test_unknown_and_readonly_settings(self):
+        results = self.device.update_settings(
+            {"foo": 1, "status": "bad", "mode": 1}
+        )
+        self.assertIs(results["foo"], NotImplemented)
+        self.assertEqual(results["status"], "ok")
+        self.assertEqual(results["mode"], 1)
+
+    def test_init_requires_all_settings(self):
+        with self.assertRaises(Exception):
+            self.device.update_settings({"mode": 1}, init=True)
+        self.assertEqual(self.device.set_order, [])
+
+    def test_init_sets_all(self):
+        self.device.update_settings(
+            {"mode": 0, "exposure": 0.1, "status": "ok"}, init=True
+        )
+        self.assertEqual(self.device.set_order, ["mode", "exposure"])
+
+
+class DeviceWithCountedReads(microscope.abc.Device):
+    """Device that counts the reads of each setting from the hardware."""
+
+    def __init__(self):
+        super().__init__()
+        self.values = {"power": 1.0, "temperature": 20.0, "mode": 0}
+        self.reads = {name: 0 for name in self.values}
+        self.add_setting(
+            "power",
+            "float",
+            lambda: self._read("power"),
+            lambda v: self.values.update(power=v),
+            (0.0, 10.0),
+        )
+        self.add_setting(
+            "temperature",
+            "float",
+            lambda: self._read("temperature"),
+            None,
+            (0.0, 100.0),
+        )
+        self.add_setting(
+            "mode",
+            "enum",
+            lambda: self._read("mode"),
+            lambda v: self.values.update(mode=v),
+            ["cw", "pulsed"],
+            ttl=0.0,
+        )
+
+    def _read(self, name):
+        self.reads[name] += 1
+        return self.values[name]
+
+    def _do_shutdown(self) -> None:
+        pass
+
+
+class SettingsListener:
+    def __init__(self):
+        self.changes = []
+
+    def settings_changed(self, changes):
+        self.changes.append(changes)
+
+
+class TestSettingsCache(unittest.TestCase):
+    def setUp(self):
+        self.device = DeviceWithCountedReads()
+
+    def test_all_settings_from_cache(self):
+        self.device.get_all_settings()
+        self.device.get_all_settings()
+        self.assertEqual(self.device.reads["power"], 1)
+
+    def test_volatile_always_read(self):
+        # Settings without set_func are volatile by default.
+        self.device.get_all_settings()
+        self.device.values["temperature"] = 25.0
+        settings = self.device.get_all_settings()
+        self.assertEqual(self.device.reads["temperature"], 2)
+        self.assertEqual(settings["temperature"], 25.0)
+
+    def test_ttl(self):
+        self.device.get_all_settings()
+        self.device.get_all_settings()
+        self.assertEqual(self.device.reads["mode"], 2)
+
+    def test_set_invalidates_cache(self):
+        self.device.get_all_settings()
+        self.device.set_setting("power", 2.0)
+        self.assertEqual(self.device.get_all_settings()["power"], 2.0)
+        self.assertEqual(self.device.reads["power"], 2)
+
+    def test_get_setting_reads_device(self):
+        self.device.get_all_settings()
+        self.device.values["power"] = 3.0
+        self.assertEqual(self.device.get_setting("power"), 3.0)
+        self.assertEqual(self.device.get_all_settings()["power"], 3.0)
+
+
+class TestSettingsListener(unittest.TestCase):
+    def setUp(self):
+        self.device = DeviceWithCountedReads()
+        self.listener = SettingsListener()
+        self.device.add_settings_listener(self.listener)
+
+    def tearDown(self):
+        self.device.shutdown()
+
+    def wait_for_changes(self, n):
+        deadline = time.monotonic() + 2.0
+        while len(self.listener.changes) < n:
+            if time.monotonic() > deadline:
+                self.fail("timeout waiting for settings changes")
+            time.sleep(0.01)
+        return self.listener.changes
+
+    def test_snapshot_on_add(self):
+        changes = self.wait_for_changes(1)
+        self.assertEqual(
+            changes[0], {"power": 1.0, "temperature": 20.0, "mode": 0}
+        )
+
+    def test_notify_on_set(self):
+        self.device.set_setting("power", 4.0)
+        changes = self.wait_for_changes(2)
+        self.assertEqual(changes[1], {"power": 4.0})
+
+    def test_set_without_read_back(self):
+        self.wait_for_changes(1)
+        reads = self.device.reads["power"]
+        self.device.set_setting("power", 4.0)
+        self.assertEqual(self.device.reads["power"], reads)
+
+    def test_coerced_value_read_back(self):
+        self.device.add_setting(
+            "step",
+            "int",
+            lambda: self.device.values["step"],
+            # The device only takes even values.
+            lambda v: self.device.values.update(step=v - v % 2),
+            (0, 10),
+            coerces=True,
+        )
+        self.device.values["step"] = 0
+        self.wait_for_changes(1)
+        self.device.get_setting("step")
+        self.device.set_setting("step", 5)
+        changes = self.wait_for_changes(2)
+        self.assertEqual(changes[1], {"step": 4})
+
+    def test_refresh_reports_changes_by_methods(self):
+        self.wait_for_changes(1)
+        # A method, e.g., set_exposure_time, changes a setting and
+        # only invalidates the cache.
+        self.device.values["power"] = 7.0
+        self.device._invalidate_settings_cache()
+        temperature_reads = self.device.reads["temperature"]
+        self.device._refresh_settings_cache()
+        changes = self.wait_for_changes(2)
+        self.assertEqual(changes[1], {"power": 7.0})
+        self.assertEqual(self.device.reads["temperature"], temperature_reads)
+
+    def test_notify_on_read_change(self):
+        self.device.values["temperature"] = 30.0
+        self.device.get_all_settings()
+        changes = self.wait_for_changes(2)
+        self.assertEqual(changes[1], {"temperature": 30.0})
+
+    def test_no_notification_without_change(self):
+        self.device.get_all_settings()
+        self.device._settings_changed({"power": 1.0})
+        self.device._settings_changed({"power": 5.0})
+        changes = self.wait_for_changes(2)
+        self.assertEqual(changes[1:], [{"power": 5.0}])
+
+    def test_pushed_values_are_cached(self):
+        self.wait_for_changes(1)
+        reads = self.device.reads["power"]
+        self.device._settings_changed({"power": 6.0})
+        self.assertEqual(self.device.get_all_settings()["power"], 6.0)
+        self.assertEqual(self.device.reads["power"], reads)
+
+    def test_remove_listener(self):
+        self.wait_for_changes(1)
+        self.device.remove_settings_listener(self.listener)
+        self.device.set_setting("power", 4.0)
+        with self.assertRaises(ValueError):
+            self.device.remove_settings_listener(self.listener)
+        self.assertEqual(len(self.listener.changes), 1)
+
+
 if __name__ == "__main__":
     unittest.main()
@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+
+## Copyright (C) 2020 David Miguel Susano Pinto <carandraug@gmail.com>
+##
+## This file is part of Microscope.
+##
+## Microscope is free software: you can redistribute it and/or modify
+## it under the terms of the GNU General Public License as published by
+## the Free Software Foundation, either version 3 of the License, or
+## (at your option) any later version.
+##
+## Microscope is distributed in the hope that it will be useful,
+## but WITHOUT ANY WARRANTY; without even the implied warranty of
+## MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+## GNU General Public License for more details.
+##
+## You should have received a copy of the GNU General Public License
+## along with Microscope.  If not, see <http://www.gnu.org/licenses/>.
+
+import sys
+import unittest
+
+import numpy
+
+import microscope._shared_memory
+from microscope.simulators import SimulatedCamera
+
+
+class ReceiveDataClient:
+    """Client which keeps the last data it received."""
+
+    def __init__(self):
+        self.received = []
+
+    def receiveData(self, data, timestamp, *args):
+        self.received.append(data)
+
+
+@unittest.skipIf(
+    sys.version_info < (3, 8), "requires multiprocessing.shared_memory"
+)
+class TestSharedMemoryRing(unittest.TestCase):
+    def setUp(self):
+        self.ring = microscope._shared_memory.SharedMemoryRing(100, n_slots=2)
+        self.reader = microscope._shared_memory.SharedMemoryReader()
+
+    def tearDown(self):
+        self.reader.close()
+        self.ring.close()
+
+    def test_slots_are_aligned(self):
+        self.assertEqual(self.ring.slot_size % 64, 0)
+        self.assertGreaterEqual(self.ring.slot_size, 100)
+
+    def test_write_and_resolve(self):
+        data = numpy.arange(20, dtype=numpy.uint16).reshape(4, 5)
+        view = self.reader.resolve(self.ring.write(data))
+        numpy.testing.assert_array_equal(view, data)
+        self.assertEqual(view.dtype, data.dtype)
+        del view
+
+    def test_non_contiguous_data(self):
+        data = numpy.fliplr(numpy.arange(12, dtype=numpy.uint8).reshape(3, 4))
+        view = self.reader.resolve(self.ring.write(data))
+        numpy.testing.assert_array_equal(view, data)
+        del view
+
+    def test_ring_wraps(self):
+        frames = [self.ring.write(numpy.full((10,), i)) for i in range(3)]
+        self.assertEqual(frames[0].offset, frames[2].offset)
+        self.assertNotEqual(frames[0].offset, frames[1].offset)
+
+    def test_overwritten_frames_are_dropped(self):
+        frames = [self.ring.write(numpy.full((10,), i)) for i in range(5)]
+        for frame in frames[:3]:
+            self.assertIsNone(self.reader.resolve(frame))
+            self.assertIsNone(self.reader.resolve(frame, copy=True))
+        for i, frame in enumerate(frames[3:], start=3):
+            view = self.reader.resolve(frame)
+            numpy.testing.assert_array_equal(view, numpy.full((10,), i))
+            del view
+
+    def test_resolve_copy(self):
+        data = numpy.arange(10)
+        frame = self.ring.write(data)
+        copy = self.reader.resolve(frame, copy=True)
+        self.ring.write(numpy.zeros(10))
+        self.ring.write(numpy.zeros(10))
+        numpy.testing.assert_array_equal(copy, data)
+        self.assertIsNone(self.reader.resolve(frame))
+
+    def test_too_large_data(self):
+        with self.assertRaisesRegex(ValueError, "does not fit"):
+            self.ring.write(numpy.zeros((self.ring.slot_size + 1,), "uint8"))
+
+
+@unittest.skipIf(
+    sys.version_info < (3, 8), "requires multiprocessing.shared_memory"
+)
+class TestSharedMemoryClient(unittest.TestCase):
+    def setUp(self):
+        self.camera = SimulatedCamera()
+        self.client = ReceiveDataClient()
+        self.reader = microscope._shared_memory.SharedMemoryReader()
+
+    def tearDown(self):
+        self.client.received.clear()
+        self.reader.close()
+        self.camera.shutdown()
+
+    def test_send_shared_frame(self):
+        self.camera.set_client(self.client, shared_memory=True)
+        data = numpy.ones((8, 8), dtype=numpy.uint16)
+        self.camera._send_data(self.client, data, 0.0)
+        frame = self.client.received[-1]
+        self.assertIsInstance(frame, microscope._shared_memory.SharedFrame)
+        numpy.testing.assert_array_equal(self.reader.resolve(frame), data)
+
+    def test_without_shared_memory(self):
+        self.camera.set_client(self.client)
+        data = numpy.ones((8, 8), dtype=numpy.uint16)
+        self.camera._send_data(self.client, data, 0.0)
+        self.assertIs(self.client.received[-1], data)
+        self.assertEqual(self.camera._shared_memory_rings, {})
+
+    def test_ring_replaced_for_larger_data(self):
+        self.camera.set_client(self.client, shared_memory=True)
+        self.camera._send_data(self.client, numpy.zeros((4, 4)), 0.0)
+        self.camera._send_data(self.client, numpy.zeros((64, 64)), 0.0)
+        small, large = self.client.received
+        self.assertNotEqual(small.name, large.name)
+
+    def test_ring_destroyed_when_client_removed(self):
+        self.camera.set_client(self.client, shared_memory=True)
+        self.camera._send_data(self.client, numpy.zeros((4, 4)), 0.0)
+        self.camera.set_client(None)
+        self.assertEqual(self.camera._shared_memory_rings, {})
+
+
+if __name__ == "__main__":
+    unittest.main()